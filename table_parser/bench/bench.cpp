@@ -0,0 +1,706 @@
+// 解析性能基准
+//
+// 用固定种子生成几类典型词表, 测量parse_all/parse_batch和各内置类型回调
+// 的吞吐、每列耗时与堆分配次数. 结果可保存为key=value格式的基线文件,
+// 之后的运行可与基线比较以发现性能回退.
+//
+// 用法: bench.exe [--rows N] [--seed S] [--repeat R] [--only NAME]
+//                 [--save FILE] [--compare FILE] [--threshold PCT]
+//                 [--fail-on-regression]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "table_parser.h"
+
+using namespace std;
+
+// 统计堆分配次数, 库中的分配同样经过这里
+static atomic<size_t> g_allocs(0);
+
+void* operator new(size_t size) {
+    ++g_allocs;
+    void* p = malloc(size > 0 ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete[](void* p) noexcept { free(p); }
+
+namespace {
+
+// xorshift64*, 保证不同平台生成相同的数据
+class Random {
+   public:
+    explicit Random(uint64_t seed) : _state(seed ? seed : 1) {}
+
+    uint64_t next() {
+        _state ^= _state >> 12;
+        _state ^= _state << 25;
+        _state ^= _state >> 27;
+        return _state * 2685821657736338717ull;
+    }
+
+    // [lo, hi]
+    int64_t range(int64_t lo, int64_t hi) {
+        return lo + static_cast<int64_t>(next() %
+                                         static_cast<uint64_t>(hi - lo + 1));
+    }
+
+   private:
+    uint64_t _state;
+};
+
+/**
+ * @brief 一类基准输入
+ */
+struct Scenario {
+    string name;
+    string text;
+    vector<tp::ColumnDescriptor> desc;
+    size_t row_size;
+    size_t rows;
+    size_t fields;  // 所有行的字段数, 数组元素单独计数
+};
+
+// 按对齐规则依次排布列, 生成列描述
+class Layout {
+   public:
+    Layout() : _size(0) {}
+
+    void add(tp::DataType type, size_t element_size,
+             tp::parser_callback callback = nullptr, void* context = nullptr) {
+        tp::ColumnDescriptor col = {type,     false,   0, element_size,
+                                    place(element_size, align(element_size)),
+                                    0,        callback, context};
+        _desc.push_back(col);
+    }
+
+    void add_array(tp::DataType type, size_t element_size, size_t max) {
+        ptrdiff_t counter = place(sizeof(unsigned), sizeof(unsigned));
+        ptrdiff_t offset = place(element_size * max, align(element_size));
+        tp::ColumnDescriptor col = {type,    true,    max,    element_size,
+                                    offset,  counter, nullptr, nullptr};
+        _desc.push_back(col);
+    }
+
+    void finish(Scenario& s) {
+        s.desc = _desc;
+        tp::ColumnDescriptor end = {tp::KNONE, false, 0, 0, 0, 0, nullptr,
+                                    nullptr};
+        s.desc.push_back(end);
+        s.row_size = (_size + 7) / 8 * 8;
+    }
+
+   private:
+    static size_t align(size_t size) {
+        return size >= 8 ? 8 : (size >= 4 ? 4 : 1);
+    }
+
+    ptrdiff_t place(size_t size, size_t alignment) {
+        _size = (_size + alignment - 1) / alignment * alignment;
+        ptrdiff_t offset = static_cast<ptrdiff_t>(_size);
+        _size += size;
+        return offset;
+    }
+
+   private:
+    vector<tp::ColumnDescriptor> _desc;
+    size_t _size;
+};
+
+void append_int(string& out, Random& rnd, int64_t lo, int64_t hi) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(rnd.range(lo, hi)));
+    out += buf;
+}
+
+void append_float(string& out, Random& rnd) {
+    char buf[64];
+    double v = static_cast<double>(rnd.range(-1000000, 1000000)) / 1000.0;
+    switch (rnd.next() % 4) {
+        case 0:
+            snprintf(buf, sizeof(buf), "%.2f", v);
+            break;
+        case 1:
+            snprintf(buf, sizeof(buf), "%.6f", v / 100.0);
+            break;
+        case 2:
+            snprintf(buf, sizeof(buf), "%.4e", v * 1e5);
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "%.7g", v);
+            break;
+    }
+    out += buf;
+}
+
+void append_word(string& out, Random& rnd, size_t len) {
+    static const char KLETTERS[] = "abcdefghijklmnopqrstuvwxyz0123456789 _-";
+    for (size_t i = 0; i < len; ++i) {
+        out += KLETTERS[rnd.next() % (sizeof(KLETTERS) - 1)];
+    }
+}
+
+Scenario int_heavy(size_t rows, Random& rnd) {
+    Scenario s;
+    s.name = "int_heavy";
+    Layout layout;
+    for (int i = 0; i < 8; ++i) {
+        layout.add(tp::KINT, sizeof(int));
+    }
+    layout.finish(s);
+
+    for (size_t r = 0; r < rows; ++r) {
+        for (int i = 0; i < 8; ++i) {
+            if (i > 0) {
+                s.text += '\t';
+            }
+            append_int(s.text, rnd, i < 4 ? -1000 : -2000000000,
+                       i < 4 ? 1000 : 2000000000);
+        }
+        s.text += '\n';
+    }
+    s.rows = rows;
+    s.fields = rows * 8;
+    return s;
+}
+
+Scenario float_heavy(size_t rows, Random& rnd) {
+    Scenario s;
+    s.name = "float_heavy";
+    Layout layout;
+    for (int i = 0; i < 8; ++i) {
+        layout.add(i % 2 ? tp::KDOUBLE : tp::KFLOAT,
+                   i % 2 ? sizeof(double) : sizeof(float));
+    }
+    layout.finish(s);
+
+    for (size_t r = 0; r < rows; ++r) {
+        for (int i = 0; i < 8; ++i) {
+            if (i > 0) {
+                s.text += '\t';
+            }
+            append_float(s.text, rnd);
+        }
+        s.text += '\n';
+    }
+    s.rows = rows;
+    s.fields = rows * 8;
+    return s;
+}
+
+Scenario long_strings(size_t rows, Random& rnd) {
+    Scenario s;
+    s.name = "long_strings";
+    Layout layout;
+    layout.add(tp::KINT, sizeof(int));
+    layout.add(tp::KSTRING, 512);
+    layout.add(tp::KSTRING, 512);
+    layout.finish(s);
+
+    for (size_t r = 0; r < rows; ++r) {
+        append_int(s.text, rnd, 0, 1000000);
+        s.text += '\t';
+        append_word(s.text, rnd, static_cast<size_t>(rnd.range(100, 500)));
+        s.text += '\t';
+        append_word(s.text, rnd, static_cast<size_t>(rnd.range(100, 500)));
+        s.text += '\n';
+    }
+    s.rows = rows;
+    s.fields = rows * 3;
+    return s;
+}
+
+Scenario wide_rows(size_t rows, Random& rnd) {
+    Scenario s;
+    s.name = "wide_rows";
+    Layout layout;
+    for (int i = 0; i < 64; ++i) {
+        switch (i % 3) {
+            case 0:
+                layout.add(tp::KINT, sizeof(int));
+                break;
+            case 1:
+                layout.add(tp::KDOUBLE, sizeof(double));
+                break;
+            default:
+                layout.add(tp::KSTRING, 16);
+                break;
+        }
+    }
+    layout.finish(s);
+
+    for (size_t r = 0; r < rows; ++r) {
+        for (int i = 0; i < 64; ++i) {
+            if (i > 0) {
+                s.text += '\t';
+            }
+            switch (i % 3) {
+                case 0:
+                    append_int(s.text, rnd, -100000, 100000);
+                    break;
+                case 1:
+                    append_float(s.text, rnd);
+                    break;
+                default:
+                    append_word(s.text, rnd,
+                                static_cast<size_t>(rnd.range(1, 15)));
+                    break;
+            }
+        }
+        s.text += '\n';
+    }
+    s.rows = rows;
+    s.fields = rows * 64;
+    return s;
+}
+
+Scenario big_arrays(size_t rows, Random& rnd) {
+    Scenario s;
+    s.name = "big_arrays";
+    Layout layout;
+    layout.add(tp::KINT, sizeof(int));
+    layout.add_array(tp::KFLOAT, sizeof(float), 256);
+    layout.add_array(tp::KINT, sizeof(int), 64);
+    layout.finish(s);
+
+    s.fields = 0;
+    for (size_t r = 0; r < rows; ++r) {
+        append_int(s.text, rnd, 0, 1000000);
+
+        size_t floats = static_cast<size_t>(rnd.range(128, 256));
+        s.text += '\t';
+        append_int(s.text, rnd, static_cast<int64_t>(floats),
+                   static_cast<int64_t>(floats));
+        s.text += ':';
+        for (size_t i = 0; i < floats; ++i) {
+            if (i > 0) {
+                s.text += ',';
+            }
+            append_float(s.text, rnd);
+        }
+
+        size_t ints = static_cast<size_t>(rnd.range(16, 64));
+        s.text += '\t';
+        append_int(s.text, rnd, static_cast<int64_t>(ints),
+                   static_cast<int64_t>(ints));
+        s.text += ':';
+        for (size_t i = 0; i < ints; ++i) {
+            if (i > 0) {
+                s.text += ',';
+            }
+            append_int(s.text, rnd, -100000, 100000);
+        }
+        s.text += '\n';
+        s.fields += 1 + floats + ints;
+    }
+    s.rows = rows;
+    return s;
+}
+
+// 约三分之一的行含有错误: 非法字符、缺列、多列
+Scenario error_dense(size_t rows, Random& rnd) {
+    Scenario s = int_heavy(rows, rnd);
+    s.name = "error_dense";
+
+    string text;
+    text.reserve(s.text.size());
+    size_t begin = 0;
+    while (begin < s.text.size()) {
+        size_t end = s.text.find('\n', begin);
+        string line = s.text.substr(begin, end - begin);
+        switch (rnd.next() % 9) {
+            case 0:
+                line[static_cast<size_t>(rnd.next() % line.size())] = 'x';
+                break;
+            case 1:
+                line = line.substr(0, line.rfind('\t'));
+                break;
+            case 2:
+                line += "\t1";
+                break;
+            default:
+                break;
+        }
+        text += line;
+        text += '\n';
+        begin = end + 1;
+    }
+    s.text.swap(text);
+    return s;
+}
+
+/**
+ * @brief 一次测量结果
+ */
+struct Measure {
+    double seconds;
+    size_t allocs;
+    size_t ok_rows;
+};
+
+template <size_t N>
+struct RawRow {
+    char bytes[N];
+};
+
+double now() {
+    return chrono::duration<double>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template <size_t N>
+Measure run_parse_all(const Scenario& s) {
+    vector<RawRow<N> > out;
+    vector<tp::ParseError> err;
+
+    size_t allocs = g_allocs.load();
+    double start = now();
+    unsigned ok = tp::parse_all(s.text.c_str(), &s.desc[0], out, err);
+    Measure m = {now() - start, g_allocs.load() - allocs, ok};
+    return m;
+}
+
+Measure run_parse_all(const Scenario& s) {
+    if (s.row_size <= 64) {
+        return run_parse_all<64>(s);
+    } else if (s.row_size <= 256) {
+        return run_parse_all<256>(s);
+    } else if (s.row_size <= 1024) {
+        return run_parse_all<1024>(s);
+    }
+    return run_parse_all<2048>(s);
+}
+
+// 固定大小缓冲区, 错误只计数, 理想情况下没有分配
+Measure run_parse_batch(const Scenario& s) {
+    static const size_t KBATCH_ROWS = 256;
+    vector<char> buf(s.row_size * KBATCH_ROWS);
+
+    size_t allocs = g_allocs.load();
+    double start = now();
+    tp::ParsePlan plan(&s.desc[0], s.row_size);
+    tp::TableParser parser(s.text.c_str(), plan);
+    size_t ok = 0;
+    while (true) {
+        tp::BatchResult r =
+            parser.parse_batch(&buf[0], s.row_size, KBATCH_ROWS, nullptr);
+        ok += r.rows;
+        if (r.eof) {
+            break;
+        }
+    }
+    Measure m = {now() - start, g_allocs.load() - allocs, ok};
+    return m;
+}
+
+typedef map<string, double> Results;
+
+template <typename F>
+Measure best_of(unsigned repeat, F run) {
+    Measure best = run();
+    for (unsigned i = 1; i < repeat; ++i) {
+        Measure m = run();
+        if (m.seconds < best.seconds) {
+            best = m;
+        }
+    }
+    return best;
+}
+
+void report(const Scenario& s, const char* mode, const Measure& m,
+            Results& results) {
+    double mb_s = static_cast<double>(s.text.size()) / m.seconds / 1e6;
+    double rows_s = static_cast<double>(s.rows) / m.seconds;
+    double ns_field = m.seconds * 1e9 / static_cast<double>(s.fields);
+    printf("%-14s %-11s %9.1f MB/s %12.0f rows/s %8.2f ns/field %8zu allocs "
+           "(%zu ok)\n",
+           s.name.c_str(), mode, mb_s, rows_s, ns_field, m.allocs, m.ok_rows);
+
+    string key = s.name + "." + mode + ".";
+    results[key + "mb_s"] = mb_s;
+    results[key + "rows_s"] = rows_s;
+    results[key + "ns_field"] = ns_field;
+    results[key + "allocs"] = static_cast<double>(m.allocs);
+}
+
+/**
+ * @brief 单独测量某类型内置回调
+ */
+struct CallbackCase {
+    const char* name;
+    tp::DataType type;
+    size_t size;
+    void* context;
+};
+
+void bench_callbacks(size_t count, uint64_t seed, unsigned repeat,
+                     Results& results) {
+    static const char* const KENUM_NAMES[] = {
+        "red",  "green", "blue",   "cyan",   "magenta", "yellow",
+        "black", "white", "orange", "purple", "brown",   "pink"};
+    tp::EnumTable enums(KENUM_NAMES,
+                        sizeof(KENUM_NAMES) / sizeof(KENUM_NAMES[0]));
+
+    const CallbackCase cases[] = {
+        {"int", tp::KINT, sizeof(int), nullptr},
+        {"int64", tp::KINT64, sizeof(int64_t), nullptr},
+        {"uint32", tp::KUINT32, sizeof(uint32_t), nullptr},
+        {"uint64", tp::KUINT64, sizeof(uint64_t), nullptr},
+        {"float", tp::KFLOAT, sizeof(float), nullptr},
+        {"double", tp::KDOUBLE, sizeof(double), nullptr},
+        {"bool", tp::KBOOL, sizeof(bool), nullptr},
+        {"string", tp::KSTRING, 32, nullptr},
+        {"enum", tp::KENUM, sizeof(int), &enums}};
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        const CallbackCase& cc = cases[c];
+        Random rnd(seed + c);
+
+        // 生成该类型的合法文本
+        string text;
+        vector<size_t> offsets;
+        for (size_t i = 0; i < count; ++i) {
+            offsets.push_back(text.size());
+            switch (cc.type) {
+                case tp::KINT:
+                    append_int(text, rnd, -2000000000, 2000000000);
+                    break;
+                case tp::KINT64:
+                    append_int(text, rnd, -4000000000000000000ll,
+                               4000000000000000000ll);
+                    break;
+                case tp::KUINT32:
+                    append_int(text, rnd, 0, 4000000000ll);
+                    break;
+                case tp::KUINT64:
+                    append_int(text, rnd, 0, 9000000000000000000ll);
+                    break;
+                case tp::KFLOAT:
+                case tp::KDOUBLE:
+                    append_float(text, rnd);
+                    break;
+                case tp::KBOOL:
+                    text += rnd.next() % 2 ? "true" : "0";
+                    break;
+                case tp::KSTRING:
+                    append_word(text, rnd,
+                                static_cast<size_t>(rnd.range(4, 31)));
+                    break;
+                default:
+                    text += KENUM_NAMES[rnd.next() % (sizeof(KENUM_NAMES) /
+                                                      sizeof(KENUM_NAMES[0]))];
+                    break;
+            }
+        }
+        offsets.push_back(text.size());
+
+        tp::ColumnDescriptor desc[] = {
+            {cc.type, false, 0, cc.size, 0, 0, nullptr, cc.context},
+            {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+        tp::ParsePlan plan(desc, cc.size);
+        const tp::ColumnDescriptor& col = plan.column(0);
+
+        char out[64];
+        size_t failed = 0;
+        Measure m = best_of(repeat, [&]() {
+            size_t allocs = g_allocs.load();
+            double start = now();
+            for (size_t i = 0; i < count; ++i) {
+                if (!col.callback(&text[offsets[i]], offsets[i + 1] - offsets[i],
+                                  out, cc.size, col.context)) {
+                    ++failed;
+                }
+            }
+            Measure r = {now() - start, g_allocs.load() - allocs, 0};
+            return r;
+        });
+
+        double ns_call = m.seconds * 1e9 / static_cast<double>(count);
+        double mb_s = static_cast<double>(text.size()) / m.seconds / 1e6;
+        printf("callback %-8s %9.2f ns/call %9.1f MB/s%s\n", cc.name, ns_call,
+               mb_s, failed ? "  (unexpected failures)" : "");
+
+        string key = string("callback.") + cc.name + ".";
+        results[key + "ns_call"] = ns_call;
+        results[key + "mb_s"] = mb_s;
+    }
+}
+
+bool save_results(const char* path, const Results& results) {
+    ofstream out(path, ios::trunc);
+    for (Results::const_iterator it = results.begin(); it != results.end();
+         ++it) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.6g", it->second);
+        out << it->first << '=' << buf << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+bool load_results(const char* path, Results& results) {
+    ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    string line;
+    while (getline(in, line)) {
+        size_t eq = line.find('=');
+        if (line.empty() || line[0] == '#' || eq == string::npos) {
+            continue;
+        }
+        results[line.substr(0, eq)] = strtod(line.c_str() + eq + 1, nullptr);
+    }
+    return true;
+}
+
+bool ends_with(const string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// 返回回退的指标个数
+size_t compare_results(const Results& baseline, const Results& current,
+                       double threshold) {
+    size_t regressions = 0;
+    printf("\n%-40s %14s %14s %9s\n", "metric", "baseline", "current",
+           "change");
+    for (Results::const_iterator it = current.begin(); it != current.end();
+         ++it) {
+        Results::const_iterator base = baseline.find(it->first);
+        if (base == baseline.end()) {
+            continue;
+        }
+
+        // 吞吐越高越好, 耗时和分配越低越好
+        bool higher_better =
+            ends_with(it->first, ".mb_s") || ends_with(it->first, ".rows_s");
+        double change = base->second == 0
+                            ? (it->second == 0 ? 0 : 100.0)
+                            : (it->second - base->second) / base->second * 100;
+        double worse = higher_better ? -change : change;
+        bool regressed = worse > threshold;
+        regressions += regressed;
+
+        printf("%-40s %14.4g %14.4g %+8.1f%%%s\n", it->first.c_str(),
+               base->second, it->second, change,
+               regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: bench.exe [--rows N] [--seed S] [--repeat R] "
+            "[--only NAME]\n"
+            "                 [--save FILE] [--compare FILE] "
+            "[--threshold PCT]\n"
+            "                 [--fail-on-regression]\n");
+}
+}
+
+int main(int argc, char** argv) {
+    size_t rows = 100000;
+    uint64_t seed = 42;
+    unsigned repeat = 3;
+    double threshold = 10.0;
+    bool fail_on_regression = false;
+    const char* only = nullptr;
+    const char* save_path = nullptr;
+    const char* compare_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--rows" && has_value) {
+            rows = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && has_value) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--repeat" && has_value) {
+            repeat = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--only" && has_value) {
+            only = argv[++i];
+        } else if (arg == "--save" && has_value) {
+            save_path = argv[++i];
+        } else if (arg == "--compare" && has_value) {
+            compare_path = argv[++i];
+        } else if (arg == "--threshold" && has_value) {
+            threshold = strtod(argv[++i], nullptr);
+        } else if (arg == "--fail-on-regression") {
+            fail_on_regression = true;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (rows == 0 || repeat == 0) {
+        usage();
+        return 2;
+    }
+
+    typedef Scenario (*Generator)(size_t, Random&);
+    const Generator generators[] = {int_heavy,  float_heavy, long_strings,
+                                    wide_rows,  big_arrays,  error_dense};
+
+    Results results;
+    printf("rows=%zu seed=%llu repeat=%u\n", rows,
+           static_cast<unsigned long long>(seed), repeat);
+    for (size_t g = 0; g < sizeof(generators) / sizeof(generators[0]); ++g) {
+        Random rnd(seed + g);
+        // 宽行和大数组每行数据量大, 减少行数以控制总耗时
+        size_t n = rows;
+        if (g == 3 || g == 4) {
+            n = rows / 10 > 0 ? rows / 10 : 1;
+        }
+        Scenario s = generators[g](n, rnd);
+        if (only && s.name != only) {
+            continue;
+        }
+
+        report(s, "parse_all", best_of(repeat, [&]() {
+                   return run_parse_all(s);
+               }),
+               results);
+        report(s, "parse_batch", best_of(repeat, [&]() {
+                   return run_parse_batch(s);
+               }),
+               results);
+    }
+    if (!only || string(only) == "callback") {
+        bench_callbacks(rows, seed, repeat, results);
+    }
+
+    if (save_path && !save_results(save_path, results)) {
+        fprintf(stderr, "cannot write %s\n", save_path);
+        return 1;
+    }
+
+    if (compare_path) {
+        Results baseline;
+        if (!load_results(compare_path, baseline)) {
+            fprintf(stderr, "cannot read %s\n", compare_path);
+            return 1;
+        }
+        size_t regressions = compare_results(baseline, results, threshold);
+        printf("%zu regression(s) beyond %.1f%%\n", regressions, threshold);
+        if (fail_on_regression && regressions > 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#ifndef TABLEPARSER_COLUMNAR_TABLE_H
+#define TABLEPARSER_COLUMNAR_TABLE_H
+
+#include <cassert>
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+#include "table_parser.h"
+
+namespace tp {
+
+/**
+ * @brief 列式(struct-of-arrays)存储的解析结果
+ *
+ * 每列一块连续存储:
+ *   定长列       按行连续存放的值
+ *   数组列       所有行的元素扁平存放, 另有row_count() + 1个元素偏移
+ *   非数组字符串 所有行的字符串(含'\0')存放在一个字节区, 另有字节偏移
+ * 列描述中的offset/array_counter_offset被忽略, 字符串长度不受element_size限制
+ */
+class ColumnarTable {
+   public:
+    /**
+     * @param[in] desc 列描述数组, 以KNONE结束
+     */
+    explicit ColumnarTable(const ColumnDescriptor desc[]);
+
+    const ParsePlan& plan() const;
+
+    size_t row_count() const;
+
+    size_t column_count() const;
+
+    /**
+     * @brief 定长非数组列的所有值
+     * @tparam V 值类型, 大小须与列的element_size一致
+     */
+    template <typename V>
+    const V* values(size_t idx) const {
+        assert(!has_offsets(idx) && sizeof(V) == element_size(idx));
+        return reinterpret_cast<const V*>(column_data(idx));
+    }
+
+    /**
+     * @brief 数组列某一行的元素
+     * @param[out] count 元素个数
+     */
+    template <typename V>
+    const V* array(size_t idx, size_t row, size_t* count) const {
+        assert(plan().column(idx).is_array && sizeof(V) == element_size(idx));
+        const size_t* off = offsets(idx);
+        *count = off[row + 1] - off[row];
+        return reinterpret_cast<const V*>(column_data(idx)) + off[row];
+    }
+
+    /**
+     * @brief 数组列所有行的扁平元素
+     */
+    template <typename V>
+    const V* array_values(size_t idx) const {
+        assert(plan().column(idx).is_array && sizeof(V) == element_size(idx));
+        return reinterpret_cast<const V*>(column_data(idx));
+    }
+
+    /**
+     * @brief 数组列的元素偏移或字符串列的字节偏移, 共row_count() + 1个
+     */
+    const size_t* offsets(size_t idx) const;
+
+    /**
+     * @brief 非数组字符串列某一行的值
+     * @param[out] len 字符串长度, 可以为nullptr
+     * @return 以'\0'结尾的字符串
+     */
+    const char* string(size_t idx, size_t row, size_t* len = nullptr) const;
+
+    /**
+     * @brief 为rows行预留空间
+     */
+    void reserve(size_t rows);
+
+    void clear();
+
+    // 以下接口供TableParser::parse_columns填充数据使用
+
+    /// @brief 开始追加一行
+    void begin_row();
+
+    /// @brief 为第idx列追加size字节并返回其地址, 下次追加前有效
+    void* append_value(size_t idx, size_t size);
+
+    /// @brief 确认追加的行
+    void commit_row();
+
+    /// @brief 丢弃begin_row之后追加的数据
+    void rollback_row();
+
+   private:
+    struct Column {
+        std::vector<char> data;
+        std::vector<size_t> offsets;
+        size_t mark;
+    };
+
+    bool has_offsets(size_t idx) const;
+
+    size_t element_size(size_t idx) const;
+
+    const char* column_data(size_t idx) const;
+
+   private:
+    ParsePlan _plan;
+    std::vector<Column> _columns;
+    size_t _rows;
+};
+
+/**
+ * @brief 列式解析剩余所有数据
+ * @param[in,out] tb_parser 解析器
+ * @param[in,out] table 输出表
+ * @param[in,out] err 输出错误, 只包含失败的行
+ * @return 解析成功数
+ */
+unsigned parse_all(TableParser& tb_parser, ColumnarTable& table,
+                   std::vector<ParseError>& err);
+
+unsigned parse_all(TableParser& tb_parser, ColumnarTable& table,
+                   std::vector<std::string>& err);
+}
+#endif  // TABLEPARSER_COLUMNAR_TABLE_H
@@ -0,0 +1,89 @@
+#ifndef TABLEPARSER_ENUM_TABLE_H
+#define TABLEPARSER_ENUM_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+namespace tp {
+
+/**
+ * @brief 枚举项
+ */
+struct EnumItem {
+    const char* name;  ///@brief 枚举名, 为nullptr时表示数组结束
+    int value;         ///@brief 枚举值
+};
+
+/**
+ * @brief 枚举字符串表
+ *
+ * 构造时为所有枚举名生成两级完美哈希(CHD): 第一级把名字分到小桶,
+ * 第二级为每个桶选一个位移值, 使桶内名字落到互不冲突的槽位. 查找时
+ * 只需遍历一次名字计算哈希, 再做一次比较. 构造耗时和表大小都与枚举
+ * 个数成线性关系. 作为KENUM列的context使用, 构造后只读, 可被多个线程共享
+ */
+class EnumTable {
+   public:
+    /**
+     * @brief 以数组下标作为枚举值构造
+     * @param[in] names 枚举名数组
+     * @param[in] count 枚举名个数
+     */
+    EnumTable(const char* const names[], size_t count);
+
+    /**
+     * @brief 以指定枚举值构造
+     * @param[in] items 枚举项数组, 以name为nullptr的项结束
+     */
+    explicit EnumTable(const EnumItem items[]);
+
+    /**
+     * @brief 枚举表是否有效
+     *
+     * 存在重复的枚举名时无效, 无效的枚举表查找总是失败
+     */
+    bool ok() const;
+
+    /**
+     * @brief 查找枚举值
+     * @param[in] s 枚举名, 不要求以'\0'结尾
+     * @param[in] len 枚举名长度
+     * @param[out] value 枚举值
+     * @return 是否找到
+     */
+    bool find(const char* s, size_t len, int* value) const;
+
+    size_t size() const;
+
+    /**
+     * @brief 第idx个枚举项的名字, 按构造时的顺序
+     */
+    const std::string& name(size_t idx) const;
+
+    /**
+     * @brief 第idx个枚举项的值, 按构造时的顺序
+     */
+    int value(size_t idx) const;
+
+   private:
+    void build();
+
+    // 以当前种子为所有名字计算哈希并尝试建表, 失败时返回false
+    bool try_build(uint32_t table_size);
+
+    static uint64_t hash(const char* s, size_t len, uint32_t seed);
+
+   private:
+    std::vector<std::string> _names;
+    std::vector<int> _values;
+    std::vector<int32_t> _slots;  // 槽位到枚举项下标的映射, -1表示空
+    std::vector<uint32_t> _displace;  // 每个桶的位移值
+    uint32_t _mask;
+    uint32_t _seed;
+    bool _ok;
+};
+}
+#endif  // TABLEPARSER_ENUM_TABLE_H
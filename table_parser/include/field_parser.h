@@ -0,0 +1,590 @@
+#ifndef TABLEPARSER_FIELD_PARSER_H
+#define TABLEPARSER_FIELD_PARSER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace tp {
+
+// 内置类型的字段解析函数
+// 输入s不要求以'\0'结尾, 解析失败时不修改输出
+
+// 8个字节是否全部为数字字符
+inline bool is_eight_digits(uint64_t v) {
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+// 一次转换8个数字字符(SWAR), 要求小端序且已通过is_eight_digits检查
+inline uint32_t parse_eight_digits(uint64_t v) {
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 100 + (1000000ULL << 32);
+    const uint64_t mul2 = 1 + (10000ULL << 32);
+    v -= 0x3030303030303030ULL;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return static_cast<uint32_t>(v);
+}
+
+// 解析无符号10进制数字串, 结果不超过limit, 不允许空串和非数字字符
+inline bool parse_digits(const char* s, size_t len, uint64_t limit,
+                         uint64_t* out) {
+    if (len == 0) {
+        return false;
+    }
+
+    // 前导0不计入有效位数
+    while (len > 1 && *s == '0') {
+        ++s;
+        --len;
+    }
+
+    // uint64最多20位
+    if (len > 20) {
+        return false;
+    }
+
+    // 19位以内不会溢出uint64
+    size_t fast_len = len < 19 ? len : 19;
+    uint64_t ret = 0;
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= fast_len; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, s + i, sizeof(v));
+        if (!is_eight_digits(v)) {
+            return false;
+        }
+        ret = ret * 100000000ULL + parse_eight_digits(v);
+    }
+#endif
+    for (; i < fast_len; ++i) {
+        unsigned d = static_cast<unsigned>(s[i] - '0');
+        if (d > 9) {
+            return false;
+        }
+        ret = ret * 10 + d;
+    }
+
+    if (i < len) {
+        unsigned d = static_cast<unsigned>(s[i] - '0');
+        if (d > 9) {
+            return false;
+        }
+        if (ret > (UINT64_MAX - d) / 10) {
+            return false;
+        }
+        ret = ret * 10 + d;
+    }
+
+    if (ret > limit) {
+        return false;
+    }
+
+    *out = ret;
+    return true;
+}
+
+// 解析带符号10进制整数, 取值范围为[-max - 1, max]
+inline bool parse_signed(const char* s, size_t len, uint64_t max,
+                         int64_t* out) {
+    if (len == 0) {
+        return false;
+    }
+
+    // 符号位
+    bool neg = false;
+    if (s[0] == '+') {
+        ++s;
+        --len;
+    } else if (s[0] == '-') {
+        ++s;
+        --len;
+        neg = true;
+    }
+
+    // 数字
+    uint64_t value = 0;
+    if (!parse_digits(s, len, neg ? max + 1 : max, &value)) {
+        return false;
+    }
+
+    if (neg) {
+        // 避免对最小值取负时溢出
+        *out = value == 0 ? 0 : -static_cast<int64_t>(value - 1) - 1;
+    } else {
+        *out = static_cast<int64_t>(value);
+    }
+    return true;
+}
+
+// 解析无符号10进制整数, 允许'+'号
+inline bool parse_unsigned(const char* s, size_t len, uint64_t max,
+                           uint64_t* out) {
+    if (len > 0 && s[0] == '+') {
+        ++s;
+        --len;
+    }
+    return parse_digits(s, len, max, out);
+}
+
+// 转换1至8个数字字符, 要求从s开始至少8个字节可读
+inline bool parse_short_digits(const char* s, size_t len, uint32_t* out) {
+    if (len == 0 || len > 8) {
+        return false;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // 数字移到高位字节, 低位补'0', 整块校验并转换
+    uint64_t v;
+    std::memcpy(&v, s, sizeof(v));
+    if (len < 8) {
+        v = (v << ((8 - len) * 8)) | (0x3030303030303030ULL >> (len * 8));
+    }
+    if (!is_eight_digits(v)) {
+        return false;
+    }
+    *out = parse_eight_digits(v);
+    return true;
+#else
+    uint64_t value = 0;
+    if (!parse_digits(s, len, UINT32_MAX, &value)) {
+        return false;
+    }
+    *out = static_cast<uint32_t>(value);
+    return true;
+#endif
+}
+
+// 与parse_signed相同, 要求从s开始至少len + 8个字节可读
+inline bool parse_signed_padded(const char* s, size_t len, uint64_t max,
+                                int64_t* out) {
+    bool neg = len > 0 && s[0] == '-';
+    size_t sign = len > 0 && (s[0] == '-' || s[0] == '+') ? 1 : 0;
+    if (len - sign > 8) {
+        return parse_signed(s, len, max, out);
+    }
+
+    uint32_t value = 0;
+    if (!parse_short_digits(s + sign, len - sign, &value) ||
+        value > (neg ? max + 1 : max)) {
+        return false;
+    }
+    *out = neg ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    return true;
+}
+
+// 与parse_unsigned相同, 要求从s开始至少len + 8个字节可读
+inline bool parse_unsigned_padded(const char* s, size_t len, uint64_t max,
+                                  uint64_t* out) {
+    size_t sign = len > 0 && s[0] == '+' ? 1 : 0;
+    if (len - sign > 8) {
+        return parse_unsigned(s, len, max, out);
+    }
+
+    uint32_t value = 0;
+    if (!parse_short_digits(s + sign, len - sign, &value) || value > max) {
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+/**
+ * @brief 10进制浮点数的拆分结果
+ *
+ * 数值为 (neg ? -1 : 1) * mantissa * 10^exponent,
+ * truncated表示超过19位的有效数字被截断
+ */
+struct Decimal {
+    bool neg;
+    bool truncated;
+    uint64_t mantissa;
+    int64_t exponent;
+};
+
+// 按json.org的浮点数语法拆分, 同时允许'+'号以及"1."这样的写法
+inline bool parse_decimal(const char* s, size_t len, Decimal* out) {
+    static const unsigned KMAX_DIGITS = 19;
+    // 指数绝对值超过该值时结果必然溢出或下溢
+    static const int64_t KMAX_EXPONENT = 100000;
+
+    const char* end = s + len;
+    out->neg = false;
+    out->truncated = false;
+    out->mantissa = 0;
+    out->exponent = 0;
+
+    // 符号位
+    if (s < end && (*s == '+' || *s == '-')) {
+        out->neg = *s == '-';
+        ++s;
+    }
+
+    // 整数部分: '0' 或 [1-9][0-9]*
+    if (s == end || *s < '0' || *s > '9') {
+        return false;
+    }
+    unsigned digits = 0;
+    if (*s == '0') {
+        ++s;
+    } else {
+        for (; s < end && *s >= '0' && *s <= '9'; ++s) {
+            if (digits < KMAX_DIGITS) {
+                out->mantissa = out->mantissa * 10 +
+                                static_cast<uint64_t>(*s - '0');
+                ++digits;
+            } else {
+                out->truncated = out->truncated || *s != '0';
+                ++out->exponent;
+            }
+        }
+    }
+
+    // 小数部分, 允许小数点后没有数字
+    if (s < end && *s == '.') {
+        for (++s; s < end && *s >= '0' && *s <= '9'; ++s) {
+            if (out->mantissa == 0 && *s == '0') {
+                // 前导0不占用有效位数
+                --out->exponent;
+            } else if (digits < KMAX_DIGITS) {
+                out->mantissa = out->mantissa * 10 +
+                                static_cast<uint64_t>(*s - '0');
+                ++digits;
+                --out->exponent;
+            } else {
+                out->truncated = out->truncated || *s != '0';
+            }
+        }
+    }
+
+    // 指数部分
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        ++s;
+        bool neg_power = false;
+        if (s < end && (*s == '+' || *s == '-')) {
+            neg_power = *s == '-';
+            ++s;
+        }
+        if (s == end) {
+            return false;
+        }
+        int64_t power = 0;
+        for (; s < end && *s >= '0' && *s <= '9'; ++s) {
+            if (power < KMAX_EXPONENT) {
+                power = power * 10 + (*s - '0');
+            }
+        }
+        out->exponent += neg_power ? -power : power;
+    }
+
+    return s == end;
+}
+
+// 快速拆分"[+-]ddd[.ddd]"形式的浮点数, 整数和小数部分各不超过8位,
+// 要求从s开始至少len + 8个字节可读; 不是该形式时返回false, 由parse_decimal处理
+inline bool parse_simple_decimal(const char* s, size_t len, Decimal* out) {
+    static const uint64_t KPOW10[] = {1,      10,      100,      1000,
+                                      10000,  100000,  1000000,  10000000,
+                                      100000000};
+
+    const char* end = s + len;
+    bool neg = false;
+    if (s < end && (*s == '+' || *s == '-')) {
+        neg = *s == '-';
+        ++s;
+    }
+
+    const char* dot =
+        static_cast<const char*>(std::memchr(s, '.', static_cast<size_t>(end - s)));
+    const char* int_end = dot ? dot : end;
+    size_t int_len = static_cast<size_t>(int_end - s);
+    // 整数部分不允许前导0
+    if (int_len > 8 || (int_len > 1 && *s == '0')) {
+        return false;
+    }
+    uint32_t int_part = 0;
+    if (!parse_short_digits(s, int_len, &int_part)) {
+        return false;
+    }
+
+    uint32_t frac_part = 0;
+    size_t frac_len = dot ? static_cast<size_t>(end - dot - 1) : 0;
+    if (frac_len > 8 ||
+        (frac_len > 0 && !parse_short_digits(dot + 1, frac_len, &frac_part))) {
+        return false;
+    }
+
+    out->neg = neg;
+    out->truncated = false;
+    out->mantissa = int_part * KPOW10[frac_len] + frac_part;
+    out->exponent = -static_cast<int64_t>(frac_len);
+    return true;
+}
+
+// 慢速路径保留的有效数字位数, 超过double正确舍入所需的最多767位
+static const size_t KSLOW_DECIMAL_DIGITS = 800;
+// 规范化结果的缓冲区大小: 符号, 有效数字, 舍入位, 'e', 指数和'\0'
+static const size_t KSLOW_DECIMAL_BUFFER = KSLOW_DECIMAL_DIGITS + 32;
+
+// 把已通过parse_decimal校验的数字改写为"[-]ddd[e[-]nnn]", 不含小数点,
+// 因此C库的转换结果与当前locale无关; 多余的有效数字截断为一个非0舍入位
+inline void format_slow_decimal(const char* s, size_t len, char* buf) {
+    const char* end = s + len;
+    char* out = buf;
+    if (s < end && (*s == '+' || *s == '-')) {
+        if (*s == '-') {
+            *out++ = '-';
+        }
+        ++s;
+    }
+
+    size_t kept = 0;
+    bool sticky = false;
+    int64_t exponent = 0;
+    bool frac = false;
+    for (; s < end && *s != 'e' && *s != 'E'; ++s) {
+        if (*s == '.') {
+            frac = true;
+            continue;
+        }
+        if (kept == 0 && *s == '0') {
+            // 前导0不占用有效位数
+            exponent -= frac ? 1 : 0;
+        } else if (kept < KSLOW_DECIMAL_DIGITS) {
+            *out++ = *s;
+            ++kept;
+            exponent -= frac ? 1 : 0;
+        } else {
+            sticky = sticky || *s != '0';
+            exponent += frac ? 0 : 1;
+        }
+    }
+    if (kept == 0) {
+        *out++ = '0';
+        *out = '\0';
+        return;
+    }
+    if (sticky) {
+        *out++ = '1';
+        --exponent;
+    }
+
+    // 指数部分, 与parse_decimal一样限制绝对值
+    if (s < end) {
+        ++s;
+        bool neg_power = false;
+        if (s < end && (*s == '+' || *s == '-')) {
+            neg_power = *s == '-';
+            ++s;
+        }
+        int64_t power = 0;
+        for (; s < end; ++s) {
+            if (power < 100000) {
+                power = power * 10 + (*s - '0');
+            }
+        }
+        exponent += neg_power ? -power : power;
+    }
+
+    if (exponent != 0) {
+        *out++ = 'e';
+        uint64_t value = static_cast<uint64_t>(exponent);
+        if (exponent < 0) {
+            *out++ = '-';
+            value = static_cast<uint64_t>(-exponent);
+        }
+        char tmp[24];
+        size_t n = 0;
+        do {
+            tmp[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (n > 0) {
+            *out++ = tmp[--n];
+        }
+    }
+    *out = '\0';
+}
+
+// 精确转换: 借助C库得到正确舍入的结果, 不分配内存
+inline float slow_decimal_to_float(const char* s, size_t len) {
+    char buf[KSLOW_DECIMAL_BUFFER];
+    format_slow_decimal(s, len, buf);
+    return std::strtof(buf, nullptr);
+}
+
+// double能精确表示的10的幂
+static const double KDOUBLE_POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// 快速转换, 无法保证正确舍入时返回false
+inline bool fast_decimal_to_float(const Decimal& dec, float* out) {
+    static const float KFLOAT_POW10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                         1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+    if (dec.truncated) {
+        return false;
+    }
+
+    if (dec.mantissa == 0) {
+        *out = dec.neg ? -0.0f : 0.0f;
+        return true;
+    }
+
+    // 尾数和10的幂都能被float精确表示, 一次运算只舍入一次
+    if (dec.mantissa <= (1ULL << 24) && dec.exponent >= -10 &&
+        dec.exponent <= 10) {
+        float f = static_cast<float>(dec.mantissa);
+        if (dec.exponent < 0) {
+            f /= KFLOAT_POW10[-dec.exponent];
+        } else {
+            f *= KFLOAT_POW10[dec.exponent];
+        }
+        *out = dec.neg ? -f : f;
+        return true;
+    }
+
+    // 先得到正确舍入的double, 再转为float
+    // 只有double结果恰好落在两个float的中点时, 二次舍入才可能出错
+    if (dec.mantissa <= (1ULL << 53) && dec.exponent >= -22 &&
+        dec.exponent <= 22) {
+        double d = static_cast<double>(dec.mantissa);
+        if (dec.exponent < 0) {
+            d /= KDOUBLE_POW10[-dec.exponent];
+        } else {
+            d *= KDOUBLE_POW10[dec.exponent];
+        }
+
+        float f = static_cast<float>(d);
+        if (static_cast<double>(f) != d) {
+            float other = std::nextafter(f, d > f ? HUGE_VALF : -HUGE_VALF);
+            double middle =
+                (static_cast<double>(f) + static_cast<double>(other)) / 2;
+            if (middle == d) {
+                return false;
+            }
+        }
+        *out = dec.neg ? -f : f;
+        return true;
+    }
+
+    return false;
+}
+
+// 精确转换: 借助C库得到正确舍入的结果, 不分配内存
+inline double slow_decimal_to_double(const char* s, size_t len) {
+    char buf[KSLOW_DECIMAL_BUFFER];
+    format_slow_decimal(s, len, buf);
+    return std::strtod(buf, nullptr);
+}
+
+// 快速转换, 尾数和10的幂都能被double精确表示时只舍入一次
+inline bool fast_decimal_to_double(const Decimal& dec, double* out) {
+
+    if (dec.truncated) {
+        return false;
+    }
+
+    if (dec.mantissa == 0) {
+        *out = dec.neg ? -0.0 : 0.0;
+        return true;
+    }
+
+    if (dec.mantissa <= (1ULL << 53) && dec.exponent >= -22 &&
+        dec.exponent <= 22) {
+        double d = static_cast<double>(dec.mantissa);
+        if (dec.exponent < 0) {
+            d /= KDOUBLE_POW10[-dec.exponent];
+        } else {
+            d *= KDOUBLE_POW10[dec.exponent];
+        }
+        *out = dec.neg ? -d : d;
+        return true;
+    }
+
+    return false;
+}
+
+// 解析float, 语法参见parse_decimal
+inline bool parse_float(const char* s, size_t len, float* out) {
+    Decimal dec;
+    if (!parse_decimal(s, len, &dec)) {
+        return false;
+    }
+
+    if (!fast_decimal_to_float(dec, out)) {
+        *out = slow_decimal_to_float(s, len);
+    }
+    return true;
+}
+
+// 解析double, 语法与float相同
+inline bool parse_double(const char* s, size_t len, double* out) {
+    Decimal dec;
+    if (!parse_decimal(s, len, &dec)) {
+        return false;
+    }
+
+    if (!fast_decimal_to_double(dec, out)) {
+        *out = slow_decimal_to_double(s, len);
+    }
+    return true;
+}
+
+// 与parse_float相同, 要求从s开始至少len + 8个字节可读
+inline bool parse_float_padded(const char* s, size_t len, float* out) {
+    Decimal dec;
+    if (!parse_simple_decimal(s, len, &dec)) {
+        return parse_float(s, len, out);
+    }
+
+    if (!fast_decimal_to_float(dec, out)) {
+        *out = slow_decimal_to_float(s, len);
+    }
+    return true;
+}
+
+// 与parse_double相同, 要求从s开始至少len + 8个字节可读
+inline bool parse_double_padded(const char* s, size_t len, double* out) {
+    Decimal dec;
+    if (!parse_simple_decimal(s, len, &dec)) {
+        return parse_double(s, len, out);
+    }
+
+    if (!fast_decimal_to_double(dec, out)) {
+        *out = slow_decimal_to_double(s, len);
+    }
+    return true;
+}
+
+// 解析布尔值: true/false/1/0
+inline bool parse_bool(const char* s, size_t len, bool* out) {
+    if ((len == 4 && std::memcmp(s, "true", 4) == 0) ||
+        (len == 1 && s[0] == '1')) {
+        *out = true;
+    } else if ((len == 5 && std::memcmp(s, "false", 5) == 0) ||
+               (len == 1 && s[0] == '0')) {
+        *out = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// 复制字符串到size大小的缓冲区, 需要为'\0'留出空间
+inline bool parse_string(const char* s, size_t len, char* out, size_t size) {
+    if (size < len + 1) {
+        return false;
+    }
+
+    std::memcpy(out, s, len);
+    out[len] = '\0';
+    return true;
+}
+}
+#endif  // TABLEPARSER_FIELD_PARSER_H
@@ -0,0 +1,147 @@
+#ifndef TABLEPARSER_HASH_INDEX_H
+#define TABLEPARSER_HASH_INDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+
+#include "table_parser.h"
+
+namespace tp {
+
+/**
+ * @brief KCLASS键列的哈希与比较函数
+ */
+struct IndexKeyOps {
+    /// @brief 计算字段的哈希值
+    uint64_t (*hash)(const void* field);
+    /// @brief 比较字段与键是否相等, 建索引时键为另一行的同一字段
+    bool (*equal)(const void* field, const void* key);
+};
+
+/**
+ * @brief 按键列建立的只读哈希索引
+ *
+ * 开放寻址线性探测, 每个槽位8字节, 保存键哈希的高32位和行号,
+ * 探测时先比较哈希再访问行数据, 通常一次缓存未命中即可定位.
+ * 支持的键列类型:
+ *   KINT/KINT64/KUINT32/KUINT64/KENUM   按整数值查找
+ *   KSTRING/KSTRING_VIEW/KSTRING_INTERN 按字符串查找
+ *   KCLASS                              按IndexKeyOps查找
+ * 重复的键保留行号最小的行. 索引不持有行数据, 行数据须在索引使用期间保持不变.
+ * 构造后只读, 可被多个线程共享
+ */
+class HashIndex {
+   public:
+    /// @brief 查找失败时的返回值
+    static const size_t KNPOS = static_cast<size_t>(-1);
+
+    HashIndex();
+
+    /**
+     * @brief 建立索引
+     * @param[in] rows 行数据
+     * @param[in] row_size 每行大小
+     * @param[in] row_count 行数, 不超过2^32 - 2
+     * @param[in] key 键列描述
+     * @param[in] ops KCLASS键列的哈希与比较函数, 其他类型忽略
+     * @param[in] threads 线程数, 0表示使用硬件并发数
+     * @return 键列类型不支持时返回false
+     */
+    bool build(const void* rows, size_t row_size, size_t row_count,
+               const ColumnDescriptor& key, const IndexKeyOps* ops = nullptr,
+               unsigned threads = 0);
+
+    /**
+     * @brief 为结构体数组建立索引
+     * @param[in] desc 列描述数组
+     * @param[in] key_column 键列下标
+     */
+    template <typename T>
+    bool build(const T* rows, size_t row_count, const ColumnDescriptor desc[],
+               size_t key_column, const IndexKeyOps* ops = nullptr,
+               unsigned threads = 0) {
+        return build(rows, sizeof(T), row_count, desc[key_column], ops,
+                     threads);
+    }
+
+    bool ok() const;
+
+    size_t size() const;
+
+    /**
+     * @brief 按整数键查找
+     * @return 行号, 不存在时返回KNPOS
+     */
+    size_t find(int64_t key) const;
+
+    /**
+     * @brief 按字符串键查找
+     * @param[in] s 键, 不要求以'\0'结尾
+     * @param[in] len 键长度
+     */
+    size_t find(const char* s, size_t len) const;
+
+    size_t find(const std::string& s) const { return find(s.data(), s.size()); }
+
+    /**
+     * @brief 按KCLASS键查找
+     * @param[in] key 传给IndexKeyOps的键
+     */
+    size_t find_key(const void* key) const;
+
+    /**
+     * @brief 查找并返回行数据
+     */
+    template <typename T, typename K>
+    const T* get(const K& key) const {
+        size_t row = find(key);
+        return row == KNPOS ? nullptr : reinterpret_cast<const T*>(row_at(row));
+    }
+
+   private:
+    enum KeyKind {
+        KKEY_NONE,
+        KKEY_INT,
+        KKEY_STRING,      // 定长char数组
+        KKEY_STRING_REF,  // StringRef
+        KKEY_CUSTOM
+    };
+
+    void insert_range(size_t begin, size_t end);
+
+    void insert(uint32_t row);
+
+    uint64_t row_hash(uint32_t row) const;
+
+    bool row_equal(uint32_t a, uint32_t b) const;
+
+    int64_t int_key(const char* field) const;
+
+    StringRef string_key(const char* field) const;
+
+    bool key_equal(const char* field, const void* key, size_t len) const;
+
+    const char* row_at(size_t row) const { return _rows + row * _row_size; }
+
+    const char* field(size_t row) const { return row_at(row) + _key.offset; }
+
+    size_t lookup(uint64_t hash, const void* key, size_t len) const;
+
+   private:
+    const char* _rows;
+    size_t _row_size;
+    size_t _row_count;
+    ColumnDescriptor _key;
+    IndexKeyOps _ops;
+    KeyKind _kind;
+
+    // 槽位: 高32位为哈希标签, 低32位为行号 + 1, 0表示空
+    std::unique_ptr<std::atomic<uint64_t>[]> _slots;
+    uint64_t _mask;
+};
+}
+#endif  // TABLEPARSER_HASH_INDEX_H
@@ -0,0 +1,131 @@
+#ifndef TABLEPARSER_INPUT_STREAM_H
+#define TABLEPARSER_INPUT_STREAM_H
+
+#include <cstddef>
+
+#include <istream>
+
+namespace tp {
+
+/**
+ * @brief 输入流接口
+ *
+ * 流式解析时TableParser通过该接口分块读取词表数据,
+ * 适用于管道、解压程序输出等无法mmap的输入
+ */
+class InputStream {
+   public:
+    virtual ~InputStream() {}
+
+    /**
+     * @brief 读取数据
+     * @param[out] buf 目的缓冲区
+     * @param[in] len 缓冲区大小
+     * @return 实际读取的字节数, 0表示输入结束, 负数表示读取出错
+     */
+    virtual long read(char* buf, size_t len) = 0;
+};
+
+/**
+ * @brief 基于文件描述符的输入流
+ *
+ * 不持有fd, 由调用者负责关闭
+ */
+class FdInputStream : public InputStream {
+   public:
+    explicit FdInputStream(int fd);
+
+    virtual long read(char* buf, size_t len);
+
+   private:
+    int _fd;
+};
+
+/**
+ * @brief 按路径打开的文件输入流
+ *
+ * 持有并在析构时关闭文件
+ */
+class FileInputStream : public InputStream {
+   public:
+    explicit FileInputStream(const char* path);
+
+    virtual ~FileInputStream();
+
+    /**
+     * @brief 文件是否成功打开
+     */
+    bool ok() const;
+
+    /**
+     * @brief 获取文件描述符, 打开失败时为-1
+     */
+    int fd() const;
+
+    virtual long read(char* buf, size_t len);
+
+   private:
+    FileInputStream(const FileInputStream&);
+    FileInputStream& operator=(const FileInputStream&);
+
+   private:
+    int _fd;
+};
+
+/**
+ * @brief 基于std::istream的输入流
+ */
+class IstreamInputStream : public InputStream {
+   public:
+    explicit IstreamInputStream(std::istream& in);
+
+    virtual long read(char* buf, size_t len);
+
+   private:
+    std::istream& _in;
+};
+
+/**
+ * @brief 只读映射的文件
+ *
+ * 文件内容之后至少还有一页0, 数据总以'\0'结尾且可以安全地多读,
+ * 可直接交给TableParser或parse_all_parallel解析. KSTRING_VIEW列指向
+ * 映射内存, 在close()或析构前有效. 映射期间文件被原地截断时访问会
+ * 触发SIGBUS, 适用于以rename方式整体替换的文件
+ */
+class MappedFile {
+   public:
+    MappedFile();
+
+    ~MappedFile();
+
+    /**
+     * @brief 映射文件, 之前的映射先被关闭
+     * @param[in] path 文件路径
+     * @return 文件不存在、不是普通文件或映射失败时返回false
+     */
+    bool open(const char* path);
+
+    void close();
+
+    /**
+     * @brief 文件内容, 未映射时为空字符串
+     */
+    const char* data() const;
+
+    /**
+     * @brief 文件大小, 不含结尾的'\0'
+     */
+    size_t size() const;
+
+   private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+   private:
+    void* _addr;
+    size_t _length;  // 映射的总长度, 包括结尾的0页
+    size_t _size;
+};
+}
+#endif  // TABLEPARSER_INPUT_STREAM_H
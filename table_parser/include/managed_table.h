@@ -0,0 +1,432 @@
+#ifndef TABLEPARSER_MANAGED_TABLE_H
+#define TABLEPARSER_MANAGED_TABLE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "hash_index.h"
+#include "snapshot.h"
+#include "table_parser.h"
+
+namespace tp {
+
+/**
+ * @brief 基于纪元的读者登记
+ *
+ * 读者进入时在独立缓存行的槽位中登记当前纪元, 离开时清除, 读路径上
+ * 没有锁和共享计数. 写者替换数据后推进纪元, 所有登记纪元不大于替换
+ * 纪元的读者离开后, 旧数据即可释放.
+ *
+ * 槽位数在构造时指定. 槽位全部被占用时, 多出的读者不等待, 而是登记到
+ * 一个共享的溢出计数上; 溢出计数不为0期间写者无法确定这些读者的纪元,
+ * 不释放任何旧数据, 直到它们全部离开. 同时活跃的读者经常超过槽位数时
+ * 应增大槽位数
+ */
+class EpochManager {
+   public:
+    /// @brief 默认的读者槽位数
+    static const size_t KDEFAULT_READERS = 64;
+    /// @brief enter()返回该值时表示读者登记在溢出计数上
+    static const size_t KOVERFLOW_SLOT = static_cast<size_t>(-1);
+
+    /**
+     * @param[in] slots 读者槽位数, 为0时使用KDEFAULT_READERS
+     */
+    explicit EpochManager(size_t slots = KDEFAULT_READERS);
+
+    /**
+     * @brief 读者进入, 不会阻塞或自旋
+     * @return 占用的槽位, 传给leave
+     */
+    size_t enter();
+
+    /**
+     * @brief 读者离开
+     */
+    void leave(size_t slot);
+
+    /**
+     * @brief 推进纪元
+     * @return 推进前的纪元, 在此之前发布的数据在safe_epoch()超过它后可释放
+     */
+    uint64_t advance();
+
+    /**
+     * @brief 获取活跃读者中最小的纪元, 没有活跃读者时为当前纪元;
+     * 有溢出读者时为0
+     */
+    uint64_t safe_epoch() const;
+
+   private:
+    EpochManager(const EpochManager&);
+    EpochManager& operator=(const EpochManager&);
+
+   private:
+    struct Slot {
+        std::atomic<uint64_t> epoch;  // 0表示空闲
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    size_t _slot_count;
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<uint64_t> _epoch;
+    std::atomic<uint64_t> _overflow;  // 登记在溢出计数上的读者数
+};
+
+/**
+ * @brief 热加载选项
+ */
+struct ReloadOptions {
+    /// @brief 允许的最大错误行比例, 超过时拒绝新版本并保留旧版本
+    double max_error_rate;
+    /// @brief 检查源文件变化的间隔
+    unsigned poll_interval_ms;
+    /// @brief 保留的错误信息条数
+    size_t max_errors_kept;
+    /// @brief 建立HashIndex的键列下标, 为-1时不建索引
+    int key_column;
+    /// @brief KCLASS键列的哈希与比较函数
+    const IndexKeyOps* key_ops;
+    /// @brief 读者槽位数, 应不小于同时持有ReadGuard的线程数, 见EpochManager
+    size_t reader_slots;
+
+    ReloadOptions()
+        : max_error_rate(0.0),
+          poll_interval_ms(1000),
+          max_errors_kept(16),
+          key_column(-1),
+          key_ops(nullptr),
+          reader_slots(EpochManager::KDEFAULT_READERS) {}
+};
+
+/**
+ * @brief 自动热加载的词表
+ * @tparam T 解析输出结构体类型
+ *
+ * 后台线程监视源文件的大小、修改时间和inode, 变化时在后台重新解析,
+ * 错误率不超过阈值才原子替换为新版本. 读者通过ReadGuard访问当前版本,
+ * 只在自己的槽位上登记纪元; 旧版本在所有可能持有它的读者离开后释放.
+ * ReadGuard应当短暂持有, 不能长于ManagedTable. 同时活跃的读者超过
+ * ReloadOptions::reader_slots时读取仍不阻塞, 但旧版本要等这些读者
+ * 全部离开才能释放
+ */
+template <typename T>
+class ManagedTable {
+   private:
+    struct Version {
+        std::vector<T> rows;
+        HashIndex index;
+        uint64_t generation;
+        SourceStamp stamp;
+    };
+
+   public:
+    /**
+     * @brief 读访问守卫, 生命期内看到的版本不变且不会被释放
+     */
+    class ReadGuard {
+       public:
+        explicit ReadGuard(const ManagedTable& table)
+            : _epoch(table._epoch), _slot(_epoch.enter()),
+              _version(table._current.load()) {}
+
+        ~ReadGuard() { _epoch.leave(_slot); }
+
+        const std::vector<T>& rows() const { return _version->rows; }
+
+        /**
+         * @brief 键列索引, 未配置key_column时无效
+         */
+        const HashIndex& index() const { return _version->index; }
+
+        /**
+         * @brief 版本号, 0表示尚未加载成功
+         */
+        uint64_t generation() const { return _version->generation; }
+
+       private:
+        ReadGuard(const ReadGuard&);
+        ReadGuard& operator=(const ReadGuard&);
+
+       private:
+        EpochManager& _epoch;
+        size_t _slot;
+        const Version* _version;
+    };
+
+    /**
+     * @param[in] path 源文件路径
+     * @param[in] desc 列描述数组, 生命期须长于ManagedTable
+     * @param[in] options 热加载选项
+     *
+     * 构造时不加载数据, 调用reload()或start()后开始加载
+     */
+    ManagedTable(const char* path, const ColumnDescriptor desc[],
+                 const ReloadOptions& options = ReloadOptions())
+        : _path(path),
+          _desc(desc),
+          _plan(desc, sizeof(T)),
+          _options(options),
+          _epoch(options.reader_slots),
+          _current(&_empty),
+          _rejected(),
+          _has_rejected(false),
+          _stopping(false) {
+        _empty.generation = 0;
+        _empty.stamp = SourceStamp();
+    }
+
+    ~ManagedTable() {
+        stop();
+        Version* current = _current.load();
+        if (current != &_empty) {
+            delete current;
+        }
+        for (size_t i = 0; i < _retired.size(); ++i) {
+            delete _retired[i].second;
+        }
+    }
+
+    /**
+     * @brief 检查源文件并在变化时重新加载
+     * @param[in] force 为true时不论源文件是否变化都重新加载
+     * @return 是否发布了新版本, 失败原因见last_errors()
+     *
+     * 错误率过高或无法建索引的文件会被记住, 变化之前不再重新解析
+     */
+    bool reload(bool force = false) {
+        std::lock_guard<std::mutex> writer(_writer_mutex);
+
+        if (!_plan.ok()) {
+            set_errors("invalid column descriptor");
+            return false;
+        }
+
+        SourceStamp stamp;
+        if (!stat_source(_path.c_str(), &stamp)) {
+            set_errors("cannot stat source file");
+            return false;
+        }
+
+        Version* current = _current.load();
+        if (!force && current != &_empty && same_source(current->stamp, stamp)) {
+            return false;
+        }
+
+        // 未通过校验的文件在变化之前不再重复解析, last_errors()保持不变
+        if (!force && _has_rejected && same_source(_rejected, stamp)) {
+            return false;
+        }
+
+        std::unique_ptr<Version> version(new Version());
+        std::vector<std::string> errors;
+        bool rejected = false;
+        if (!load(*version, errors, &rejected)) {
+            // 打开或读取失败可能是暂时的, 只记住内容本身不合格的文件
+            if (rejected) {
+                _rejected = stamp;
+                _has_rejected = true;
+            }
+            set_errors(errors);
+            return false;
+        }
+
+        // 解析期间源文件发生变化时放弃, 等待下次检查
+        SourceStamp after;
+        if (!stat_source(_path.c_str(), &after) || !same_source(after, stamp)) {
+            set_errors("source file changed during reload");
+            return false;
+        }
+
+        version->generation = current->generation + 1;
+        version->stamp = stamp;
+        _has_rejected = false;
+        _current.store(version.release());
+        uint64_t epoch = _epoch.advance();
+        if (current != &_empty) {
+            _retired.push_back(std::make_pair(epoch, current));
+        }
+        reclaim();
+
+        set_errors(errors);
+        return true;
+    }
+
+    /**
+     * @brief 启动后台监视线程, 首次检查立即进行
+     */
+    void start() {
+        std::lock_guard<std::mutex> lock(_watch_mutex);
+        if (_watcher.joinable()) {
+            return;
+        }
+        _stopping = false;
+        _watcher = std::thread(&ManagedTable::watch, this);
+    }
+
+    /**
+     * @brief 停止后台监视线程
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_watch_mutex);
+            _stopping = true;
+        }
+        _cond.notify_all();
+        if (_watcher.joinable()) {
+            _watcher.join();
+        }
+    }
+
+    /**
+     * @brief 当前版本号, 0表示尚未加载成功
+     */
+    uint64_t generation() const { return _current.load()->generation; }
+
+    /**
+     * @brief 最近一次加载的错误信息
+     *
+     * 加载成功时为被跳过的错误行, 加载失败时为失败原因
+     */
+    std::vector<std::string> last_errors() const {
+        std::lock_guard<std::mutex> lock(_status_mutex);
+        return _errors;
+    }
+
+   private:
+    ManagedTable(const ManagedTable&);
+    ManagedTable& operator=(const ManagedTable&);
+
+    /**
+     * @brief 解析源文件并校验
+     * @param[out] rejected 文件内容未通过校验时置为true
+     */
+    bool load(Version& version, std::vector<std::string>& errors,
+              bool* rejected) {
+        FileInputStream in(_path.c_str());
+        if (!in.ok()) {
+            errors.push_back("cannot open source file");
+            return false;
+        }
+
+        TableParser parser(&in, _plan);
+        std::vector<ParseError> parse_errors;
+        parse_all(parser, version.rows, parse_errors);
+
+        // 读取失败时数据不完整, 不论错误率都不能发布
+        for (size_t i = 0; i < parse_errors.size(); ++i) {
+            if (parse_errors[i].code == KERR_READ_FAILED) {
+                errors.push_back(parse_errors[i].message());
+                return false;
+            }
+        }
+
+        size_t error_count = parse_errors.size();
+        for (size_t i = 0; i < error_count && i < _options.max_errors_kept;
+             ++i) {
+            errors.push_back(parse_errors[i].message());
+        }
+
+        size_t total = version.rows.size() + error_count;
+        if (error_count > 0 && static_cast<double>(error_count) >
+                                   _options.max_error_rate *
+                                       static_cast<double>(total)) {
+            char buf[128];
+            snprintf(buf, sizeof(buf), "error rate too high: %zu of %zu lines",
+                     error_count, total);
+            errors.insert(errors.begin(), buf);
+            *rejected = true;
+            return false;
+        }
+
+        if (_options.key_column >= 0 &&
+            !version.index.build(
+                version.rows.empty() ? nullptr : &version.rows[0],
+                version.rows.size(), _desc,
+                static_cast<size_t>(_options.key_column), _options.key_ops)) {
+            errors.insert(errors.begin(), "cannot build key index");
+            *rejected = true;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 释放不再被任何读者持有的旧版本, 调用时须持有_writer_mutex
+     */
+    void reclaim() {
+        uint64_t safe = _epoch.safe_epoch();
+        size_t kept = 0;
+        for (size_t i = 0; i < _retired.size(); ++i) {
+            if (_retired[i].first < safe) {
+                delete _retired[i].second;
+            } else {
+                _retired[kept++] = _retired[i];
+            }
+        }
+        _retired.resize(kept);
+    }
+
+    void watch() {
+        while (true) {
+            reload();
+            {
+                std::lock_guard<std::mutex> writer(_writer_mutex);
+                reclaim();
+            }
+
+            std::unique_lock<std::mutex> lock(_watch_mutex);
+            if (_cond.wait_for(
+                    lock, std::chrono::milliseconds(_options.poll_interval_ms),
+                    [this] { return _stopping; })) {
+                break;
+            }
+        }
+    }
+
+    void set_errors(const char* error) {
+        set_errors(std::vector<std::string>(1, error));
+    }
+
+    void set_errors(const std::vector<std::string>& errors) {
+        std::lock_guard<std::mutex> lock(_status_mutex);
+        _errors = errors;
+    }
+
+   private:
+    std::string _path;
+    const ColumnDescriptor* _desc;
+    ParsePlan _plan;
+    ReloadOptions _options;
+
+    mutable EpochManager _epoch;
+    std::atomic<Version*> _current;
+    Version _empty;  // 加载成功前的空版本, 不会被释放
+
+    // 串行化写者, 保护_retired和_rejected
+    std::mutex _writer_mutex;
+    std::vector<std::pair<uint64_t, Version*> > _retired;
+    SourceStamp _rejected;  // 最近一个未通过校验的源文件
+    bool _has_rejected;
+
+    mutable std::mutex _status_mutex;
+    std::vector<std::string> _errors;
+
+    std::mutex _watch_mutex;
+    std::condition_variable _cond;
+    bool _stopping;
+    std::thread _watcher;
+};
+}
+#endif  // TABLEPARSER_MANAGED_TABLE_H
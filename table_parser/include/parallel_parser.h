@@ -0,0 +1,162 @@
+#ifndef TABLEPARSER_PARALLEL_PARSER_H
+#define TABLEPARSER_PARALLEL_PARSER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "table_parser.h"
+
+namespace tp {
+
+/**
+ * @brief 按行切分的输入分段
+ */
+struct TextChunk {
+    const char* begin;    ///@brief 分段开始位置, 总是行首
+    const char* end;      ///@brief 分段结束位置, 总是行首或输入结尾
+    unsigned first_line;  ///@brief 分段第一行的全局行号
+    size_t max_rows;      ///@brief 分段最多能解析出的行数, 即其中的行数
+};
+
+/**
+ * @brief 在换行符处把输入切分为若干分段
+ * @param[in] src 以'\0'结尾的输入数据
+ * @param[in] len 输入长度, 不含结尾的'\0'
+ * @param[in] max_chunks 最多切分的段数
+ * @param[in] min_chunk_size 每段的最小字节数
+ * @param[in] threads 统计行号时使用的线程数
+ * @param[out] chunks 输出分段, 按源顺序排列
+ */
+void split_chunks(const char* src, size_t len, size_t max_chunks,
+                  size_t min_chunk_size, unsigned threads,
+                  std::vector<TextChunk>& chunks);
+
+/**
+ * @brief 获取默认的并行线程数
+ */
+unsigned default_thread_count();
+
+/**
+ * @brief 多线程解析所有数据
+ * @tparam T 解析输出结构体类型
+ * @param[in] src 以'\0'结尾的输入数据
+ * @param[in] len 输入长度, 不含结尾的'\0'
+ * @param[in] desc 列描述数组
+ * @param[in,out] out 输出数组, 按源顺序追加
+ * @param[in,out] err 输出错误, 按源顺序追加, 行号和偏移均相对整个输入
+ * @param[in] threads 线程数, 0表示使用硬件并发数
+ * @param[in,out] stats 不为nullptr时累加解析统计, nanos为整个调用的耗时
+ * @return 解析成功数
+ *
+ * 结果与parse_all完全一致. out按行数一次扩容, 各线程直接解析到其中
+ * 属于自己的一段, 只有分段中有失败或空行时才需要把后面的结果前移
+ */
+template <typename T, typename E>
+unsigned parse_all_parallel(const char* src, size_t len,
+                            const ColumnDescriptor desc[], std::vector<T>& out,
+                            std::vector<E>& err, unsigned threads = 0,
+                            ParseStats* stats = nullptr) {
+    static const size_t KMIN_CHUNK_SIZE = 256 * 1024;
+    // 每个线程多分几段以平衡负载
+    static const size_t KCHUNKS_PER_THREAD = 4;
+
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+
+    uint64_t begin_ns = stats ? stats_clock_ns() : 0;
+    std::vector<TextChunk> chunks;
+    split_chunks(src, len, threads * KCHUNKS_PER_THREAD, KMIN_CHUNK_SIZE,
+                 threads, chunks);
+
+    // 每段在out中的起始位置
+    std::vector<size_t> chunk_pos(chunks.size(), 0);
+    size_t total = out.size();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunk_pos[i] = total;
+        total += chunks[i].max_rows;
+    }
+    out.resize(total);
+
+    std::vector<std::vector<ParseError> > chunk_err(chunks.size());
+    std::vector<size_t> chunk_rows(chunks.size(), 0);
+    std::vector<ParseStats> chunk_stats(stats ? chunks.size() : 0);
+
+    // 所有线程共享同一个解析计划
+    ParsePlan plan(desc, sizeof(T));
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) {
+            if (chunks[i].max_rows == 0) {
+                continue;
+            }
+            TableParser tb_parser(chunks[i].begin, chunks[i].end, plan,
+                                  chunks[i].first_line);
+            if (stats) {
+                tb_parser.set_stats(&chunk_stats[i]);
+            }
+            // 成功的行数不会超过分段行数, 一次即可解析完
+            BatchResult result = tb_parser.parse_batch(
+                &out[chunk_pos[i]], chunks[i].max_rows, &chunk_err[i]);
+            chunk_rows[i] = result.rows;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads && i < chunks.size(); ++i) {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    // 按源顺序紧凑结果, 目的位置总不晚于原位置, 原地前移即可
+    unsigned ret = 0;
+    size_t pos = chunks.empty() ? out.size() : chunk_pos[0];
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (pos != chunk_pos[i]) {
+            std::move(out.begin() + static_cast<ptrdiff_t>(chunk_pos[i]),
+                      out.begin() +
+                          static_cast<ptrdiff_t>(chunk_pos[i] + chunk_rows[i]),
+                      out.begin() + static_cast<ptrdiff_t>(pos));
+        }
+        pos += chunk_rows[i];
+
+        size_t base = static_cast<size_t>(chunks[i].begin - src);
+        for (size_t j = 0; j < chunk_err[i].size(); ++j) {
+            chunk_err[i][j].offset += base;
+            append_error(err, chunk_err[i][j]);
+        }
+        ret += static_cast<unsigned>(chunk_rows[i]);
+    }
+    out.resize(pos);
+
+    // 各分段同时解析, 耗时取整个调用的时间
+    if (stats && stats_enabled()) {
+        stats->merge_concurrent(chunk_stats, stats_clock_ns() - begin_ns);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief 多线程解析以'\0'结尾的数据
+ *
+ * 需要先计算输入长度, 已知长度时应使用带len的版本
+ */
+template <typename T, typename E>
+unsigned parse_all_parallel(const char* src, const ColumnDescriptor desc[],
+                            std::vector<T>& out, std::vector<E>& err,
+                            unsigned threads = 0,
+                            ParseStats* stats = nullptr) {
+    return parse_all_parallel(src, std::strlen(src), desc, out, err, threads,
+                              stats);
+}
+}
+#endif  // TABLEPARSER_PARALLEL_PARSER_H
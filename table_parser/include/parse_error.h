@@ -0,0 +1,82 @@
+#ifndef TABLEPARSER_PARSE_ERROR_H
+#define TABLEPARSER_PARSE_ERROR_H
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+namespace tp {
+
+/**
+ * @brief 解析错误码
+ *
+ * KERR_OK到KERR_MORE_ARRAY_ELEMENT为数据错误, 与编译期schema的FieldError
+ * 取值一致; 其余为输入或列描述错误
+ */
+enum ErrorCode {
+    KERR_OK = 0,
+    KERR_ELEMENT_REQUIRED,       ///@brief 输入行已结束, 缺少该列
+    KERR_MORE_ELEMENT,           ///@brief 所有列解析完后仍有多余数据
+    KERR_PARSE_FAILED,           ///@brief 列内容解析失败
+    KERR_SIZE_REQUIRED,          ///@brief 缺少数组大小
+    KERR_UNEXPECTED_CHAR,        ///@brief 数组大小后不是':'
+    KERR_SIZE_OUT_OF_RANGE,      ///@brief 数组大小超过数组容量
+    KERR_UNEXPECTED_TAB,         ///@brief 数组元素个数不足, 遇到列分隔符
+    KERR_UNEXPECTED_EOF,         ///@brief 数组元素个数不足, 遇到输入结尾
+    KERR_UNEXPECTED_NEWLINE,     ///@brief 数组元素个数不足, 遇到换行符
+    KERR_MORE_ARRAY_ELEMENT,     ///@brief 数组元素个数多于数组大小
+    KERR_READ_FAILED,            ///@brief 读取输入流失败
+    KERR_OUT_OF_BOUNDARY,        ///@brief 列的内存超出结构体范围
+    KERR_CALLBACK_REQUIRED,      ///@brief KCLASS列缺少回调函数
+    KERR_ENUM_TABLE_REQUIRED,    ///@brief KENUM列缺少枚举表
+    KERR_STRING_ARENA_REQUIRED,  ///@brief KSTRING_INTERN列缺少StringArena
+    KERR_UNKNOWN_TYPE,           ///@brief 未知的列类型
+    KERR_NO_ROW_LAYOUT,          ///@brief 解析计划不对应结构体
+    KERR_ROW_TOO_SMALL,          ///@brief 输出小于解析计划的结构体大小
+    KERR_STRING_VIEW_IN_STREAM,  ///@brief 流式解析不支持KSTRING_VIEW列
+    KERR_FILTER_COLUMN           ///@brief 过滤条件引用了不存在的列
+};
+
+/// @brief 错误码个数, 新增错误码时同步修改
+static const size_t KERROR_CODE_COUNT = KERR_FILTER_COLUMN + 1;
+
+/**
+ * @brief 错误码的名字, 如"PARSE_FAILED"
+ */
+const char* error_code_name(ErrorCode code);
+
+/**
+ * @brief 一行的解析结果
+ *
+ * 只记录错误码和位置, 文本在需要时才格式化
+ */
+struct ParseError {
+    ErrorCode code;
+    unsigned line;    ///@brief 行号, 从1开始
+    unsigned column;  ///@brief 出错的列下标
+    size_t offset;    ///@brief 出错位置相对输入开头的字节偏移
+
+    /**
+     * @brief 格式化为"[ERROR] line N: ..."形式的文本
+     * @return 同snprintf
+     */
+    int format(char* buf, size_t size) const;
+
+    std::string message() const;
+};
+
+/**
+ * @brief 向错误列表追加一条错误
+ *
+ * parse_all系列函数通过重载同时支持结构化错误和文本错误
+ */
+inline void append_error(std::vector<ParseError>& err, const ParseError& e) {
+    err.push_back(e);
+}
+
+inline void append_error(std::vector<std::string>& err, const ParseError& e) {
+    err.push_back(e.message());
+}
+}
+#endif  // TABLEPARSER_PARSE_ERROR_H
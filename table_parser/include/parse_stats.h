@@ -0,0 +1,98 @@
+#ifndef TABLEPARSER_PARSE_STATS_H
+#define TABLEPARSER_PARSE_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include "parse_error.h"
+
+namespace tp {
+
+/// @brief 列类型个数, 与DataType同步
+static const size_t KDATA_TYPE_COUNT = 13;
+
+/**
+ * @brief 库是否以TP_ENABLE_STATS编译
+ *
+ * 未打开时解析路径上没有任何统计代码, 设置的ParseStats保持为空
+ */
+bool stats_enabled();
+
+/**
+ * @brief 统计使用的单调时钟, 单位为纳秒
+ */
+uint64_t stats_clock_ns();
+
+/**
+ * @brief 一列或一种类型的字段统计
+ */
+struct FieldStats {
+    uint64_t calls;         ///@brief 解析的字段数
+    uint64_t nanos;         ///@brief 耗时, 包括定位分隔符和调用回调
+    uint64_t bytes;         ///@brief 字段总字节数
+    size_t longest;         ///@brief 最长字段的字节数
+    unsigned longest_line;  ///@brief 最长字段所在行号
+};
+
+/**
+ * @brief 解析统计
+ *
+ * 通过TableParser::set_stats设置, 多次解析的结果累加. 单个对象只能
+ * 被一个解析器使用, 多线程解析时每个线程使用独立的对象再merge
+ */
+struct ParseStats {
+    uint64_t rows;           ///@brief 处理的行数, 包括失败和被过滤的行
+    uint64_t ok_rows;        ///@brief 成功的行数
+    uint64_t failed_rows;    ///@brief 失败的行数
+    uint64_t filtered_rows;  ///@brief 被RowFilter跳过的行数
+    uint64_t bytes;          ///@brief 处理的字节数, 包括换行符
+    uint64_t nanos;          ///@brief 经过的时间, 多线程解析时为整个调用的耗时
+    uint64_t cpu_nanos;      ///@brief 各线程解析耗时之和, 流式解析时包括读取时间
+    size_t longest_line;     ///@brief 最长行的字节数, 不包括换行符
+    unsigned longest_line_no;  ///@brief 最长行的行号
+
+    /// @brief 按列下标统计
+    std::vector<FieldStats> columns;
+    /// @brief 按列类型统计, 下标为DataType; KCLASS为用户回调
+    FieldStats types[KDATA_TYPE_COUNT];
+    /// @brief 按错误码统计失败的行数, 下标为ErrorCode
+    uint64_t errors[KERROR_CODE_COUNT];
+
+    ParseStats();
+
+    /**
+     * @brief 清空所有统计
+     */
+    void reset();
+
+    /**
+     * @brief 累加另一份统计
+     *
+     * nanos直接相加, 适用于先后进行的解析; 合并同时进行的多线程结果时
+     * 应在合并后把nanos改为整个调用的耗时, 见merge_concurrent
+     */
+    void merge(const ParseStats& other);
+
+    /**
+     * @brief 合并同时进行的多份统计
+     * @param[in] parts 各线程的统计
+     * @param[in] wall_nanos 整个调用经过的时间
+     */
+    void merge_concurrent(const std::vector<ParseStats>& parts,
+                          uint64_t wall_nanos);
+
+    /**
+     * @brief 每秒处理的行数, 按经过的时间计算, 没有耗时记录时为0
+     */
+    double rows_per_second() const;
+
+    /**
+     * @brief 格式化为多行文本
+     */
+    std::string dump() const;
+};
+}
+#endif  // TABLEPARSER_PARSE_STATS_H
@@ -0,0 +1,310 @@
+#ifndef TABLEPARSER_PIPELINED_INPUT_H
+#define TABLEPARSER_PIPELINED_INPUT_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "input_stream.h"
+#include "parallel_parser.h"
+#include "table_parser.h"
+
+struct z_stream_s;
+
+namespace tp {
+
+/**
+ * @brief gzip解压输入流
+ *
+ * 自动识别gzip和zlib格式, 支持多个gzip成员首尾相接的文件
+ */
+class GzipInputStream : public InputStream {
+   public:
+    /// @brief 默认的压缩数据读取块大小
+    static const size_t KDEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * @brief 构造函数
+     * @param[in] in 压缩数据输入流, 生命周期须长于本对象
+     * @param[in] buffer_size 单次读取压缩数据的大小
+     */
+    explicit GzipInputStream(InputStream* in,
+                             size_t buffer_size = KDEFAULT_BUFFER_SIZE);
+
+    virtual ~GzipInputStream();
+
+    /**
+     * @brief 解压器是否初始化成功
+     */
+    bool ok() const;
+
+    /**
+     * @brief 读取解压后的数据
+     * @return 数据损坏、被截断或底层读取出错时返回负数
+     */
+    virtual long read(char* buf, size_t len);
+
+   private:
+    GzipInputStream(const GzipInputStream&);
+    GzipInputStream& operator=(const GzipInputStream&);
+
+   private:
+    InputStream* _in;
+    z_stream_s* _zs;
+    std::vector<char> _buf;
+    bool _in_eof;     // 压缩数据已读完
+    bool _member_end;  // 刚结束一个gzip成员
+    bool _failed;
+};
+
+/**
+ * @brief 流水线中按行对齐的数据块
+ */
+struct TextBlock {
+    std::vector<char> data;  ///@brief 块数据, 末尾附加'\0'
+    size_t size;             ///@brief 数据长度, 不含末尾的'\0'
+    size_t offset;           ///@brief 块在整个输入中的字节偏移
+    unsigned first_line;     ///@brief 块第一行的全局行号
+    size_t seq;              ///@brief 块序号, 从0开始
+};
+
+/**
+ * @brief 读取与解析的流水线
+ *
+ * 后台读取线程从输入流(通常是解压流)读取数据, 在换行符处切分为块,
+ * 放入固定数量的环形槽位; 解析线程按序取走完整的块. 跨块的行由读取
+ * 线程拼接到下一块, 因此每块都只包含完整的行. 所有槽位都被占用时读取
+ * 线程等待, 内存占用为O(ring_size * (block_size + 最长行))
+ */
+class BlockPipeline {
+   public:
+    /// @brief 默认块大小
+    static const size_t KDEFAULT_BLOCK_SIZE = 1024 * 1024;
+    /// @brief 默认槽位数
+    static const size_t KDEFAULT_RING_SIZE = 4;
+
+    /**
+     * @brief 构造函数, 立即启动读取线程
+     * @param[in] in 输入流, 生命周期须长于本对象
+     * @param[in] block_size 目标块大小, 行比块长时块会相应扩大
+     * @param[in] ring_size 槽位数, 至少为2
+     */
+    explicit BlockPipeline(InputStream* in,
+                           size_t block_size = KDEFAULT_BLOCK_SIZE,
+                           size_t ring_size = KDEFAULT_RING_SIZE);
+
+    /**
+     * @brief 析构函数, 停止并等待读取线程
+     */
+    ~BlockPipeline();
+
+    /**
+     * @brief 按序取下一个块
+     * @return 输入结束时返回nullptr
+     *
+     * 可以被多个线程并发调用, 用完后须调用release归还槽位
+     */
+    const TextBlock* acquire();
+
+    /**
+     * @brief 归还槽位
+     */
+    void release(const TextBlock* block);
+
+    /**
+     * @brief 输入流是否读取出错, acquire返回nullptr之后有效
+     */
+    bool failed() const;
+
+    /**
+     * @brief 已读取的总字节数, acquire返回nullptr之后有效
+     */
+    size_t total_bytes() const;
+
+    /**
+     * @brief 已读取数据之后的下一行行号, acquire返回nullptr之后有效
+     */
+    unsigned next_line() const;
+
+   private:
+    BlockPipeline(const BlockPipeline&);
+    BlockPipeline& operator=(const BlockPipeline&);
+
+    // 读取线程主循环
+    void run();
+
+    // 填充一个块, 返回false表示没有数据; 输入结束或出错时设置_in_eof
+    bool fill(TextBlock& block, bool* failed);
+
+   private:
+    InputStream* _in;
+    size_t _block_size;
+    std::vector<TextBlock> _slots;
+    std::deque<TextBlock*> _free;
+    std::deque<TextBlock*> _ready;
+    std::vector<char> _carry;  // 上一块末尾未结束的行
+    size_t _offset;
+    unsigned _line;
+    size_t _seq;
+    bool _in_eof;   // 输入已读完, 只由读取线程访问
+    bool _done;     // 读取线程已结束
+    bool _stopped;  // 要求读取线程退出
+    bool _failed;
+    mutable std::mutex _mutex;
+    std::condition_variable _slot_freed;
+    std::condition_variable _block_ready;
+    std::thread _reader;
+};
+
+/**
+ * @brief 基于流水线的输入流
+ *
+ * 读取(如解压)在后台线程中进行, 与调用方的流式解析重叠
+ */
+class PipelinedInputStream : public InputStream {
+   public:
+    explicit PipelinedInputStream(
+        InputStream* in, size_t block_size = BlockPipeline::KDEFAULT_BLOCK_SIZE,
+        size_t ring_size = BlockPipeline::KDEFAULT_RING_SIZE);
+
+    virtual ~PipelinedInputStream();
+
+    virtual long read(char* buf, size_t len);
+
+   private:
+    PipelinedInputStream(const PipelinedInputStream&);
+    PipelinedInputStream& operator=(const PipelinedInputStream&);
+
+   private:
+    BlockPipeline _pipeline;
+    const TextBlock* _block;
+    size_t _pos;
+};
+
+/**
+ * @brief 边读取边多线程解析
+ * @tparam T 解析输出结构体类型
+ * @param[in] in 输入流, 通常是GzipInputStream
+ * @param[in] desc 列描述数组
+ * @param[in,out] out 输出数组, 按源顺序追加
+ * @param[in,out] err 输出错误, 按源顺序追加, 行号和偏移均相对整个输入
+ * @param[in] threads 解析线程数, 0表示使用硬件并发数
+ * @param[in] block_size 流水线块大小
+ * @param[in,out] stats 不为nullptr时累加解析统计, nanos为整个调用的耗时
+ * @return 解析成功数
+ *
+ * 读取线程与解析线程同时工作, 总耗时接近两者中较慢的一方. 每块解析完成
+ * 后即按源顺序并入out并释放, 不在最后统一复制;
+ * 结果与对解压后的全部数据调用parse_all一致.
+ * 含KSTRING_VIEW列时不读取输入, 只报告一个KERR_STRING_VIEW_IN_STREAM
+ */
+template <typename T, typename E>
+unsigned parse_all_pipelined(
+    InputStream& in, const ColumnDescriptor desc[], std::vector<T>& out,
+    std::vector<E>& err, unsigned threads = 0,
+    size_t block_size = BlockPipeline::KDEFAULT_BLOCK_SIZE,
+    ParseStats* stats = nullptr) {
+    uint64_t begin_ns = stats ? stats_clock_ns() : 0;
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+    // 每个解析线程一份统计, 结束后合并
+    std::vector<ParseStats> thread_stats(stats ? threads : 0);
+
+    // 块在解析后即被复用, 字符串引用会失效, 不启动流水线直接报告
+    ParsePlan plan(desc, sizeof(T));
+    if (plan.has_string_view()) {
+        ParseError e = {KERR_STRING_VIEW_IN_STREAM, 1, 0, 0};
+        append_error(err, e);
+        if (stats && stats_enabled()) {
+            ++stats->errors[KERR_STRING_VIEW_IN_STREAM];
+        }
+        return 0;
+    }
+
+    // 每个解析线程一个槽位, 另留两个给读取线程轮换
+    BlockPipeline pipeline(&in, block_size, threads + 2);
+
+    // 已解析但前面还有块未完成的结果, pending[i]对应块序号merged + i
+    struct BlockResult {
+        std::vector<T> out;
+        std::vector<ParseError> err;
+        unsigned ret;
+        size_t offset;
+        bool done;
+
+        BlockResult() : ret(0), offset(0), done(false) {}
+    };
+    std::deque<BlockResult> pending;
+    size_t merged = 0;
+    unsigned ret = 0;
+    std::mutex merge_mutex;
+
+    auto worker = [&](unsigned thread) {
+        BlockResult result;
+        const TextBlock* block = nullptr;
+        while ((block = pipeline.acquire()) != nullptr) {
+            TableParser tb_parser(&block->data[0], &block->data[block->size],
+                                  plan, block->first_line);
+            if (stats) {
+                tb_parser.set_stats(&thread_stats[thread]);
+            }
+            result.out.clear();
+            result.err.clear();
+            result.ret = parse_all(tb_parser, result.out, result.err);
+            result.offset = block->offset;
+            result.done = true;
+            size_t seq = block->seq;
+            pipeline.release(block);
+
+            // 按源顺序把已完成的块并入输出并释放, 与其他块的读取和解析重叠
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            size_t idx = seq - merged;
+            if (pending.size() <= idx) {
+                pending.resize(idx + 1);
+            }
+            std::swap(pending[idx], result);
+            while (!pending.empty() && pending.front().done) {
+                BlockResult& front = pending.front();
+                out.insert(out.end(), front.out.begin(), front.out.end());
+                for (size_t j = 0; j < front.err.size(); ++j) {
+                    front.err[j].offset += front.offset;
+                    append_error(err, front.err[j]);
+                }
+                ret += front.ret;
+                pending.pop_front();
+                ++merged;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(worker, i));
+    }
+    worker(0);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    // 与流式解析相同, 读取错误在已读数据之后报告一次
+    if (pipeline.failed()) {
+        ParseError e = {KERR_READ_FAILED, pipeline.next_line(), 0,
+                        pipeline.total_bytes()};
+        append_error(err, e);
+        if (stats && stats_enabled()) {
+            ++thread_stats[0].errors[KERR_READ_FAILED];
+        }
+    }
+
+    if (stats && stats_enabled()) {
+        stats->merge_concurrent(thread_stats, stats_clock_ns() - begin_ns);
+    }
+    return ret;
+}
+}
+#endif  // TABLEPARSER_PIPELINED_INPUT_H
@@ -0,0 +1,92 @@
+#ifndef TABLEPARSER_ROW_FILTER_H
+#define TABLEPARSER_ROW_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include "string_arena.h"
+
+namespace tp {
+
+/**
+ * @brief 解析时的列投影和行过滤条件
+ *
+ * 条件直接在原始字段文本上求值, 不满足条件的行在任何列转换之前被丢弃,
+ * 解析结果为KFILTERED. 未被投影的列只做分隔符扫描, 不转换也不校验内容,
+ * 对应的输出内存保持不变. 多个条件之间为"与"关系.
+ * 构造后只读, 可被多个解析器共享
+ */
+class RowFilter {
+   public:
+    RowFilter();
+
+    /**
+     * @brief 投影列, 调用后只转换被投影的列; 未调用时转换所有列
+     */
+    RowFilter& select(unsigned column);
+
+    /**
+     * @brief 字段文本等于value
+     */
+    RowFilter& equal(unsigned column, const std::string& value);
+
+    /**
+     * @brief 字段文本以value开头
+     */
+    RowFilter& prefix(unsigned column, const std::string& value);
+
+    /**
+     * @brief 字段为10进制整数且在[min, max]范围内
+     */
+    RowFilter& int_range(unsigned column, int64_t min, int64_t max);
+
+    /**
+     * @brief 字段为浮点数且在[min, max]范围内
+     */
+    RowFilter& float_range(unsigned column, double min, double max);
+
+    /**
+     * @brief 列是否需要转换
+     */
+    bool projected(unsigned column) const {
+        return _select_all ||
+               (column < _selected.size() && _selected[column] != 0);
+    }
+
+    /**
+     * @brief 条件引用的最大列下标加1
+     */
+    unsigned column_bound() const;
+
+    /**
+     * @brief 对一行的字段文本求值
+     * @param[in] fields 每列的原始文本, 个数不小于column_bound()
+     */
+    bool match(const StringRef fields[]) const;
+
+   private:
+    enum PredicateKind { KEQUAL, KPREFIX, KINT_RANGE, KFLOAT_RANGE };
+
+    struct Predicate {
+        PredicateKind kind;
+        unsigned column;
+        std::string value;
+        int64_t int_min;
+        int64_t int_max;
+        double float_min;
+        double float_max;
+    };
+
+    RowFilter& add(const Predicate& predicate);
+
+   private:
+    bool _select_all;
+    std::vector<char> _selected;
+    std::vector<Predicate> _predicates;
+    unsigned _column_bound;
+};
+}
+#endif  // TABLEPARSER_ROW_FILTER_H
@@ -0,0 +1,439 @@
+#ifndef TABLEPARSER_SCHEMA_H
+#define TABLEPARSER_SCHEMA_H
+
+#include <cstdio>
+
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "field_parser.h"
+#include "structural_scanner.h"
+#include "table_parser.h"
+
+namespace tp {
+
+/**
+ * @brief 编译期schema解析单列的结果, 取值与对应的ErrorCode相同
+ */
+enum FieldError {
+    KFIELD_OK = KERR_OK,
+    KFIELD_REQUIRED = KERR_ELEMENT_REQUIRED,
+    KFIELD_MORE = KERR_MORE_ELEMENT,
+    KFIELD_PARSE_FAILED = KERR_PARSE_FAILED,
+    KFIELD_SIZE_REQUIRED = KERR_SIZE_REQUIRED,
+    KFIELD_UNEXPECTED_CHAR = KERR_UNEXPECTED_CHAR,
+    KFIELD_SIZE_OUT_OF_RANGE = KERR_SIZE_OUT_OF_RANGE,
+    KFIELD_UNEXPECTED_TAB = KERR_UNEXPECTED_TAB,
+    KFIELD_UNEXPECTED_EOF = KERR_UNEXPECTED_EOF,
+    KFIELD_UNEXPECTED_NEWLINE = KERR_UNEXPECTED_NEWLINE,
+    KFIELD_MORE_ELEMENT = KERR_MORE_ARRAY_ELEMENT
+};
+
+/**
+ * @brief 格式化编译期schema的解析结果, 格式与TableParser::last_error()一致
+ */
+void format_field_error(char* buf, size_t size, FieldError error,
+                        unsigned line, unsigned column);
+
+/**
+ * @brief 成员类型到内置解析函数的映射
+ *
+ * 未特化的类型不能直接作为列, 需要使用TP_CUSTOM_FIELD
+ */
+template <typename M>
+struct FieldTraits {
+    static const bool supported = false;
+};
+
+template <>
+struct FieldTraits<int> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, int* out) {
+        int64_t value = 0;
+        if (!parse_signed(s, len, INT32_MAX, &value)) {
+            return false;
+        }
+        *out = static_cast<int>(value);
+        return true;
+    }
+};
+
+template <>
+struct FieldTraits<int64_t> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, int64_t* out) {
+        return parse_signed(s, len, INT64_MAX, out);
+    }
+};
+
+template <>
+struct FieldTraits<uint32_t> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, uint32_t* out) {
+        uint64_t value = 0;
+        if (!parse_unsigned(s, len, UINT32_MAX, &value)) {
+            return false;
+        }
+        *out = static_cast<uint32_t>(value);
+        return true;
+    }
+};
+
+template <>
+struct FieldTraits<uint64_t> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, uint64_t* out) {
+        return parse_unsigned(s, len, UINT64_MAX, out);
+    }
+};
+
+template <>
+struct FieldTraits<float> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, float* out) {
+        return parse_float(s, len, out);
+    }
+};
+
+template <>
+struct FieldTraits<double> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, double* out) {
+        return parse_double(s, len, out);
+    }
+};
+
+template <>
+struct FieldTraits<bool> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, bool* out) {
+        return parse_bool(s, len, out);
+    }
+};
+
+template <size_t N>
+struct FieldTraits<char[N]> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, char (*out)[N]) {
+        return parse_string(s, len, *out, N);
+    }
+};
+
+// 指向输入数据, SchemaParser只解析内存中的数据, 引用在输入有效期间可用
+template <>
+struct FieldTraits<StringRef> {
+    static const bool supported = true;
+    static bool parse(const char* s, size_t len, StringRef* out) {
+        out->data = s;
+        out->size = len;
+        return true;
+    }
+};
+
+/**
+ * @brief 普通列
+ * @tparam T 行结构体类型
+ * @tparam M 成员类型
+ * @tparam P 成员指针
+ *
+ * 一般通过TP_FIELD宏使用
+ */
+template <typename T, typename M, M T::*P>
+struct Field {
+    static_assert(FieldTraits<M>::supported,
+                  "unsupported column type, use TP_CUSTOM_FIELD instead");
+
+    typedef T row_type;
+
+    static FieldError parse(const char*& src, T& row) {
+        const char* end = find_field_end(src);
+        if (!FieldTraits<M>::parse(src, static_cast<size_t>(end - src),
+                                   &(row.*P))) {
+            return KFIELD_PARSE_FAILED;
+        }
+        src = *end == '\t' ? end + 1 : end;
+        return KFIELD_OK;
+    }
+};
+
+/**
+ * @brief 用户自定义类型列
+ * @tparam F 解析函数, 失败时返回false
+ *
+ * 解析函数在编译期确定, 可以被内联
+ */
+template <typename T, typename M, M T::*P,
+          bool (*F)(const char* s, size_t len, M* out)>
+struct CustomField {
+    typedef T row_type;
+
+    static FieldError parse(const char*& src, T& row) {
+        const char* end = find_field_end(src);
+        if (!F(src, static_cast<size_t>(end - src), &(row.*P))) {
+            return KFIELD_PARSE_FAILED;
+        }
+        src = *end == '\t' ? end + 1 : end;
+        return KFIELD_OK;
+    }
+};
+
+/**
+ * @brief 数组列, 输入形如num:item1,item2
+ * @tparam C 数组计数成员类型
+ * @tparam PC 数组计数成员指针
+ * @tparam A 数组成员类型, 必须为E[N]
+ * @tparam PA 数组成员指针
+ */
+template <typename T, typename C, C T::*PC, typename A, A T::*PA>
+struct ArrayField {
+    typedef typename std::remove_extent<A>::type element_type;
+    static const size_t capacity = std::extent<A>::value;
+
+    static_assert(std::is_array<A>::value && capacity > 0,
+                  "array column must be a fixed-size array member");
+    static_assert(FieldTraits<element_type>::supported,
+                  "unsupported array element type");
+    static_assert(std::is_integral<C>::value && std::is_unsigned<C>::value,
+                  "array counter must be an unsigned integer");
+    static_assert(capacity <= std::numeric_limits<C>::max(),
+                  "array counter too small for array capacity");
+
+    typedef T row_type;
+
+    static FieldError parse(const char*& src, T& row) {
+        const char* p = src;
+
+        // 数组大小, 超过容量后不再累加以免溢出
+        if (*p < '0' || *p > '9') {
+            return KFIELD_SIZE_REQUIRED;
+        }
+        size_t count = 0;
+        for (; *p >= '0' && *p <= '9'; ++p) {
+            if (count <= capacity) {
+                count = count * 10 + static_cast<size_t>(*p - '0');
+            }
+        }
+        if (*p != ':') {
+            return KFIELD_UNEXPECTED_CHAR;
+        }
+        if (count > capacity) {
+            return KFIELD_SIZE_OUT_OF_RANGE;
+        }
+        ++p;
+        row.*PC = static_cast<C>(count);
+
+        if (count == 0 && *p == '\t') {
+            ++p;
+        }
+
+        // 依次解析数组元素
+        for (size_t i = 0; i < count; ++i) {
+            const char* end = find_element_end(p);
+            if (i != count - 1) {
+                switch (*end) {
+                    case '\t':
+                        return KFIELD_UNEXPECTED_TAB;
+                    case '\0':
+                        return KFIELD_UNEXPECTED_EOF;
+                    case '\n':
+                        return KFIELD_UNEXPECTED_NEWLINE;
+                    default:
+                        break;
+                }
+            } else if (*end == ',') {
+                return KFIELD_MORE_ELEMENT;
+            }
+
+            if (!FieldTraits<element_type>::parse(
+                    p, static_cast<size_t>(end - p), &(row.*PA)[i])) {
+                return KFIELD_PARSE_FAILED;
+            }
+            p = (*end == ',' || *end == '\t') ? end + 1 : end;
+        }
+
+        src = p;
+        return KFIELD_OK;
+    }
+};
+
+template <typename T, unsigned I, typename... Fields>
+struct FieldList;
+
+template <typename T, unsigned I>
+struct FieldList<T, I> {
+    static FieldError parse(const char*& src, T& row, unsigned* column) {
+        static_cast<void>(row);
+        if (!(*src == '\n' || *src == '\0')) {
+            *column = I;
+            return KFIELD_MORE;
+        }
+        return KFIELD_OK;
+    }
+};
+
+template <typename T, unsigned I, typename F, typename... Rest>
+struct FieldList<T, I, F, Rest...> {
+    static_assert(std::is_same<typename F::row_type, T>::value,
+                  "field does not belong to the schema row type");
+
+    static FieldError parse(const char*& src, T& row, unsigned* column) {
+        if (*src == '\n' || *src == '\0') {
+            *column = I;
+            return KFIELD_REQUIRED;
+        }
+
+        FieldError ret = F::parse(src, row);
+        if (ret != KFIELD_OK) {
+            *column = I;
+            return ret;
+        }
+        return FieldList<T, I + 1, Rest...>::parse(src, row, column);
+    }
+};
+
+/**
+ * @brief 编译期schema
+ * @tparam T 行结构体类型
+ * @tparam Fields 按列顺序排列的Field/ArrayField/CustomField
+ *
+ * 每种行类型生成一个完全内联的解析函数, 没有逐列的类型分派和间接调用.
+ * 成员类型、数组容量和计数类型均在编译期检查
+ */
+template <typename T, typename... Fields>
+struct Schema {
+    static_assert(sizeof...(Fields) > 0, "schema requires at least one field");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "row type must be trivially copyable");
+
+    typedef T row_type;
+    static const unsigned column_count = sizeof...(Fields);
+
+    /**
+     * @brief 解析一行, 不跳过行尾
+     * @param[in,out] src 输入位置, 成功时停在行尾
+     * @param[out] row 输出行
+     * @param[out] column 出错的列
+     */
+    static FieldError parse_row(const char*& src, T& row, unsigned* column) {
+        return FieldList<T, 0, Fields...>::parse(src, row, column);
+    }
+};
+
+/**
+ * @brief 基于编译期schema的逐行解析器
+ * @tparam S Schema类型
+ *
+ * 行为和错误信息与TableParser一致, 错误信息在last_error()时才格式化
+ */
+template <typename S>
+class SchemaParser {
+   public:
+    typedef typename S::row_type row_type;
+
+    explicit SchemaParser(const char* src) : _src(src), _origin(src), _line(1) {
+        _error.code = KERR_OK;
+        _error.line = 0;
+        _error.column = 0;
+        _error.offset = 0;
+    }
+
+    /**
+     * @brief 解析一行
+     */
+    ParseResult parse(row_type& row) {
+        if (*_src == '\0') {
+            return KEOF;
+        }
+
+        unsigned column = 0;
+        FieldError ret = S::parse_row(_src, row, &column);
+        _error.line = _line;
+        _error.code = static_cast<ErrorCode>(ret);
+        if (ret != KFIELD_OK) {
+            // 出错时_src停在出错的列
+            _error.column = column;
+            _error.offset = static_cast<size_t>(_src - _origin);
+        }
+
+        // 跳到下一行
+        while (!(*_src == '\n' || *_src == '\0')) {
+            _src = find_field_end(_src);
+            if (*_src == '\t') {
+                ++_src;
+            }
+        }
+        if (*_src == '\n') {
+            ++_src;
+            ++_line;
+        }
+
+        return ret == KFIELD_OK ? KOK : KERROR;
+    }
+
+    const ParseError& error() const { return _error; }
+
+    const char* last_error() const {
+        if (_error.line == 0) {
+            return "ok";
+        }
+
+        _error.format(_err, sizeof(_err));
+        return _err;
+    }
+
+   private:
+    const char* _src;
+    const char* _origin;
+    unsigned _line;
+    ParseError _error;
+    mutable char _err[128];
+};
+
+/**
+ * @brief 使用编译期schema解析所有数据
+ * @tparam S Schema类型
+ * @param[in] src 输入数据源
+ * @param[in,out] out 输出数组
+ * @param[in,out] err 输出错误, 只包含失败的行
+ * @return 解析成功数
+ */
+template <typename S, typename E>
+unsigned parse_all(const char* src, std::vector<typename S::row_type>& out,
+                   std::vector<E>& err) {
+    unsigned ret = 0;
+
+    SchemaParser<S> parser(src);
+    while (true) {
+        typename S::row_type object;
+        ParseResult result = parser.parse(object);
+        if (result == KEOF) {
+            break;
+        }
+
+        if (result == KOK) {
+            out.push_back(object);
+            ++ret;
+        } else {
+            append_error(err, parser.error());
+        }
+    }
+
+    return ret;
+}
+}
+
+/// @brief 声明普通列, 类型由成员类型推导
+#define TP_FIELD(T, member) ::tp::Field<T, decltype(T::member), &T::member>
+
+/// @brief 声明数组列, counter为数组计数成员
+#define TP_ARRAY_FIELD(T, counter, array)                          \
+    ::tp::ArrayField<T, decltype(T::counter), &T::counter,         \
+                     decltype(T::array), &T::array>
+
+/// @brief 声明用户自定义类型列, func为bool (*)(const char*, size_t, M*)
+#define TP_CUSTOM_FIELD(T, member, func) \
+    ::tp::CustomField<T, decltype(T::member), &T::member, func>
+
+#endif  // TABLEPARSER_SCHEMA_H
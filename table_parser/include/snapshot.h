@@ -0,0 +1,219 @@
+#ifndef TABLEPARSER_SNAPSHOT_H
+#define TABLEPARSER_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "enum_table.h"
+#include "table_parser.h"
+
+namespace tp {
+
+/// @brief 快照格式版本, 格式变化时递增
+static const uint32_t KSNAPSHOT_VERSION = 1;
+
+/**
+ * @brief 源文件标识, 用于判断快照是否过期
+ */
+struct SourceStamp {
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t dev;    ///@brief 设备号, 不写入快照
+    uint64_t inode;  ///@brief inode, 不写入快照, 用于发现替换式更新
+};
+
+/**
+ * @brief 获取源文件标识
+ * @return 文件不存在或无法访问时返回false
+ */
+bool stat_source(const char* path, SourceStamp* stamp);
+
+/**
+ * @brief 两次获取的源文件标识是否相同
+ */
+bool same_source(const SourceStamp& a, const SourceStamp& b);
+
+/**
+ * @brief 计算schema哈希
+ * @param[in] desc 列描述数组
+ * @param[in] row_size 输出结构体大小
+ * @param[in] user_version 用户自定义版本, KCLASS回调的语义变化时应修改
+ *
+ * 包含列类型、数组容量、元素大小和偏移, 以及KENUM列枚举表的名字和值;
+ * 不包含回调函数地址和context
+ */
+uint64_t schema_hash(const ColumnDescriptor desc[], size_t row_size,
+                     uint64_t user_version);
+
+/**
+ * @brief 列描述是否可以使用快照
+ * @param[in] desc 列描述数组
+ * @param[in] user_version 用户自定义版本, 见schema_hash
+ *
+ * KSTRING_VIEW/KSTRING_INTERN列保存的是指针, 不能写入快照.
+ * KCLASS列的回调无法哈希, 只有指定非0的user_version时才使用快照
+ */
+bool snapshot_supported(const ColumnDescriptor desc[],
+                        uint64_t user_version = 0);
+
+/**
+ * @brief 写入快照
+ * @param[in] path 快照路径, 先写临时文件再原子替换
+ * @param[in] hash schema哈希
+ * @param[in] stamp 源文件标识
+ * @param[in] rows 行数据
+ * @param[in] row_size 每行大小
+ * @param[in] row_count 行数
+ * @return 是否成功
+ */
+bool write_snapshot(const char* path, uint64_t hash, const SourceStamp& stamp,
+                    const void* rows, size_t row_size, size_t row_count);
+
+/**
+ * @brief 以mmap方式打开的只读快照
+ *
+ * 行数据直接在映射内存中使用, 不做反序列化
+ */
+class MappedSnapshot {
+   public:
+    MappedSnapshot();
+
+    ~MappedSnapshot();
+
+    /**
+     * @brief 打开并校验快照
+     * @param[in] path 快照路径
+     * @param[in] hash 期望的schema哈希
+     * @param[in] row_size 期望的每行大小
+     * @param[in] stamp 期望的源文件标识, 为nullptr时不检查
+     * @return 快照不存在、损坏或已过期时返回false
+     */
+    bool open(const char* path, uint64_t hash, size_t row_size,
+              const SourceStamp* stamp);
+
+    void close();
+
+    const void* rows() const;
+
+    size_t row_count() const;
+
+   private:
+    MappedSnapshot(const MappedSnapshot&);
+    MappedSnapshot& operator=(const MappedSnapshot&);
+
+   private:
+    void* _addr;
+    size_t _length;
+    const void* _rows;
+    size_t _row_count;
+};
+
+/**
+ * @brief 只读表, 数据来自解析结果或映射的快照
+ * @tparam T 行结构体类型
+ *
+ * 复制时共享底层数据
+ */
+template <typename T>
+class Table {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "snapshot rows must be trivially copyable");
+
+   public:
+    Table() : _data(nullptr), _size(0) {}
+
+    const T* data() const { return _data; }
+
+    size_t size() const { return _size; }
+
+    const T& operator[](size_t idx) const { return _data[idx]; }
+
+    /**
+     * @brief 数据是否来自快照
+     */
+    bool mapped() const { return static_cast<bool>(_snapshot); }
+
+    void assign(std::vector<T>& rows) {
+        std::shared_ptr<std::vector<T> > owned =
+            std::make_shared<std::vector<T> >();
+        owned->swap(rows);
+        _snapshot.reset();
+        _rows = owned;
+        _data = _rows->empty() ? nullptr : &(*_rows)[0];
+        _size = _rows->size();
+    }
+
+    void assign(const std::shared_ptr<MappedSnapshot>& snapshot) {
+        _rows.reset();
+        _snapshot = snapshot;
+        _data = static_cast<const T*>(_snapshot->rows());
+        _size = _snapshot->row_count();
+    }
+
+   private:
+    std::shared_ptr<std::vector<T> > _rows;
+    std::shared_ptr<MappedSnapshot> _snapshot;
+    const T* _data;
+    size_t _size;
+};
+
+/**
+ * @brief 加载词表, 优先使用快照
+ * @tparam T 解析输出结构体类型
+ * @tparam E 错误类型, ParseError或std::string
+ * @param[in] source_path 词表文件
+ * @param[in] snapshot_path 快照文件
+ * @param[in] desc 列描述数组
+ * @param[out] table 输出表
+ * @param[in,out] err 重新解析时的错误信息
+ * @param[in] user_version 用户自定义版本, 见schema_hash
+ * @return 是否加载成功, 源文件无法读取时失败
+ *
+ * 快照与源文件或schema不匹配时重新解析源文件, 没有错误行时才写入新快照,
+ * 否则下次加载仍会重新解析并报告错误. 列描述不支持快照时总是解析源文件
+ */
+template <typename T, typename E>
+bool load_table(const char* source_path, const char* snapshot_path,
+                const ColumnDescriptor desc[], Table<T>& table,
+                std::vector<E>& err, uint64_t user_version = 0) {
+    SourceStamp stamp;
+    if (!stat_source(source_path, &stamp)) {
+        return false;
+    }
+
+    bool use_snapshot = snapshot_supported(desc, user_version);
+    uint64_t hash = schema_hash(desc, sizeof(T), user_version);
+    std::shared_ptr<MappedSnapshot> snapshot =
+        std::make_shared<MappedSnapshot>();
+    if (use_snapshot &&
+        snapshot->open(snapshot_path, hash, sizeof(T), &stamp)) {
+        table.assign(snapshot);
+        return true;
+    }
+
+    std::vector<T> rows;
+    size_t err_count = err.size();
+    if (!parse_file(source_path, desc, rows, err)) {
+        return false;
+    }
+
+    // 有错误行或解析期间源文件发生变化时不写快照
+    SourceStamp after;
+    if (use_snapshot && err.size() == err_count &&
+        stat_source(source_path, &after) &&
+        same_source(after, stamp)) {
+        write_snapshot(snapshot_path, hash, stamp,
+                       rows.empty() ? nullptr : &rows[0], sizeof(T),
+                       rows.size());
+    }
+
+    table.assign(rows);
+    return true;
+}
+}
+#endif  // TABLEPARSER_SNAPSHOT_H
@@ -0,0 +1,104 @@
+#ifndef TABLEPARSER_STRING_ARENA_H
+#define TABLEPARSER_STRING_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tp {
+
+/**
+ * @brief 不持有内存的字符串引用
+ *
+ * KSTRING_VIEW列指向输入数据, KSTRING_INTERN列指向StringArena,
+ * 两者都不保证以'\0'结尾
+ */
+struct StringRef {
+    const char* data;
+    size_t size;
+
+    std::string str() const { return std::string(data, size); }
+
+    bool equals(const char* s, size_t len) const {
+        return size == len && (len == 0 || memcmp(data, s, len) == 0);
+    }
+};
+
+inline bool operator==(const StringRef& a, const StringRef& b) {
+    return a.equals(b.data, b.size);
+}
+
+inline bool operator!=(const StringRef& a, const StringRef& b) {
+    return !(a == b);
+}
+
+/**
+ * @brief 去重的字符串存储
+ *
+ * 作为KSTRING_INTERN列的context使用, 相同的字符串只保存一份,
+ * 适合取值较少的列. 字符串按块分配, 地址在arena析构前不变.
+ * intern可被多个线程同时调用: 字符串按哈希分到KSHARD_COUNT个分片,
+ * 每个分片有独立的锁、哈希表和存储块, 多线程解析时只有落在同一
+ * 分片的字符串才会相互等待
+ */
+class StringArena {
+   public:
+    /// @brief 分片数, 须为2的幂
+    static const size_t KSHARD_COUNT = 16;
+
+    /**
+     * @param[in] block_size 每个存储块的大小, 更长的字符串单独分配.
+     * 每个分片在首次使用时分配自己的块
+     */
+    explicit StringArena(size_t block_size = 64 * 1024);
+
+    /**
+     * @brief 获取字符串在arena中的唯一副本
+     * @param[in] s 字符串, 不要求以'\0'结尾
+     * @param[in] len 字符串长度
+     * @return 指向arena的引用, 其后紧跟'\0'
+     */
+    StringRef intern(const char* s, size_t len);
+
+    /**
+     * @brief 不同字符串的个数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 存储块占用的字节数
+     */
+    size_t allocated_bytes() const;
+
+   private:
+    StringArena(const StringArena&);
+    StringArena& operator=(const StringArena&);
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<char[]> > blocks;
+        char* block;        // 当前分配短字符串的块
+        size_t block_used;  // 当前块已用字节数
+        size_t allocated;
+        std::vector<StringRef> slots;  // data为nullptr表示空槽
+        size_t count;
+        char pad[64];  // 避免相邻分片的锁共享缓存行
+    };
+
+    char* allocate(Shard& shard, size_t len);
+
+    void rehash(Shard& shard);
+
+    static uint64_t hash(const char* s, size_t len);
+
+   private:
+    size_t _block_size;
+    Shard _shards[KSHARD_COUNT];
+};
+}
+#endif  // TABLEPARSER_STRING_ARENA_H
@@ -0,0 +1,54 @@
+#ifndef TABLEPARSER_STRUCTURAL_SCANNER_H
+#define TABLEPARSER_STRUCTURAL_SCANNER_H
+
+#include <cstddef>
+
+namespace tp {
+
+/**
+ * @brief 分隔符扫描的指令集实现
+ */
+enum ScannerIsa { KSCALAR = 0, KSSE2, KAVX2 };
+
+/**
+ * @brief 查找列的结束位置
+ * @param[in] s 以'\0'结尾的输入
+ * @return 第一个'\0', '\t'或'\n'的位置
+ *
+ * 向量化实现按块生成分隔符位掩码, 每次处理16或32字节
+ */
+const char* find_field_end(const char* s);
+
+/**
+ * @brief 查找数组元素的结束位置
+ * @param[in] s 以'\0'结尾的输入
+ * @return 第一个'\0', ',', '\t'或'\n'的位置
+ */
+const char* find_element_end(const char* s);
+
+/**
+ * @brief 一次定位数组列中的所有逗号
+ * @param[in] s 以'\0'结尾的输入, 指向第一个元素
+ * @param[out] commas 按顺序保存逗号位置, 最多保存max个
+ * @param[out] count 列结束前的逗号总数, 可能大于max
+ * @return 第一个'\0', '\t'或'\n'的位置
+ */
+const char* find_array_commas(const char* s, const char** commas, size_t max,
+                              size_t* count);
+
+/**
+ * @brief 获取当前使用的指令集实现
+ *
+ * 首次调用扫描函数时根据CPU特性自动选择
+ */
+ScannerIsa scanner_isa();
+
+/**
+ * @brief 强制使用指定的指令集实现
+ * @return CPU不支持该实现时返回false且不做修改
+ *
+ * 主要用于测试和性能对比, 不能与扫描函数并发调用
+ */
+bool set_scanner_isa(ScannerIsa isa);
+}
+#endif  // TABLEPARSER_STRUCTURAL_SCANNER_H
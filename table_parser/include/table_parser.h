@@ -9,22 +9,56 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "enum_table.h"
+#include "input_stream.h"
+#include "parse_error.h"
+#include "parse_stats.h"
+#include "row_filter.h"
+#include "string_arena.h"
+
 namespace tp {
 
 /**
  * @brief 数据类型
  *
  * 定义了数据类型的基本构成类型
+ *   KINT/KUINT32     int/uint32_t
+ *   KINT64/KUINT64   int64_t/uint64_t
+ *   KFLOAT/KDOUBLE   float/double
+ *   KBOOL            bool, 接受true/false/1/0
+ *   KENUM            int, context为const EnumTable*, 按枚举名查找枚举值
+ *   KSTRING_VIEW     StringRef, 指向输入数据, 不复制; 输入须在使用期间保持
+ *                    有效. 流式解析的缓冲区会被复用, 因此不能用于流式
+ *                    解析、parse_all_pipelined和parse_appended; 解析文件时
+ *                    使用带MappedFile参数的parse_file
+ *   KSTRING_INTERN   StringRef, context为StringArena*, 相同的值只保存一份
  */
-enum DataType { KNONE = 0, KINT, KFLOAT, KSTRING, KCLASS };
+enum DataType {
+    KNONE = 0,
+    KINT,
+    KFLOAT,
+    KSTRING,
+    KCLASS,
+    KINT64,
+    KUINT32,
+    KUINT64,
+    KDOUBLE,
+    KBOOL,
+    KENUM,
+    KSTRING_VIEW,
+    KSTRING_INTERN
+};
 
 /**
  * @brief 描述解析结果
+ *
+ * KFILTERED表示该行不满足RowFilter的条件而被跳过, 不是错误
  */
-enum ParseResult { KOK = 0, KERROR, KEOF };
+enum ParseResult { KOK = 0, KERROR, KEOF, KFILTERED };
 
 /**
  * @brief 自定义解析回调函数
@@ -58,10 +92,145 @@ struct ColumnDescriptor {
     void* context;             ///@brief 回调函数上下文
 };
 
+/**
+ * @brief 解析计划的校验结果
+ */
+enum PlanError {
+    KPLAN_OK = 0,
+    KPLAN_OUT_OF_BOUNDARY,     ///@brief 列的内存超出结构体范围
+    KPLAN_CALLBACK_REQUIRED,   ///@brief KCLASS列缺少回调函数
+    KPLAN_CONTEXT_REQUIRED,    ///@brief KENUM/KSTRING_INTERN列缺少context
+    KPLAN_UNKNOWN_TYPE         ///@brief 未知的列类型
+};
+
+/**
+ * @brief 预编译的解析计划
+ *
+ * 由列描述数组和输出结构体大小构造, 构造时完成内存越界检查并解析出每列
+ * 的回调函数, 解析时不再重复这些工作. 构造后只读, 可被任意多个
+ * TableParser在不同线程中共享, 生命周期须长于使用它的解析器
+ */
+class ParsePlan {
+   public:
+    /**
+     * @param[in] desc 列描述数组, 以KNONE结束
+     * @param[in] row_size 输出结构体大小
+     */
+    ParsePlan(const ColumnDescriptor desc[], size_t row_size);
+
+    /**
+     * @brief 构造不对应结构体的解析计划
+     * @param[in] desc 列描述数组, 以KNONE结束, 其中的偏移被忽略
+     *
+     * 用于列式解析, 不能用于TableParser::parse
+     */
+    explicit ParsePlan(const ColumnDescriptor desc[]);
+
+    /**
+     * @brief 计划是否有效, 无效的计划解析每一行都会失败
+     */
+    bool ok() const;
+
+    PlanError error() const;
+
+    /**
+     * @brief 校验失败的列
+     */
+    unsigned error_column() const;
+
+    size_t row_size() const;
+
+    /**
+     * @brief 是否对应结构体布局
+     */
+    bool has_layout() const;
+
+    size_t column_count() const;
+
+    /**
+     * @brief 是否包含KSTRING_VIEW列
+     */
+    bool has_string_view() const;
+
+    /**
+     * @brief 获取列描述, 内置类型的callback已被填充
+     */
+    const ColumnDescriptor& column(size_t idx) const;
+
+   private:
+    void init(const ColumnDescriptor desc[]);
+
+   private:
+    std::vector<ColumnDescriptor> _columns;
+    bool _has_layout;
+    bool _has_string_view;
+    size_t _row_size;
+    PlanError _error;
+    unsigned _error_column;
+};
+
+/**
+ * @brief 批量解析的结果
+ */
+struct BatchResult {
+    size_t rows;      ///@brief 写入输出缓冲区的行数
+    size_t failed;    ///@brief 失败并被跳过的行数
+    size_t filtered;  ///@brief 不满足过滤条件而被跳过的行数
+    bool eof;         ///@brief 输入是否已全部解析
+};
+
+class ColumnarTable;
+
 class TableParser {
    public:
+    /// @brief 流式解析时默认的单次读取块大小
+    static const size_t KDEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    /**
+     * @brief 构造函数
+     * @param[in] src 以'\0'结尾的输入数据
+     * @param[in] desc 列描述数组
+     *
+     * 首次解析时根据输出结构体大小构造内部的解析计划
+     */
     TableParser(const char* src, const ColumnDescriptor desc[]);
 
+    /**
+     * @brief 使用共享解析计划的构造函数
+     * @param[in] src 以'\0'结尾的输入数据
+     * @param[in] plan 解析计划
+     */
+    TableParser(const char* src, const ParsePlan& plan);
+
+    /**
+     * @brief 流式解析构造函数
+     * @param[in] in 输入流, 生命周期须长于解析器
+     * @param[in] desc 列描述数组
+     * @param[in] buffer_size 单次读取块大小
+     *
+     * 内部缓冲区只保留未解析完的行, 内存占用为O(buffer_size + 最长行)
+     */
+    TableParser(InputStream* in, const ColumnDescriptor desc[],
+                size_t buffer_size = KDEFAULT_BUFFER_SIZE);
+
+    TableParser(InputStream* in, const ParsePlan& plan,
+                size_t buffer_size = KDEFAULT_BUFFER_SIZE);
+
+    /**
+     * @brief 分段解析构造函数
+     * @param[in] begin 分段开始位置, 必须是行首
+     * @param[in] end 分段结束位置, 必须是行首或输入结尾
+     * @param[in] desc 列描述数组
+     * @param[in] first_line 分段第一行在整个输入中的行号
+     *
+     * 用于并行解析, 解析到end时返回KEOF
+     */
+    TableParser(const char* begin, const char* end,
+                const ColumnDescriptor desc[], unsigned first_line);
+
+    TableParser(const char* begin, const char* end, const ParsePlan& plan,
+                unsigned first_line);
+
     TableParser(const TableParser& org);
 
     TableParser& operator=(const TableParser& rhs);
@@ -72,52 +241,272 @@ class TableParser {
      */
     ParseResult parse(void* p, size_t size);
 
+    /**
+     * @brief 列式解析函数
+     * @param[in,out] table 列式输出表, 使用表自身的解析计划
+     *
+     * 直接追加到每列的存储中, 失败的行不会留下任何数据
+     */
+    ParseResult parse_columns(ColumnarTable& table);
+
+    /**
+     * @brief 批量解析到调用者提供的缓冲区
+     * @param[out] out 输出缓冲区, 至少capacity * row_size字节
+     * @param[in] row_size 每行大小
+     * @param[in] capacity 最多输出的行数
+     * @param[out] errors 追加失败行的错误, 可以为nullptr
+     * @return 成功的行连续存放在out开头; 输出满capacity行或输入结束时返回
+     *
+     * 解析计划只在每批开始时检查一次, 失败的行不占用输出位置
+     */
+    BatchResult parse_batch(void* out, size_t row_size, size_t capacity,
+                            std::vector<ParseError>* errors);
+
+    template <typename T>
+    BatchResult parse_batch(T* out, size_t capacity,
+                            std::vector<ParseError>* errors = nullptr) {
+        return parse_batch(out, sizeof(T), capacity, errors);
+    }
+
+    /**
+     * @brief 设置列投影和行过滤条件
+     * @param[in] filter 过滤条件, 为nullptr时取消过滤, 生命周期须长于解析器
+     */
+    void set_filter(const RowFilter* filter);
+
+    /**
+     * @brief 设置解析统计
+     * @param[in] stats 之后每行的统计累加到其中, 为nullptr时停止统计
+     *
+     * 只有库以TP_ENABLE_STATS编译时才会记录, 见stats_enabled()
+     */
+    void set_stats(ParseStats* stats);
+
+    /**
+     * @brief 最近一行的解析结果, 成功时code为KERR_OK
+     */
+    const ParseError& error() const;
+
+    /**
+     * @brief 最近一行解析结果的文本, 调用时才格式化
+     */
     const char* last_error() const;
 
+    /**
+     * @brief 下一行的行号
+     *
+     * 与offset()一起保存即可在之后从该位置继续解析, 见tail_parser.h
+     */
+    unsigned line() const;
+
+    /**
+     * @brief 下一行相对输入开头的字节偏移, 在两行之间调用时总是行首
+     */
+    size_t offset() const;
+
     ~TableParser(){};
 
    private:
-    ParseResult parse_element(unsigned idx, const char* s, size_t len,
-                              void* data);
+    TableParser(const char* begin, const char* end, unsigned first_line,
+                InputStream* in, size_t buffer_size,
+                const ColumnDescriptor* desc, const ParsePlan* plan);
+
+    // 准备解析下一行, 没有可解析的行时返回KEOF
+    ParseResult begin_row();
+
+    // 记录解析结果并跳到下一行
+    void end_row(ParseResult ret);
+
+    // 检查解析计划是否可用于size大小的输出
+    bool check_plan(size_t size);
+
+    bool check_plan_error(const ParsePlan& plan);
+
+    // 记录错误并返回KERROR, pos为出错位置
+    ParseResult fail(ErrorCode code, unsigned column, const char* pos);
+
+    // 输入中pos相对输入开头的字节偏移
+    size_t offset_of(const char* pos) const;
+
+    // Sink决定每列的输出位置, 见table_parser.cpp
+    template <typename Sink>
+    ParseResult parse_row(const ParsePlan& plan, Sink& sink);
+
+    // 依次定位并转换所有列, 是判断一行是否合法的基准
+    template <typename Sink>
+    ParseResult parse_columns(const ParsePlan& plan, Sink& sink);
+
+    // 先定位所有列并求值过滤条件, 再只转换被投影的列
+    template <typename Sink>
+    ParseResult parse_filtered_row(const ParsePlan& plan, Sink& sink);
+
+    template <typename Sink>
+    ParseResult parse_array(unsigned idx, const ColumnDescriptor& col,
+                            Sink& sink);
+
+    // 内置数值类型数组的批量转换, 数组结构不完整时返回false且不做修改
+    template <typename Sink>
+    bool parse_number_array(unsigned idx, const ColumnDescriptor& col,
+                            size_t count, Sink& sink, ParseResult* ret);
+
+    ParseResult parse_element(unsigned idx, const ColumnDescriptor& col,
+                              const char* s, size_t len, void* data,
+                              size_t size);
+
+    // 保证缓冲区中至少有一个完整行, 或者输入已结束
+    void fill_line();
+
+    // 统计一个字段, begin_ns为开始解析该列的时间
+    void record_field(unsigned idx, const ColumnDescriptor& col, size_t len,
+                      uint64_t begin_ns);
+
+    // 统计一行, line_end为换行符或输入结尾的位置
+    void record_row(ParseResult ret, const char* line_end, unsigned line);
 
    private:
     const char* _src;
+    const char* _end;
     const ColumnDescriptor* _desc;
+    const ParsePlan* _plan;
+    std::shared_ptr<ParsePlan> _own_plan;
+    const RowFilter* _filter;
+    std::vector<StringRef> _fields;  // 过滤时每列的原始文本
+    std::vector<const char*> _commas;  // 数值数组中逗号的位置
     unsigned _line;
-    char _err[128];
+    const char* _origin;       // 非流式解析时输入的开头
+    const char* _field_start;  // 正在解析的列的开头
+    ParseError _error;
+    mutable char _err[128];
+
+    // 统计状态, 成员不受TP_ENABLE_STATS影响以保持对象布局一致
+    ParseStats* _stats;
+    const char* _row_start;  // 正在统计的行的开头, 没有时为nullptr
+    uint64_t _row_begin_ns;
+
+    // 流式解析状态, 非流式解析时_in为nullptr
+    InputStream* _in;
+    std::vector<char> _buf;
+    size_t _buf_size;
+    size_t _consumed;  // 已从缓冲区丢弃的字节数
+    size_t _data_end;
+    bool _in_eof;
+    bool _in_failed;
 };
 
 /**
- * @brief 解析所有数据
+ * @brief 使用已构造的解析器解析剩余所有数据
  * @tparam T 解析输出结构体类型
- * @param[in] src 输入数据源
- * @param[in] desc 列描述数组
+ * @tparam E 错误类型, ParseError或std::string
+ * @param[in,out] tb_parser 解析器
  * @param[in,out] out 输出数组
- * @param[in,out] err 输出错误信息
+ * @param[in,out] err 输出错误, 只包含失败的行
  * @return 解析成功数
  */
-template <typename T>
-unsigned parse_all(const char* src, const ColumnDescriptor desc[],
-                   std::vector<T>& out, std::vector<std::string>& err) {
-    unsigned ret = 0;
+template <typename T, typename E>
+unsigned parse_all(TableParser& tb_parser, std::vector<T>& out,
+                   std::vector<E>& err) {
+    // 每批直接解析到out的尾部, 不经过临时对象
+    static const size_t KBATCH_ROWS = 1024;
 
-    TableParser tb_parser(src, desc);
+    unsigned ret = 0;
+    std::vector<ParseError> batch_err;
     while (true) {
-        T object;
-        ParseResult result = tb_parser.parse(&object, sizeof(T));
-        if (result == KERROR) {
-            err.push_back(tb_parser.last_error());
-        } else if (result == KEOF) {
+        size_t base = out.size();
+        out.resize(base + KBATCH_ROWS);
+        BatchResult result =
+            tb_parser.parse_batch(&out[base], KBATCH_ROWS, &batch_err);
+        out.resize(base + result.rows);
+        ret += static_cast<unsigned>(result.rows);
+
+        for (size_t i = 0; i < batch_err.size(); ++i) {
+            append_error(err, batch_err[i]);
+        }
+        batch_err.clear();
+
+        if (result.eof) {
             break;
-        } else {
-            assert(result == KOK);
-            err.push_back(tb_parser.last_error());
-            out.push_back(object);
-            ++ret;
         }
     }
 
     return ret;
 }
+
+/**
+ * @brief 解析所有数据
+ * @tparam T 解析输出结构体类型
+ * @param[in] src 输入数据源
+ * @param[in] desc 列描述数组
+ * @param[in,out] out 输出数组
+ * @param[in,out] err 输出错误, 只包含失败的行
+ * @return 解析成功数
+ */
+template <typename T, typename E>
+unsigned parse_all(const char* src, const ColumnDescriptor desc[],
+                   std::vector<T>& out, std::vector<E>& err) {
+    TableParser tb_parser(src, desc);
+    return parse_all(tb_parser, out, err);
+}
+
+/**
+ * @brief 流式解析所有数据
+ * @tparam T 解析输出结构体类型
+ * @param[in] in 输入流
+ * @param[in] desc 列描述数组
+ * @param[in,out] out 输出数组
+ * @param[in,out] err 输出错误, 只包含失败的行
+ * @return 解析成功数
+ */
+template <typename T, typename E>
+unsigned parse_all(InputStream& in, const ColumnDescriptor desc[],
+                   std::vector<T>& out, std::vector<E>& err) {
+    TableParser tb_parser(&in, desc);
+    return parse_all(tb_parser, out, err);
+}
+
+/**
+ * @brief 流式解析文件中的所有数据
+ * @tparam T 解析输出结构体类型
+ * @param[in] path 文件路径
+ * @param[in] desc 列描述数组
+ * @param[in,out] out 输出数组
+ * @param[in,out] err 输出错误, 只包含失败的行
+ * @return 文件是否成功打开
+ *
+ * 含KSTRING_VIEW列时每行都报告KERR_STRING_VIEW_IN_STREAM,
+ * 应使用带MappedFile参数的版本
+ */
+template <typename T, typename E>
+bool parse_file(const char* path, const ColumnDescriptor desc[],
+                std::vector<T>& out, std::vector<E>& err) {
+    FileInputStream in(path);
+    if (!in.ok()) {
+        return false;
+    }
+    parse_all(in, desc, out, err);
+    return true;
+}
+
+/**
+ * @brief 映射文件并解析其中的所有数据
+ * @tparam T 解析输出结构体类型
+ * @param[in] path 文件路径
+ * @param[in] desc 列描述数组
+ * @param[in,out] out 输出数组
+ * @param[in,out] err 输出错误, 只包含失败的行
+ * @param[out] file 文件映射, KSTRING_VIEW列指向其中, 在其关闭前有效
+ * @return 文件是否成功映射
+ *
+ * 不经过流式缓冲区, 因此支持KSTRING_VIEW列
+ */
+template <typename T, typename E>
+bool parse_file(const char* path, const ColumnDescriptor desc[],
+                std::vector<T>& out, std::vector<E>& err, MappedFile& file) {
+    if (!file.open(path)) {
+        return false;
+    }
+    TableParser tb_parser(file.data(), file.data() + file.size(), desc, 1);
+    parse_all(tb_parser, out, err);
+    return true;
+}
 }
 #endif  // TABLEPARSER_TABLE_PARSER_H
@@ -0,0 +1,129 @@
+#ifndef TABLEPARSER_TAIL_PARSER_H
+#define TABLEPARSER_TAIL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "table_parser.h"
+
+namespace tp {
+
+/**
+ * @brief 追加式词表的续读位置
+ *
+ * 零初始化的状态表示从文件开头解析. 可以用save_tail_state持久化,
+ * 进程重启后继续从上次的位置解析
+ */
+struct TailState {
+    uint64_t offset;     ///@brief 下次开始解析的字节偏移, 总是行首
+    unsigned line;       ///@brief offset处的行号, 0表示尚未解析过
+    uint64_t dev;        ///@brief 文件所在设备号
+    uint64_t inode;      ///@brief 文件inode, 变化说明文件被轮转替换
+    uint64_t size;       ///@brief 上次读取时的文件大小
+    uint64_t tail_hash;  ///@brief offset之前最多64字节的哈希, 用于发现改写
+};
+
+/**
+ * @brief 续读结果
+ */
+enum TailStatus {
+    KTAIL_APPENDED = 0,  ///@brief 从上次的位置继续解析
+    KTAIL_RESTARTED,     ///@brief 文件被截断、轮转或改写, 已从头重新解析
+    KTAIL_OPEN_FAILED,   ///@brief 文件无法打开, 状态不变
+    KTAIL_READ_FAILED,   ///@brief 读取出错, 状态不变
+    KTAIL_PLAN_REJECTED  ///@brief 列描述不能用于续读, 原因见err, 状态不变
+};
+
+/**
+ * @brief 上次位置之后新增的完整行
+ */
+struct TailChunk {
+    std::vector<char> data;  ///@brief 校验区 + 新增的完整行 + '\0'
+    size_t begin;            ///@brief 新增数据在data中的开始位置
+    size_t end;              ///@brief 新增数据在data中的结束位置, 总是行首
+    TailState start;         ///@brief begin处对应的状态
+};
+
+/**
+ * @brief 读取上次位置之后新增的完整行
+ * @param[in] path 文件路径
+ * @param[in] state 上次的状态
+ * @param[out] chunk 新增数据, 末尾未结束的行留到下次读取
+ * @return 文件被截断、轮转或offset之前的内容被改写时从头读取并返回
+ *         KTAIL_RESTARTED
+ *
+ * 只读取offset之后的数据和之前最多64字节的校验区, 耗时与新增数据量成正比
+ */
+TailStatus read_appended(const char* path, const TailState& state,
+                         TailChunk* chunk);
+
+/**
+ * @brief 解析完chunk中的数据后更新状态
+ * @param[in] chunk read_appended的结果
+ * @param[in] consumed 从chunk.begin开始已解析的字节数, 须为行首
+ * @param[in] line 下一行的行号
+ * @param[out] state 新状态
+ */
+void advance_tail_state(const TailChunk& chunk, size_t consumed,
+                        unsigned line, TailState* state);
+
+/**
+ * @brief 保存状态, 先写临时文件再原子替换
+ */
+bool save_tail_state(const char* path, const TailState& state);
+
+/**
+ * @brief 读取状态
+ * @return 文件不存在或格式不符时返回false且不修改state
+ */
+bool load_tail_state(const char* path, TailState* state);
+
+/**
+ * @brief 解析追加式词表中上次位置之后新增的行
+ * @tparam T 解析输出结构体类型
+ * @param[in] path 文件路径
+ * @param[in] desc 列描述数组
+ * @param[in,out] state 续读状态, 成功时更新到新数据之后
+ * @param[in,out] out 追加新行的解析结果
+ * @param[in,out] err 追加新行的错误, 行号和偏移均相对整个文件
+ * @return 返回KTAIL_RESTARTED时out中之前的结果已过期, 调用者应丢弃
+ *
+ * 末尾没有换行符的行视为尚未写完, 留到下次解析.
+ * 新增数据在返回后即被释放, 因此含KSTRING_VIEW列时不读取文件,
+ * 只报告一个KERR_STRING_VIEW_IN_STREAM并返回KTAIL_PLAN_REJECTED
+ */
+template <typename T, typename E>
+TailStatus parse_appended(const char* path, const ColumnDescriptor desc[],
+                          TailState& state, std::vector<T>& out,
+                          std::vector<E>& err) {
+    ParsePlan plan(desc, sizeof(T));
+    if (plan.has_string_view()) {
+        ParseError e = {KERR_STRING_VIEW_IN_STREAM,
+                        state.line > 0 ? state.line : 1, 0,
+                        static_cast<size_t>(state.offset)};
+        append_error(err, e);
+        return KTAIL_PLAN_REJECTED;
+    }
+
+    TailChunk chunk;
+    TailStatus status = read_appended(path, state, &chunk);
+    if (status != KTAIL_APPENDED && status != KTAIL_RESTARTED) {
+        return status;
+    }
+
+    TableParser tb_parser(&chunk.data[chunk.begin], &chunk.data[chunk.end],
+                          plan, chunk.start.line);
+    std::vector<ParseError> errors;
+    parse_all(tb_parser, out, errors);
+    for (size_t i = 0; i < errors.size(); ++i) {
+        errors[i].offset += chunk.start.offset;
+        append_error(err, errors[i]);
+    }
+
+    advance_tail_state(chunk, tb_parser.offset(), tb_parser.line(), &state);
+    return status;
+}
+}
+#endif  // TABLEPARSER_TAIL_PARSER_H
@@ -0,0 +1,140 @@
+#include "columnar_table.h"
+
+namespace tp {
+
+ColumnarTable::ColumnarTable(const ColumnDescriptor desc[])
+    : _plan(desc), _columns(_plan.column_count()), _rows(0) {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        _columns[i].mark = 0;
+        if (has_offsets(i)) {
+            _columns[i].offsets.push_back(0);
+        }
+    }
+}
+
+const ParsePlan &ColumnarTable::plan() const { return _plan; }
+
+size_t ColumnarTable::row_count() const { return _rows; }
+
+size_t ColumnarTable::column_count() const { return _columns.size(); }
+
+const size_t *ColumnarTable::offsets(size_t idx) const {
+    assert(has_offsets(idx));
+    return &_columns[idx].offsets[0];
+}
+
+const char *ColumnarTable::string(size_t idx, size_t row, size_t *len) const {
+    const ColumnDescriptor &col = _plan.column(idx);
+    assert(col.type == KSTRING && !col.is_array);
+    static_cast<void>(col);
+
+    const size_t *off = offsets(idx);
+    if (len) {
+        *len = off[row + 1] - off[row] - 1;
+    }
+    return column_data(idx) + off[row];
+}
+
+void ColumnarTable::reserve(size_t rows) {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        const ColumnDescriptor &col = _plan.column(i);
+        // 变长列无法预知大小, 只预留偏移
+        if (has_offsets(i)) {
+            _columns[i].offsets.reserve(rows + 1);
+        } else {
+            _columns[i].data.reserve(rows * col.element_size);
+        }
+    }
+}
+
+void ColumnarTable::clear() {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        _columns[i].data.clear();
+        _columns[i].offsets.resize(has_offsets(i) ? 1 : 0);
+    }
+    _rows = 0;
+}
+
+void ColumnarTable::begin_row() {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        _columns[i].mark = _columns[i].data.size();
+    }
+}
+
+void *ColumnarTable::append_value(size_t idx, size_t size) {
+    std::vector<char> &data = _columns[idx].data;
+    size_t pos = data.size();
+    data.resize(pos + size);
+    return &data[0] + pos;
+}
+
+void ColumnarTable::commit_row() {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        Column &column = _columns[i];
+        if (!has_offsets(i)) {
+            continue;
+        }
+
+        // 数组记录元素下标, 字符串记录字节偏移
+        if (_plan.column(i).is_array) {
+            column.offsets.push_back(column.data.size() / element_size(i));
+        } else {
+            column.offsets.push_back(column.data.size());
+        }
+    }
+    ++_rows;
+}
+
+void ColumnarTable::rollback_row() {
+    for (size_t i = 0; i < _columns.size(); ++i) {
+        _columns[i].data.resize(_columns[i].mark);
+    }
+}
+
+bool ColumnarTable::has_offsets(size_t idx) const {
+    const ColumnDescriptor &col = _plan.column(idx);
+    return col.is_array || col.type == KSTRING;
+}
+
+size_t ColumnarTable::element_size(size_t idx) const {
+    return _plan.column(idx).element_size;
+}
+
+const char *ColumnarTable::column_data(size_t idx) const {
+    return _columns[idx].data.data();
+}
+
+namespace {
+
+template <typename E>
+unsigned parse_columns_all(TableParser &tb_parser, ColumnarTable &table,
+                           std::vector<E> &err) {
+    unsigned ret = 0;
+
+    while (true) {
+        ParseResult result = tb_parser.parse_columns(table);
+        if (result == KEOF) {
+            break;
+        }
+
+        if (result == KOK) {
+            ++ret;
+        } else if (result == KERROR) {
+            append_error(err, tb_parser.error());
+        }
+    }
+
+    return ret;
+}
+}
+
+unsigned parse_all(TableParser &tb_parser, ColumnarTable &table,
+                   std::vector<ParseError> &err) {
+    return parse_columns_all(tb_parser, table, err);
+}
+
+unsigned parse_all(TableParser &tb_parser, ColumnarTable &table,
+                   std::vector<std::string> &err) {
+    return parse_columns_all(tb_parser, table, err);
+}
+}
@@ -0,0 +1,196 @@
+#include "enum_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace tp {
+
+EnumTable::EnumTable(const char *const names[], size_t count)
+    : _mask(0), _seed(0), _ok(false) {
+    for (size_t i = 0; i < count; ++i) {
+        _names.push_back(names[i]);
+        _values.push_back(static_cast<int>(i));
+    }
+    build();
+}
+
+EnumTable::EnumTable(const EnumItem items[]) : _mask(0), _seed(0), _ok(false) {
+    for (const EnumItem *item = items; item->name; ++item) {
+        _names.push_back(item->name);
+        _values.push_back(item->value);
+    }
+    build();
+}
+
+bool EnumTable::ok() const { return _ok; }
+
+size_t EnumTable::size() const { return _names.size(); }
+
+const std::string &EnumTable::name(size_t idx) const { return _names[idx]; }
+
+int EnumTable::value(size_t idx) const { return _values[idx]; }
+
+namespace {
+
+// 平均每个桶的名字数, 越大表越紧凑但为桶寻找位移越慢
+const size_t KBUCKET_LOAD = 4;
+// 单个桶最多尝试的位移值, 失败则换种子或扩大表
+const uint32_t KMAX_DISPLACE = 1u << 16;
+// 最多尝试的种子数, 只有哈希完全相同的名字才会用尽
+const uint32_t KMAX_SEED_TRIES = 8;
+
+uint32_t bucket_of(uint64_t h, size_t bucket_count) {
+    return static_cast<uint32_t>((h >> 32) % bucket_count);
+}
+
+uint32_t slot_of(uint64_t h, uint32_t displace, uint32_t mask) {
+    // splitmix64的末尾混合, 使不同位移得到的槽位近似独立
+    uint64_t x = h + (static_cast<uint64_t>(displace) + 1) *
+                         0x9e3779b97f4a7c15ull;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return static_cast<uint32_t>(x) & mask;
+}
+
+struct NameLess {
+    const std::vector<std::string> *names;
+
+    bool operator()(size_t a, size_t b) const {
+        return (*names)[a] < (*names)[b];
+    }
+};
+}
+
+bool EnumTable::find(const char *s, size_t len, int *value) const {
+    if (!_ok) {
+        return false;
+    }
+
+    uint64_t h = hash(s, len, _seed);
+    uint32_t bucket = bucket_of(h, _displace.size());
+    int32_t idx = _slots[slot_of(h, _displace[bucket], _mask)];
+    if (idx < 0) {
+        return false;
+    }
+
+    const std::string &name = _names[static_cast<size_t>(idx)];
+    if (name.size() != len || std::memcmp(name.data(), s, len) != 0) {
+        return false;
+    }
+
+    *value = _values[static_cast<size_t>(idx)];
+    return true;
+}
+
+uint64_t EnumTable::hash(const char *s, size_t len, uint32_t seed) {
+    // 带种子的64位FNV-1a
+    uint64_t h = 14695981039346656037ull ^ seed;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+void EnumTable::build() {
+    // 重复的枚举名无法构成完美哈希, 排序后比较相邻项
+    std::vector<size_t> order(_names.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    NameLess less = {&_names};
+    std::sort(order.begin(), order.end(), less);
+    for (size_t i = 1; i < order.size(); ++i) {
+        if (_names[order[i - 1]] == _names[order[i]]) {
+            return;
+        }
+    }
+
+    // 装载率不超过0.8
+    uint32_t table_size = 1;
+    while (table_size < _names.size() + _names.size() / 4) {
+        table_size <<= 1;
+    }
+
+    while (true) {
+        for (uint32_t seed = 0; seed < KMAX_SEED_TRIES; ++seed) {
+            _seed = seed;
+            if (try_build(table_size)) {
+                _ok = true;
+                return;
+            }
+        }
+        table_size <<= 1;
+    }
+}
+
+bool EnumTable::try_build(uint32_t table_size) {
+    size_t bucket_count = _names.size() / KBUCKET_LOAD + 1;
+    uint32_t mask = table_size - 1;
+
+    std::vector<uint64_t> hashes(_names.size());
+    std::vector<std::vector<uint32_t> > buckets(bucket_count);
+    for (size_t i = 0; i < _names.size(); ++i) {
+        hashes[i] = hash(_names[i].data(), _names[i].size(), _seed);
+        buckets[bucket_of(hashes[i], bucket_count)].push_back(
+            static_cast<uint32_t>(i));
+    }
+
+    // 先放大桶, 此时空槽位最多, 容易找到位移
+    std::vector<uint32_t> bucket_order(bucket_count);
+    for (size_t i = 0; i < bucket_count; ++i) {
+        bucket_order[i] = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&buckets](uint32_t a, uint32_t b) {
+                         return buckets[a].size() > buckets[b].size();
+                     });
+
+    std::vector<int32_t> slots(table_size, -1);
+    std::vector<uint32_t> displace(bucket_count, 0);
+    std::vector<uint32_t> positions;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        const std::vector<uint32_t> &items = buckets[bucket_order[i]];
+        if (items.empty()) {
+            break;
+        }
+
+        bool placed = false;
+        for (uint32_t d = 0; d < KMAX_DISPLACE && !placed; ++d) {
+            positions.clear();
+            placed = true;
+            for (size_t j = 0; j < items.size() && placed; ++j) {
+                uint32_t pos = slot_of(hashes[items[j]], d, mask);
+                // 槽位已被其他桶占用, 或与本桶中前面的名字冲突
+                if (slots[pos] >= 0 ||
+                    std::find(positions.begin(), positions.end(), pos) !=
+                        positions.end()) {
+                    placed = false;
+                } else {
+                    positions.push_back(pos);
+                }
+            }
+            if (placed) {
+                for (size_t j = 0; j < items.size(); ++j) {
+                    slots[positions[j]] = static_cast<int32_t>(items[j]);
+                }
+                displace[bucket_order[i]] = d;
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+
+    _slots.swap(slots);
+    _displace.swap(displace);
+    _mask = mask;
+    return true;
+}
+}
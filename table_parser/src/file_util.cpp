@@ -0,0 +1,58 @@
+#include "file_util.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tp {
+
+bool write_full(int fd, const void *buf, size_t len) {
+    const char *p = static_cast<const char *>(buf);
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool replace_file(const char *path, const FileChunk chunks[], size_t count) {
+    // 临时文件名由mkostemp保证唯一, 同一进程内多个线程同时写同一路径
+    // 时各自写自己的临时文件, rename之后目标总是某一份完整内容
+    std::string tmp_path(path);
+    tmp_path += ".XXXXXX";
+    std::vector<char> tmp(tmp_path.begin(), tmp_path.end());
+    tmp.push_back('\0');
+
+    int fd = ::mkostemp(&tmp[0], O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    // mkostemp创建的文件只有属主可读, 与直接创建时的权限保持一致
+    bool ok = ::fchmod(fd, 0644) == 0;
+    for (size_t i = 0; i < count && ok; ++i) {
+        ok = write_full(fd, chunks[i].data, chunks[i].size);
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (ok && ::rename(&tmp[0], path) == 0) {
+        return true;
+    }
+
+    ::unlink(&tmp[0]);
+    return false;
+}
+}
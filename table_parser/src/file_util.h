@@ -0,0 +1,62 @@
+#ifndef TABLEPARSER_FILE_UTIL_H
+#define TABLEPARSER_FILE_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 库内部使用的文件与哈希工具, 不对外安装
+
+namespace tp {
+
+/// @brief 64位FNV-1a的初始值
+const uint64_t KFNV_OFFSET = 14695981039346656037ull;
+/// @brief 64位FNV-1a的乘数
+const uint64_t KFNV_PRIME = 1099511628211ull;
+
+/**
+ * @brief 把一段字节累加到FNV-1a哈希中
+ */
+inline void fnv_update(uint64_t* hash, const void* data, size_t len) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        *hash ^= p[i];
+        *hash *= KFNV_PRIME;
+    }
+}
+
+/**
+ * @brief 以小端字节序把一个整数累加到FNV-1a哈希中
+ */
+inline void fnv_update(uint64_t* hash, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        *hash ^= (value >> (i * 8)) & 0xff;
+        *hash *= KFNV_PRIME;
+    }
+}
+
+/**
+ * @brief 写入全部数据, 被信号中断时继续
+ */
+bool write_full(int fd, const void* buf, size_t len);
+
+/**
+ * @brief 待写入文件的一段数据
+ */
+struct FileChunk {
+    const void* data;
+    size_t size;
+};
+
+/**
+ * @brief 原子地替换文件内容
+ * @param[in] path 目标路径
+ * @param[in] chunks 依次写入的数据段
+ * @param[in] count 数据段个数
+ * @return 是否成功, 失败时目标文件不变
+ *
+ * 先写同目录下的临时文件并fsync, 再rename覆盖目标, 读者和崩溃后
+ * 都不会看到写了一半的文件. 临时文件名唯一, 多个线程可同时替换同一文件
+ */
+bool replace_file(const char* path, const FileChunk chunks[], size_t count);
+}
+#endif  // TABLEPARSER_FILE_UTIL_H
@@ -0,0 +1,304 @@
+#include "hash_index.h"
+
+#include <cstring>
+
+#include <thread>
+#include <vector>
+
+#include "parallel_parser.h"
+
+namespace tp {
+
+namespace {
+
+// 每个线程至少处理的行数, 行数较少时线程开销大于收益
+const size_t KMIN_ROWS_PER_THREAD = 64 * 1024;
+const uint64_t KMAX_ROWS = 0xfffffffeu;
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hash_int(int64_t key) { return mix(static_cast<uint64_t>(key)); }
+
+uint64_t hash_string(const char *s, size_t len) {
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ len;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, s, 8);
+        h = (h ^ mix(word)) * 0x9fb21c651e98df25ull;
+        s += 8;
+        len -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, s, len);
+    return mix(h ^ tail);
+}
+
+uint64_t make_slot(uint64_t hash, uint32_t row) {
+    return (hash & 0xffffffff00000000ull) | (static_cast<uint64_t>(row) + 1);
+}
+
+uint32_t slot_row(uint64_t slot) {
+    return static_cast<uint32_t>(slot & 0xffffffffu) - 1;
+}
+
+bool same_tag(uint64_t slot, uint64_t hash) {
+    return (slot >> 32) == (hash >> 32);
+}
+}
+
+const size_t HashIndex::KNPOS;
+
+HashIndex::HashIndex()
+    : _rows(nullptr), _row_size(0), _row_count(0), _kind(KKEY_NONE),
+      _mask(0) {
+    memset(&_key, 0, sizeof(_key));
+    _ops.hash = nullptr;
+    _ops.equal = nullptr;
+}
+
+bool HashIndex::build(const void *rows, size_t row_size, size_t row_count,
+                      const ColumnDescriptor &key, const IndexKeyOps *ops,
+                      unsigned threads) {
+    _kind = KKEY_NONE;
+    _slots.reset();
+    _mask = 0;
+    _row_count = 0;
+
+    if (key.is_array || row_count > KMAX_ROWS) {
+        return false;
+    }
+
+    KeyKind kind = KKEY_NONE;
+    switch (key.type) {
+        case KINT:
+        case KINT64:
+        case KUINT32:
+        case KUINT64:
+        case KENUM:
+            kind = KKEY_INT;
+            break;
+        case KSTRING:
+            kind = KKEY_STRING;
+            break;
+        case KSTRING_VIEW:
+        case KSTRING_INTERN:
+            kind = KKEY_STRING_REF;
+            break;
+        case KCLASS:
+            if (ops && ops->hash && ops->equal) {
+                kind = KKEY_CUSTOM;
+                _ops = *ops;
+            }
+            break;
+        default:
+            break;
+    }
+    if (kind == KKEY_NONE) {
+        return false;
+    }
+
+    _rows = static_cast<const char *>(rows);
+    _row_size = row_size;
+    _row_count = row_count;
+    _key = key;
+    _kind = kind;
+
+    // 负载因子不超过0.5
+    uint64_t capacity = 16;
+    while (capacity < static_cast<uint64_t>(row_count) * 2) {
+        capacity <<= 1;
+    }
+    _slots.reset(new std::atomic<uint64_t>[capacity]);
+    for (uint64_t i = 0; i < capacity; ++i) {
+        _slots[i].store(0, std::memory_order_relaxed);
+    }
+    _mask = capacity - 1;
+
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+    size_t max_threads = row_count / KMIN_ROWS_PER_THREAD;
+    if (threads > max_threads) {
+        threads = static_cast<unsigned>(max_threads);
+    }
+
+    if (threads <= 1) {
+        insert_range(0, row_count);
+        return true;
+    }
+
+    std::vector<std::thread> workers;
+    size_t step = (row_count + threads - 1) / threads;
+    for (size_t begin = 0; begin < row_count; begin += step) {
+        size_t end = begin + step < row_count ? begin + step : row_count;
+        workers.push_back(
+            std::thread(&HashIndex::insert_range, this, begin, end));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    return true;
+}
+
+bool HashIndex::ok() const { return _kind != KKEY_NONE; }
+
+size_t HashIndex::size() const { return _row_count; }
+
+size_t HashIndex::find(int64_t key) const {
+    if (_kind != KKEY_INT) {
+        return KNPOS;
+    }
+    return lookup(hash_int(key), &key, 0);
+}
+
+size_t HashIndex::find(const char *s, size_t len) const {
+    if (_kind != KKEY_STRING && _kind != KKEY_STRING_REF) {
+        return KNPOS;
+    }
+    return lookup(hash_string(s, len), s, len);
+}
+
+size_t HashIndex::find_key(const void *key) const {
+    if (_kind != KKEY_CUSTOM) {
+        return KNPOS;
+    }
+    return lookup(_ops.hash(key), key, 0);
+}
+
+void HashIndex::insert_range(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        insert(static_cast<uint32_t>(i));
+    }
+}
+
+void HashIndex::insert(uint32_t row) {
+    uint64_t hash = row_hash(row);
+    uint64_t desired = make_slot(hash, row);
+    uint64_t pos = hash & _mask;
+
+    // 多线程并发插入, 相同的键保留行号最小的行
+    while (true) {
+        uint64_t cur = _slots[pos].load(std::memory_order_relaxed);
+        if (cur == 0) {
+            if (_slots[pos].compare_exchange_weak(cur, desired,
+                                                  std::memory_order_relaxed)) {
+                return;
+            }
+            continue;
+        }
+        if (same_tag(cur, hash) && row_equal(slot_row(cur), row)) {
+            if (slot_row(cur) < row) {
+                return;
+            }
+            if (_slots[pos].compare_exchange_weak(cur, desired,
+                                                  std::memory_order_relaxed)) {
+                return;
+            }
+            continue;
+        }
+        pos = (pos + 1) & _mask;
+    }
+}
+
+uint64_t HashIndex::row_hash(uint32_t row) const {
+    const char *f = field(row);
+    switch (_kind) {
+        case KKEY_INT:
+            return hash_int(int_key(f));
+        case KKEY_STRING:
+        case KKEY_STRING_REF: {
+            StringRef key = string_key(f);
+            return hash_string(key.data, key.size);
+        }
+        default:
+            return _ops.hash(f);
+    }
+}
+
+bool HashIndex::row_equal(uint32_t a, uint32_t b) const {
+    const char *fb = field(b);
+    switch (_kind) {
+        case KKEY_INT: {
+            int64_t key = int_key(fb);
+            return key_equal(field(a), &key, 0);
+        }
+        case KKEY_STRING:
+        case KKEY_STRING_REF: {
+            StringRef key = string_key(fb);
+            return key_equal(field(a), key.data, key.size);
+        }
+        default:
+            return key_equal(field(a), fb, 0);
+    }
+}
+
+int64_t HashIndex::int_key(const char *field) const {
+    switch (_key.type) {
+        case KINT64: {
+            int64_t v;
+            memcpy(&v, field, sizeof(v));
+            return v;
+        }
+        case KUINT32: {
+            uint32_t v;
+            memcpy(&v, field, sizeof(v));
+            return v;
+        }
+        case KUINT64: {
+            uint64_t v;
+            memcpy(&v, field, sizeof(v));
+            return static_cast<int64_t>(v);
+        }
+        default: {
+            int v;
+            memcpy(&v, field, sizeof(v));
+            return v;
+        }
+    }
+}
+
+StringRef HashIndex::string_key(const char *field) const {
+    if (_kind == KKEY_STRING_REF) {
+        StringRef ref;
+        memcpy(&ref, field, sizeof(ref));
+        return ref;
+    }
+    StringRef ref = {field, strnlen(field, _key.element_size)};
+    return ref;
+}
+
+bool HashIndex::key_equal(const char *field, const void *key,
+                          size_t len) const {
+    switch (_kind) {
+        case KKEY_INT:
+            return int_key(field) == *static_cast<const int64_t *>(key);
+        case KKEY_STRING:
+        case KKEY_STRING_REF:
+            return string_key(field).equals(static_cast<const char *>(key),
+                                            len);
+        default:
+            return _ops.equal(field, key);
+    }
+}
+
+size_t HashIndex::lookup(uint64_t hash, const void *key, size_t len) const {
+    uint64_t pos = hash & _mask;
+    while (true) {
+        uint64_t slot = _slots[pos].load(std::memory_order_relaxed);
+        if (slot == 0) {
+            return KNPOS;
+        }
+        if (same_tag(slot, hash) && key_equal(field(slot_row(slot)), key, len)) {
+            return slot_row(slot);
+        }
+        pos = (pos + 1) & _mask;
+    }
+}
+}
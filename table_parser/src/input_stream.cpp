@@ -0,0 +1,122 @@
+#include "input_stream.h"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tp {
+
+FdInputStream::FdInputStream(int fd) : _fd(fd) {}
+
+long FdInputStream::read(char *buf, size_t len) {
+    while (true) {
+        ssize_t n = ::read(_fd, buf, len);
+        if (n >= 0) {
+            return static_cast<long>(n);
+        }
+        // 被信号中断时重试
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+FileInputStream::FileInputStream(const char *path)
+    : _fd(::open(path, O_RDONLY | O_CLOEXEC)) {}
+
+FileInputStream::~FileInputStream() {
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+bool FileInputStream::ok() const { return _fd >= 0; }
+
+int FileInputStream::fd() const { return _fd; }
+
+long FileInputStream::read(char *buf, size_t len) {
+    if (_fd < 0) {
+        return -1;
+    }
+    FdInputStream in(_fd);
+    return in.read(buf, len);
+}
+
+IstreamInputStream::IstreamInputStream(std::istream &in) : _in(in) {}
+
+long IstreamInputStream::read(char *buf, size_t len) {
+    if (_in.bad()) {
+        return -1;
+    }
+    if (_in.eof()) {
+        return 0;
+    }
+
+    _in.read(buf, static_cast<std::streamsize>(len));
+    if (_in.bad()) {
+        return -1;
+    }
+    return static_cast<long>(_in.gcount());
+}
+
+MappedFile::MappedFile() : _addr(nullptr), _length(0), _size(0) {}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const char *path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // 先保留文件大小向上取整再加一页的地址空间, 再把文件映射到前部,
+    // 最后一页中文件之后的部分和多出的一页都是0
+    size_t size = static_cast<size_t>(st.st_size);
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t length = (size + page - 1) / page * page + page;
+    void *addr = ::mmap(nullptr, length, PROT_READ,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    if (size > 0 && ::mmap(addr, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd,
+                           0) == MAP_FAILED) {
+        ::munmap(addr, length);
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+
+    _addr = addr;
+    _length = length;
+    _size = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (_addr) {
+        ::munmap(_addr, _length);
+    }
+    _addr = nullptr;
+    _length = 0;
+    _size = 0;
+}
+
+const char *MappedFile::data() const {
+    return _addr ? static_cast<const char *>(_addr) : "";
+}
+
+size_t MappedFile::size() const { return _size; }
+}
@@ -0,0 +1,66 @@
+#include "managed_table.h"
+
+#include <functional>
+
+namespace tp {
+
+const size_t EpochManager::KDEFAULT_READERS;
+const size_t EpochManager::KOVERFLOW_SLOT;
+
+EpochManager::EpochManager(size_t slots)
+    : _slot_count(slots > 0 ? slots : KDEFAULT_READERS),
+      _slots(new Slot[_slot_count]),
+      _epoch(1),
+      _overflow(0) {
+    for (size_t i = 0; i < _slot_count; ++i) {
+        _slots[i].epoch.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t EpochManager::enter() {
+    // 按线程散列起始槽位, 同一线程通常总是命中同一条缓存行
+    static thread_local size_t hint =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    size_t start = hint % _slot_count;
+    size_t slot = start;
+    do {
+        uint64_t idle = 0;
+        uint64_t epoch = _epoch.load();
+        // 登记必须先于读取数据指针, 二者均为顺序一致操作
+        if (_slots[slot].epoch.compare_exchange_strong(idle, epoch)) {
+            return slot;
+        }
+        slot = (slot + 1) % _slot_count;
+    } while (slot != start);
+
+    // 槽位已满, 登记到溢出计数上
+    _overflow.fetch_add(1);
+    return KOVERFLOW_SLOT;
+}
+
+void EpochManager::leave(size_t slot) {
+    if (slot == KOVERFLOW_SLOT) {
+        _overflow.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    _slots[slot].epoch.store(0, std::memory_order_release);
+}
+
+uint64_t EpochManager::advance() { return _epoch.fetch_add(1); }
+
+uint64_t EpochManager::safe_epoch() const {
+    // 溢出读者的纪元未知, 可能持有任何版本
+    if (_overflow.load() > 0) {
+        return 0;
+    }
+    uint64_t safe = _epoch.load();
+    for (size_t i = 0; i < _slot_count; ++i) {
+        uint64_t epoch = _slots[i].epoch.load();
+        if (epoch != 0 && epoch < safe) {
+            safe = epoch;
+        }
+    }
+    return safe;
+}
+}
@@ -0,0 +1,91 @@
+#include "parallel_parser.h"
+
+#include <cstring>
+
+namespace tp {
+
+static unsigned count_lines(const char *begin, const char *end) {
+    unsigned ret = 0;
+    const char *p = begin;
+    while (p < end) {
+        const void *nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        if (!nl) {
+            break;
+        }
+        ++ret;
+        p = static_cast<const char *>(nl) + 1;
+    }
+    return ret;
+}
+
+void split_chunks(const char *src, size_t len, size_t max_chunks,
+                  size_t min_chunk_size, unsigned threads,
+                  std::vector<TextChunk> &chunks) {
+    const char *src_end = src + len;
+
+    size_t n = min_chunk_size > 0 ? len / min_chunk_size : len;
+    if (n > max_chunks) {
+        n = max_chunks;
+    }
+    if (n == 0) {
+        n = 1;
+    }
+
+    // 在目标位置之后的第一个换行符处切分
+    std::vector<TextChunk> ret;
+    const char *begin = src;
+    for (size_t k = 1; k < n && begin < src_end; ++k) {
+        const char *target = src + len / n * k;
+        if (target < begin) {
+            target = begin;
+        }
+        const void *nl =
+            std::memchr(target, '\n', static_cast<size_t>(src_end - target));
+        if (!nl) {
+            break;
+        }
+        const char *end = static_cast<const char *>(nl) + 1;
+        TextChunk chunk = {begin, end, 0, 0};
+        ret.push_back(chunk);
+        begin = end;
+    }
+    TextChunk last = {begin, src_end, 0, 0};
+    ret.push_back(last);
+
+    // 并行统计每段的行数, 再计算每段的起始行号
+    std::vector<unsigned> lines(ret.size(), 0);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < ret.size(); i = next++) {
+            lines[i] = count_lines(ret[i].begin, ret[i].end);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads && i < ret.size(); ++i) {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    unsigned line = 1;
+    for (size_t i = 0; i < ret.size(); ++i) {
+        ret[i].first_line = line;
+        line += lines[i];
+        // 只有最后一段可能以没有换行符的行结尾
+        ret[i].max_rows = lines[i];
+        if (ret[i].end > ret[i].begin && ret[i].end[-1] != '\n') {
+            ++ret[i].max_rows;
+        }
+    }
+
+    chunks.swap(ret);
+}
+
+unsigned default_thread_count() {
+    unsigned ret = std::thread::hardware_concurrency();
+    return ret > 0 ? ret : 1;
+}
+}
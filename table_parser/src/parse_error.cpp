@@ -0,0 +1,139 @@
+#include "parse_error.h"
+
+#include <cstdio>
+
+namespace tp {
+
+int ParseError::format(char *buf, size_t size) const {
+    switch (code) {
+        case KERR_OK:
+            return std::snprintf(buf, size, "[OK] line %u: parse success",
+                                 line);
+        case KERR_ELEMENT_REQUIRED:
+            return std::snprintf(
+                buf, size, "[ERROR] line %u: element %u required in input.",
+                line, column);
+        case KERR_MORE_ELEMENT:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: more element found in "
+                                 "input after element %u.",
+                                 line, column);
+        case KERR_PARSE_FAILED:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: element %u parse failed.",
+                                 line, column);
+        case KERR_SIZE_REQUIRED:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: array size required near element %u.", line,
+                column);
+        case KERR_UNEXPECTED_CHAR:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: unexpected character near element %u.", line,
+                column);
+        case KERR_SIZE_OUT_OF_RANGE:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: array size out of range near element %u.",
+                line, column);
+        case KERR_UNEXPECTED_TAB:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: unexpected column splitter "
+                                 "near element %u.",
+                                 line, column);
+        case KERR_UNEXPECTED_EOF:
+            return std::snprintf(
+                buf, size, "[ERROR] line %u: unexpected eof near element %u.",
+                line, column);
+        case KERR_UNEXPECTED_NEWLINE:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: unexpected new line near element %u.", line,
+                column);
+        case KERR_MORE_ARRAY_ELEMENT:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: more array element found "
+                                 "near element %u.",
+                                 line, column);
+        case KERR_READ_FAILED:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: read input failed.", line);
+        case KERR_OUT_OF_BOUNDARY:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: element %u memory out of boundary.", line,
+                column);
+        case KERR_CALLBACK_REQUIRED:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: user-defined callback "
+                                 "required at element %u.",
+                                 line, column);
+        case KERR_ENUM_TABLE_REQUIRED:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: enum table required at element %u.", line,
+                column);
+        case KERR_STRING_ARENA_REQUIRED:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: string arena required at element %u.", line,
+                column);
+        case KERR_NO_ROW_LAYOUT:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: plan has no row layout.",
+                                 line);
+        case KERR_ROW_TOO_SMALL:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: output smaller than plan row size.", line);
+        case KERR_STRING_VIEW_IN_STREAM:
+            return std::snprintf(buf, size,
+                                 "[ERROR] line %u: string view column "
+                                 "requires in-memory input.",
+                                 line);
+        case KERR_FILTER_COLUMN:
+            return std::snprintf(
+                buf, size, "[ERROR] line %u: filter refers to element %u.",
+                line, column);
+        default:
+            return std::snprintf(
+                buf, size,
+                "[ERROR] line %u: unknown element type at element %u.", line,
+                column);
+    }
+}
+
+const char *error_code_name(ErrorCode code) {
+    static const char *const KNAMES[KERROR_CODE_COUNT] = {
+        "OK",
+        "ELEMENT_REQUIRED",
+        "MORE_ELEMENT",
+        "PARSE_FAILED",
+        "SIZE_REQUIRED",
+        "UNEXPECTED_CHAR",
+        "SIZE_OUT_OF_RANGE",
+        "UNEXPECTED_TAB",
+        "UNEXPECTED_EOF",
+        "UNEXPECTED_NEWLINE",
+        "MORE_ARRAY_ELEMENT",
+        "READ_FAILED",
+        "OUT_OF_BOUNDARY",
+        "CALLBACK_REQUIRED",
+        "ENUM_TABLE_REQUIRED",
+        "STRING_ARENA_REQUIRED",
+        "UNKNOWN_TYPE",
+        "NO_ROW_LAYOUT",
+        "ROW_TOO_SMALL",
+        "STRING_VIEW_IN_STREAM",
+        "FILTER_COLUMN"};
+    size_t idx = static_cast<size_t>(code);
+    return idx < KERROR_CODE_COUNT ? KNAMES[idx] : "UNKNOWN";
+}
+
+std::string ParseError::message() const {
+    char buf[128];
+    format(buf, sizeof(buf));
+    return buf;
+}
+}
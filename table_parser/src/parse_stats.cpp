@@ -0,0 +1,159 @@
+#include "parse_stats.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace tp {
+
+static const char *const KTYPE_NAMES[KDATA_TYPE_COUNT] = {
+    "none",  "int",    "float", "string", "class",       "int64",
+    "uint32", "uint64", "double", "bool", "enum", "string_view",
+    "string_intern"};
+
+static void merge_field(FieldStats *to, const FieldStats &from) {
+    to->calls += from.calls;
+    to->nanos += from.nanos;
+    to->bytes += from.bytes;
+    if (from.longest > to->longest) {
+        to->longest = from.longest;
+        to->longest_line = from.longest_line;
+    }
+}
+
+// 字段统计的一行, 没有调用时不输出
+static void dump_field(std::string &out, const char *name,
+                       const FieldStats &f) {
+    if (f.calls == 0) {
+        return;
+    }
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "  %-14s %10llu calls %12.3f ms %9.1f ns/field %12llu bytes "
+             "longest %zu (line %u)\n",
+             name, static_cast<unsigned long long>(f.calls),
+             static_cast<double>(f.nanos) / 1e6,
+             static_cast<double>(f.nanos) / static_cast<double>(f.calls),
+             static_cast<unsigned long long>(f.bytes), f.longest,
+             f.longest_line);
+    out += buf;
+}
+
+bool stats_enabled() {
+#ifdef TP_ENABLE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t stats_clock_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+ParseStats::ParseStats() { reset(); }
+
+void ParseStats::reset() {
+    rows = 0;
+    ok_rows = 0;
+    failed_rows = 0;
+    filtered_rows = 0;
+    bytes = 0;
+    nanos = 0;
+    cpu_nanos = 0;
+    longest_line = 0;
+    longest_line_no = 0;
+    columns.clear();
+    memset(types, 0, sizeof(types));
+    memset(errors, 0, sizeof(errors));
+}
+
+void ParseStats::merge(const ParseStats &other) {
+    rows += other.rows;
+    ok_rows += other.ok_rows;
+    failed_rows += other.failed_rows;
+    filtered_rows += other.filtered_rows;
+    bytes += other.bytes;
+    nanos += other.nanos;
+    cpu_nanos += other.cpu_nanos;
+    if (other.longest_line > longest_line) {
+        longest_line = other.longest_line;
+        longest_line_no = other.longest_line_no;
+    }
+
+    if (columns.size() < other.columns.size()) {
+        FieldStats empty = {0, 0, 0, 0, 0};
+        columns.resize(other.columns.size(), empty);
+    }
+    for (size_t i = 0; i < other.columns.size(); ++i) {
+        merge_field(&columns[i], other.columns[i]);
+    }
+    for (size_t i = 0; i < KDATA_TYPE_COUNT; ++i) {
+        merge_field(&types[i], other.types[i]);
+    }
+    for (size_t i = 0; i < KERROR_CODE_COUNT; ++i) {
+        errors[i] += other.errors[i];
+    }
+}
+
+void ParseStats::merge_concurrent(const std::vector<ParseStats> &parts,
+                                  uint64_t wall_nanos) {
+    ParseStats total;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        total.merge(parts[i]);
+    }
+    total.nanos = wall_nanos;
+    merge(total);
+}
+
+double ParseStats::rows_per_second() const {
+    if (nanos == 0) {
+        return 0;
+    }
+    return static_cast<double>(rows) * 1e9 / static_cast<double>(nanos);
+}
+
+std::string ParseStats::dump() const {
+    std::string out;
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "rows %llu (ok %llu, failed %llu, filtered %llu), bytes %llu, "
+             "%.3f ms (cpu %.3f ms), %.0f rows/s\n",
+             static_cast<unsigned long long>(rows),
+             static_cast<unsigned long long>(ok_rows),
+             static_cast<unsigned long long>(failed_rows),
+             static_cast<unsigned long long>(filtered_rows),
+             static_cast<unsigned long long>(bytes),
+             static_cast<double>(nanos) / 1e6,
+             static_cast<double>(cpu_nanos) / 1e6, rows_per_second());
+    out += buf;
+    snprintf(buf, sizeof(buf), "longest line %zu bytes (line %u)\n",
+             longest_line, longest_line_no);
+    out += buf;
+
+    out += "columns:\n";
+    for (size_t i = 0; i < columns.size(); ++i) {
+        snprintf(buf, sizeof(buf), "%zu", i);
+        dump_field(out, buf, columns[i]);
+    }
+
+    out += "types:\n";
+    for (size_t i = 0; i < KDATA_TYPE_COUNT; ++i) {
+        dump_field(out, KTYPE_NAMES[i], types[i]);
+    }
+
+    out += "errors:\n";
+    for (size_t i = 0; i < KERROR_CODE_COUNT; ++i) {
+        if (errors[i] > 0) {
+            snprintf(buf, sizeof(buf), "  %-22s %llu\n",
+                     error_code_name(static_cast<ErrorCode>(i)),
+                     static_cast<unsigned long long>(errors[i]));
+            out += buf;
+        }
+    }
+    return out;
+}
+}
@@ -0,0 +1,295 @@
+#include "pipelined_input.h"
+
+#include <climits>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace tp {
+
+GzipInputStream::GzipInputStream(InputStream *in, size_t buffer_size)
+    : _in(in),
+      _zs(new z_stream),
+      _buf(buffer_size > 0 ? buffer_size : 1),
+      _in_eof(false),
+      _member_end(false),
+      _failed(false) {
+    std::memset(_zs, 0, sizeof(*_zs));
+    // 15为最大窗口, 加32表示自动识别gzip和zlib头
+    if (inflateInit2(_zs, 15 + 32) != Z_OK) {
+        delete _zs;
+        _zs = nullptr;
+    }
+}
+
+GzipInputStream::~GzipInputStream() {
+    if (_zs) {
+        inflateEnd(_zs);
+        delete _zs;
+    }
+}
+
+bool GzipInputStream::ok() const { return _zs != nullptr; }
+
+long GzipInputStream::read(char *buf, size_t len) {
+    if (!_zs || _failed) {
+        return -1;
+    }
+
+    uInt avail = len > UINT_MAX ? UINT_MAX : static_cast<uInt>(len);
+    _zs->next_out = reinterpret_cast<Bytef *>(buf);
+    _zs->avail_out = avail;
+
+    // 至少产生一个字节后返回
+    while (_zs->avail_out == avail && avail > 0) {
+        if (_zs->avail_in == 0 && !_in_eof) {
+            long n = _in->read(&_buf[0], _buf.size());
+            if (n < 0) {
+                _failed = true;
+                return -1;
+            }
+            _in_eof = n == 0;
+            _zs->next_in = reinterpret_cast<Bytef *>(&_buf[0]);
+            _zs->avail_in = static_cast<uInt>(n);
+        }
+
+        if (_member_end) {
+            if (_zs->avail_in == 0) {
+                if (_in_eof) {
+                    return 0;
+                }
+                continue;
+            }
+            // 后面还有数据, 按下一个gzip成员处理
+            inflateReset(_zs);
+            _member_end = false;
+        }
+
+        if (_zs->avail_in == 0 && _in_eof) {
+            // 压缩数据被截断
+            _failed = true;
+            return -1;
+        }
+
+        int ret = inflate(_zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            _member_end = true;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            _failed = true;
+            return -1;
+        }
+    }
+
+    return static_cast<long>(avail - _zs->avail_out);
+}
+
+BlockPipeline::BlockPipeline(InputStream *in, size_t block_size,
+                             size_t ring_size)
+    : _in(in),
+      _block_size(block_size > 0 ? block_size : 1),
+      _slots(ring_size > 2 ? ring_size : 2),
+      _offset(0),
+      _line(1),
+      _seq(0),
+      _in_eof(false),
+      _done(false),
+      _stopped(false),
+      _failed(false) {
+    for (size_t i = 0; i < _slots.size(); ++i) {
+        _free.push_back(&_slots[i]);
+    }
+    _reader = std::thread(&BlockPipeline::run, this);
+}
+
+BlockPipeline::~BlockPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+    }
+    _slot_freed.notify_all();
+    _reader.join();
+}
+
+const TextBlock *BlockPipeline::acquire() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _block_ready.wait(lock, [this]() { return _done || !_ready.empty(); });
+    if (_ready.empty()) {
+        return nullptr;
+    }
+    TextBlock *block = _ready.front();
+    _ready.pop_front();
+    return block;
+}
+
+void BlockPipeline::release(const TextBlock *block) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _free.push_back(const_cast<TextBlock *>(block));
+    }
+    _slot_freed.notify_one();
+}
+
+bool BlockPipeline::failed() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _failed;
+}
+
+size_t BlockPipeline::total_bytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _offset;
+}
+
+unsigned BlockPipeline::next_line() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _line;
+}
+
+void BlockPipeline::run() {
+    while (!_in_eof) {
+        TextBlock *block = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _slot_freed.wait(lock,
+                             [this]() { return _stopped || !_free.empty(); });
+            if (_stopped) {
+                break;
+            }
+            block = _free.front();
+            _free.pop_front();
+        }
+
+        // 读取和解压不持有锁
+        bool failed = false;
+        bool filled = fill(*block, &failed);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (filled) {
+                _ready.push_back(block);
+            } else {
+                _free.push_back(block);
+            }
+            _failed = _failed || failed;
+        }
+        _block_ready.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done = true;
+    }
+    _block_ready.notify_all();
+}
+
+// 块末尾最后一个换行符之后的位置, 没有换行符时返回0
+static size_t last_line_end(const char *data, size_t size) {
+    for (size_t i = size; i > 0; --i) {
+        if (data[i - 1] == '\n') {
+            return i;
+        }
+    }
+    return 0;
+}
+
+bool BlockPipeline::fill(TextBlock &block, bool *failed) {
+    std::vector<char> &data = block.data;
+    if (data.size() < _block_size + 1) {
+        data.resize(_block_size + 1);
+    }
+
+    // 先放入上一块末尾未结束的行
+    size_t size = _carry.size();
+    if (data.size() < size + 1) {
+        data.resize(size * 2 + 1);
+    }
+    if (size > 0) {
+        std::memcpy(&data[0], &_carry[0], size);
+    }
+    _carry.clear();
+
+    size_t end = 0;
+    while (true) {
+        if (size + 1 == data.size()) {
+            // 块已满, 在最后一个换行符处切分; 行比块长时扩大块
+            end = last_line_end(&data[0], size);
+            if (end > 0) {
+                break;
+            }
+            data.resize(data.size() * 2);
+        }
+
+        long n = _in->read(&data[size], data.size() - 1 - size);
+        if (n <= 0) {
+            *failed = n < 0;
+            _in_eof = true;
+            end = size;
+            break;
+        }
+        size += static_cast<size_t>(n);
+    }
+
+    _carry.assign(data.begin() + static_cast<ptrdiff_t>(end),
+                  data.begin() + static_cast<ptrdiff_t>(size));
+    if (end == 0) {
+        return false;
+    }
+
+    data[end] = '\0';
+    block.size = end;
+    block.offset = _offset;
+    block.first_line = _line;
+    block.seq = _seq++;
+
+    unsigned lines = 0;
+    for (const char *p = &data[0], *last = &data[end];;) {
+        const void *nl = std::memchr(p, '\n', static_cast<size_t>(last - p));
+        if (!nl) {
+            break;
+        }
+        ++lines;
+        p = static_cast<const char *>(nl) + 1;
+    }
+
+    // 计数器在acquire返回nullptr之后才被读取, 仍加锁以保持一致
+    std::lock_guard<std::mutex> lock(_mutex);
+    _offset += end;
+    _line += lines;
+    return true;
+}
+
+PipelinedInputStream::PipelinedInputStream(InputStream *in,
+                                           size_t block_size,
+                                           size_t ring_size)
+    : _pipeline(in, block_size, ring_size), _block(nullptr), _pos(0) {}
+
+PipelinedInputStream::~PipelinedInputStream() {
+    if (_block) {
+        _pipeline.release(_block);
+    }
+}
+
+long PipelinedInputStream::read(char *buf, size_t len) {
+    while (true) {
+        if (!_block) {
+            _block = _pipeline.acquire();
+            _pos = 0;
+            if (!_block) {
+                return _pipeline.failed() ? -1 : 0;
+            }
+        }
+
+        if (_pos < _block->size) {
+            size_t n = _block->size - _pos;
+            if (n > len) {
+                n = len;
+            }
+            std::memcpy(buf, &_block->data[_pos], n);
+            _pos += n;
+            return static_cast<long>(n);
+        }
+
+        _pipeline.release(_block);
+        _block = nullptr;
+    }
+}
+}
@@ -0,0 +1,87 @@
+#include "row_filter.h"
+
+#include "field_parser.h"
+
+namespace tp {
+
+RowFilter::RowFilter() : _select_all(true), _column_bound(0) {}
+
+RowFilter &RowFilter::select(unsigned column) {
+    _select_all = false;
+    if (_selected.size() <= column) {
+        _selected.resize(column + 1, 0);
+    }
+    _selected[column] = 1;
+    if (_column_bound <= column) {
+        _column_bound = column + 1;
+    }
+    return *this;
+}
+
+RowFilter &RowFilter::equal(unsigned column, const std::string &value) {
+    Predicate p = {KEQUAL, column, value, 0, 0, 0.0, 0.0};
+    return add(p);
+}
+
+RowFilter &RowFilter::prefix(unsigned column, const std::string &value) {
+    Predicate p = {KPREFIX, column, value, 0, 0, 0.0, 0.0};
+    return add(p);
+}
+
+RowFilter &RowFilter::int_range(unsigned column, int64_t min, int64_t max) {
+    Predicate p = {KINT_RANGE, column, std::string(), min, max, 0.0, 0.0};
+    return add(p);
+}
+
+RowFilter &RowFilter::float_range(unsigned column, double min, double max) {
+    Predicate p = {KFLOAT_RANGE, column, std::string(), 0, 0, min, max};
+    return add(p);
+}
+
+unsigned RowFilter::column_bound() const { return _column_bound; }
+
+bool RowFilter::match(const StringRef fields[]) const {
+    for (size_t i = 0; i < _predicates.size(); ++i) {
+        const Predicate &p = _predicates[i];
+        const StringRef &f = fields[p.column];
+        switch (p.kind) {
+            case KEQUAL:
+                if (!f.equals(p.value.data(), p.value.size())) {
+                    return false;
+                }
+                break;
+            case KPREFIX:
+                if (f.size < p.value.size() ||
+                    memcmp(f.data, p.value.data(), p.value.size()) != 0) {
+                    return false;
+                }
+                break;
+            case KINT_RANGE: {
+                int64_t value = 0;
+                if (!parse_signed(f.data, f.size, INT64_MAX, &value) ||
+                    value < p.int_min || value > p.int_max) {
+                    return false;
+                }
+                break;
+            }
+            case KFLOAT_RANGE: {
+                double value = 0;
+                if (!parse_double(f.data, f.size, &value) ||
+                    !(value >= p.float_min && value <= p.float_max)) {
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+RowFilter &RowFilter::add(const Predicate &predicate) {
+    _predicates.push_back(predicate);
+    if (_column_bound <= predicate.column) {
+        _column_bound = predicate.column + 1;
+    }
+    return *this;
+}
+}
@@ -0,0 +1,10 @@
+#include "schema.h"
+
+namespace tp {
+
+void format_field_error(char *buf, size_t size, FieldError error,
+                        unsigned line, unsigned column) {
+    ParseError e = {static_cast<ErrorCode>(error), line, column, 0};
+    e.format(buf, size);
+}
+}
@@ -0,0 +1,194 @@
+#include "snapshot.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_util.h"
+
+namespace tp {
+
+namespace {
+
+const char KSNAPSHOT_MAGIC[8] = {'T', 'P', 'S', 'N', 'A', 'P', '\0', '\0'};
+const uint32_t KBYTE_ORDER_MARK = 0x01020304u;
+// 行数据起始偏移, 保证行数据按缓存行对齐
+const size_t KROWS_OFFSET = 64;
+
+/**
+ * @brief 快照文件头
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t schema_hash;
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t row_size;
+    uint64_t row_count;
+};
+
+static_assert(sizeof(SnapshotHeader) <= KROWS_OFFSET,
+              "snapshot header too large");
+}
+
+bool stat_source(const char *path, SourceStamp *stamp) {
+    struct stat st;
+    if (::stat(path, &st) != 0) {
+        return false;
+    }
+    stamp->size = static_cast<uint64_t>(st.st_size);
+    stamp->mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+                      st.st_mtim.tv_nsec;
+    stamp->dev = static_cast<uint64_t>(st.st_dev);
+    stamp->inode = static_cast<uint64_t>(st.st_ino);
+    return true;
+}
+
+bool same_source(const SourceStamp &a, const SourceStamp &b) {
+    return a.size == b.size && a.mtime_ns == b.mtime_ns && a.dev == b.dev &&
+           a.inode == b.inode;
+}
+
+uint64_t schema_hash(const ColumnDescriptor desc[], size_t row_size,
+                     uint64_t user_version) {
+    uint64_t hash = KFNV_OFFSET;
+    fnv_update(&hash, KSNAPSHOT_VERSION);
+    fnv_update(&hash, row_size);
+    fnv_update(&hash, user_version);
+    for (size_t i = 0; desc[i].type != KNONE; ++i) {
+        const ColumnDescriptor &col = desc[i];
+        fnv_update(&hash, static_cast<uint64_t>(col.type));
+        fnv_update(&hash, col.is_array);
+        fnv_update(&hash, col.array_max);
+        fnv_update(&hash, col.element_size);
+        fnv_update(&hash, static_cast<uint64_t>(col.offset));
+        fnv_update(&hash, static_cast<uint64_t>(col.array_counter_offset));
+
+        // 枚举映射变化时快照中的枚举值随之失效
+        const EnumTable *table = static_cast<const EnumTable *>(col.context);
+        if (col.type == KENUM && table) {
+            fnv_update(&hash, table->size());
+            for (size_t j = 0; j < table->size(); ++j) {
+                const std::string &name = table->name(j);
+                fnv_update(&hash, name.size());
+                fnv_update(&hash, name.data(), name.size());
+                fnv_update(&hash, static_cast<uint64_t>(
+                                      static_cast<int64_t>(table->value(j))));
+            }
+        }
+    }
+    return hash;
+}
+
+bool snapshot_supported(const ColumnDescriptor desc[], uint64_t user_version) {
+    for (size_t i = 0; desc[i].type != KNONE; ++i) {
+        if (desc[i].type == KSTRING_VIEW || desc[i].type == KSTRING_INTERN) {
+            return false;
+        }
+        // 回调和context的语义无法哈希, 只能由user_version标识
+        if (desc[i].type == KCLASS && user_version == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_snapshot(const char *path, uint64_t hash, const SourceStamp &stamp,
+                    const void *rows, size_t row_size, size_t row_count) {
+    char header_buf[KROWS_OFFSET];
+    memset(header_buf, 0, sizeof(header_buf));
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KSNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = KSNAPSHOT_VERSION;
+    header.byte_order = KBYTE_ORDER_MARK;
+    header.schema_hash = hash;
+    header.source_size = stamp.size;
+    header.source_mtime_ns = stamp.mtime_ns;
+    header.row_size = row_size;
+    header.row_count = row_count;
+    memcpy(header_buf, &header, sizeof(header));
+
+    // 原子替换, 读者不会看到写了一半的快照
+    FileChunk chunks[] = {{header_buf, sizeof(header_buf)},
+                          {rows, row_size * row_count}};
+    return replace_file(path, chunks, 2);
+}
+
+MappedSnapshot::MappedSnapshot()
+    : _addr(nullptr), _length(0), _rows(nullptr), _row_count(0) {}
+
+MappedSnapshot::~MappedSnapshot() { close(); }
+
+bool MappedSnapshot::open(const char *path, uint64_t hash, size_t row_size,
+                          const SourceStamp *stamp) {
+    close();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < KROWS_OFFSET) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void *addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, addr, sizeof(header));
+
+    bool valid =
+        memcmp(header.magic, KSNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == KSNAPSHOT_VERSION &&
+        header.byte_order == KBYTE_ORDER_MARK && header.schema_hash == hash &&
+        header.row_size == row_size;
+    if (valid && stamp) {
+        valid = header.source_size == stamp->size &&
+                header.source_mtime_ns == stamp->mtime_ns;
+    }
+    // 文件被截断时拒绝使用
+    if (valid) {
+        valid = row_size > 0 && header.row_count <= (length - KROWS_OFFSET) /
+                                                         row_size;
+    }
+    if (!valid) {
+        ::munmap(addr, length);
+        return false;
+    }
+
+    _addr = addr;
+    _length = length;
+    _rows = static_cast<const char *>(addr) + KROWS_OFFSET;
+    _row_count = static_cast<size_t>(header.row_count);
+    return true;
+}
+
+void MappedSnapshot::close() {
+    if (_addr) {
+        ::munmap(_addr, _length);
+    }
+    _addr = nullptr;
+    _length = 0;
+    _rows = nullptr;
+    _row_count = 0;
+}
+
+const void *MappedSnapshot::rows() const { return _rows; }
+
+size_t MappedSnapshot::row_count() const { return _row_count; }
+}
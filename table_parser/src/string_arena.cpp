@@ -0,0 +1,130 @@
+#include "string_arena.h"
+
+#include <cstdint>
+
+namespace tp {
+
+static_assert((StringArena::KSHARD_COUNT & (StringArena::KSHARD_COUNT - 1)) ==
+                  0,
+              "KSHARD_COUNT must be a power of two");
+
+const size_t StringArena::KSHARD_COUNT;
+
+// 槽位用哈希的低位, 分片用高位, 二者互不相关
+static inline size_t slot_hash(uint64_t h) {
+    return static_cast<size_t>(h ^ (h >> 32));
+}
+
+static inline size_t shard_of(uint64_t h) {
+    return static_cast<size_t>(h >> 56) & (StringArena::KSHARD_COUNT - 1);
+}
+
+StringArena::StringArena(size_t block_size)
+    : _block_size(block_size > 0 ? block_size : 1) {
+    StringRef empty = {nullptr, 0};
+    for (size_t i = 0; i < KSHARD_COUNT; ++i) {
+        Shard &shard = _shards[i];
+        shard.block = nullptr;
+        shard.block_used = 0;
+        shard.allocated = 0;
+        shard.slots.assign(16, empty);
+        shard.count = 0;
+    }
+}
+
+StringRef StringArena::intern(const char *s, size_t len) {
+    uint64_t h = hash(s, len);
+    Shard &shard = _shards[shard_of(h)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::vector<StringRef> &slots = shard.slots;
+    size_t mask = slots.size() - 1;
+    size_t pos = slot_hash(h) & mask;
+    while (slots[pos].data) {
+        if (slots[pos].equals(s, len)) {
+            return slots[pos];
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    char *copy = allocate(shard, len + 1);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    StringRef ref = {copy, len};
+    slots[pos] = ref;
+
+    // 负载因子不超过0.5
+    if (++shard.count * 2 > slots.size()) {
+        rehash(shard);
+    }
+    return ref;
+}
+
+size_t StringArena::size() const {
+    size_t count = 0;
+    for (size_t i = 0; i < KSHARD_COUNT; ++i) {
+        const Shard &shard = _shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.count;
+    }
+    return count;
+}
+
+size_t StringArena::allocated_bytes() const {
+    size_t allocated = 0;
+    for (size_t i = 0; i < KSHARD_COUNT; ++i) {
+        const Shard &shard = _shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        allocated += shard.allocated;
+    }
+    return allocated;
+}
+
+char *StringArena::allocate(Shard &shard, size_t len) {
+    // 长字符串单独分配, 不浪费当前块的剩余空间
+    if (len > _block_size / 4) {
+        shard.blocks.push_back(std::unique_ptr<char[]>(new char[len]));
+        shard.allocated += len;
+        return shard.blocks.back().get();
+    }
+
+    if (!shard.block || shard.block_used + len > _block_size) {
+        shard.blocks.push_back(
+            std::unique_ptr<char[]>(new char[_block_size]));
+        shard.allocated += _block_size;
+        shard.block = shard.blocks.back().get();
+        shard.block_used = 0;
+    }
+    char *p = shard.block + shard.block_used;
+    shard.block_used += len;
+    return p;
+}
+
+void StringArena::rehash(Shard &shard) {
+    StringRef empty = {nullptr, 0};
+    std::vector<StringRef> slots(shard.slots.size() * 2, empty);
+    size_t mask = slots.size() - 1;
+    for (size_t i = 0; i < shard.slots.size(); ++i) {
+        const StringRef &ref = shard.slots[i];
+        if (!ref.data) {
+            continue;
+        }
+        size_t pos = slot_hash(hash(ref.data, ref.size)) & mask;
+        while (slots[pos].data) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = ref;
+    }
+    shard.slots.swap(slots);
+}
+
+uint64_t StringArena::hash(const char *s, size_t len) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+}
@@ -0,0 +1,295 @@
+#include "structural_scanner.h"
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TP_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace tp {
+
+typedef const char *(*scan_func)(const char *s);
+typedef const char *(*comma_func)(const char *s, const char **commas,
+                                  size_t max, size_t *count);
+
+static const char *scalar_field_end(const char *s) {
+    while (!(*s == '\0' || *s == '\t' || *s == '\n')) {
+        ++s;
+    }
+    return s;
+}
+
+static const char *scalar_element_end(const char *s) {
+    while (!(*s == '\0' || *s == ',' || *s == '\t' || *s == '\n')) {
+        ++s;
+    }
+    return s;
+}
+
+static const char *scalar_array_commas(const char *s, const char **commas,
+                                       size_t max, size_t *count) {
+    size_t n = 0;
+    for (; !(*s == '\0' || *s == '\t' || *s == '\n'); ++s) {
+        if (*s == ',') {
+            if (n < max) {
+                commas[n] = s;
+            }
+            ++n;
+        }
+    }
+    *count = n;
+    return s;
+}
+
+#ifdef TP_SCANNER_X86
+
+// 向量化实现均使用对齐读取: 对齐的块不会跨越页边界,
+// 因此读取'\0'之后的字节不会访问非法内存
+
+__attribute__((target("sse2"))) static inline unsigned sse2_mask(
+    __m128i v, bool with_comma) {
+    __m128i m = _mm_or_si128(
+        _mm_cmpeq_epi8(v, _mm_setzero_si128()),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    if (with_comma) {
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+    }
+    return static_cast<unsigned>(_mm_movemask_epi8(m));
+}
+
+__attribute__((target("sse2"))) static inline const char *sse2_scan(
+    const char *s, bool with_comma) {
+    uintptr_t offset = reinterpret_cast<uintptr_t>(s) & 15;
+    const char *block = s - offset;
+
+    unsigned mask = sse2_mask(
+        _mm_load_si128(reinterpret_cast<const __m128i *>(block)), with_comma);
+    mask &= ~0u << offset;
+    while (mask == 0) {
+        block += 16;
+        mask = sse2_mask(
+            _mm_load_si128(reinterpret_cast<const __m128i *>(block)),
+            with_comma);
+    }
+    return block + __builtin_ctz(mask);
+}
+
+__attribute__((target("sse2"))) static const char *sse2_field_end(
+    const char *s) {
+    return sse2_scan(s, false);
+}
+
+__attribute__((target("sse2"))) static const char *sse2_element_end(
+    const char *s) {
+    return sse2_scan(s, true);
+}
+
+// 只保留第一个结束符之前的逗号
+static inline void collect_commas(const char *block, unsigned comma,
+                                  unsigned term, const char **commas,
+                                  size_t max, size_t *n) {
+    if (term) {
+        comma &= (term & (0u - term)) - 1;
+    }
+    while (comma) {
+        if (*n < max) {
+            commas[*n] = block + __builtin_ctz(comma);
+        }
+        ++*n;
+        comma &= comma - 1;
+    }
+}
+
+__attribute__((target("sse2"))) static const char *sse2_array_commas(
+    const char *s, const char **commas, size_t max, size_t *count) {
+    uintptr_t offset = reinterpret_cast<uintptr_t>(s) & 15;
+    const char *block = s - offset;
+    unsigned valid = ~0u << offset;
+    size_t n = 0;
+    while (true) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+        unsigned term = sse2_mask(v, false) & valid;
+        unsigned comma = static_cast<unsigned>(_mm_movemask_epi8(
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8(',')))) &
+                         valid;
+        collect_commas(block, comma, term, commas, max, &n);
+        if (term) {
+            *count = n;
+            return block + __builtin_ctz(term);
+        }
+        block += 16;
+        valid = ~0u;
+    }
+}
+
+__attribute__((target("avx2"))) static inline unsigned avx2_mask(
+    __m256i v, bool with_comma) {
+    __m256i m = _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, _mm256_setzero_si256()),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    if (with_comma) {
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+    }
+    return static_cast<unsigned>(_mm256_movemask_epi8(m));
+}
+
+__attribute__((target("avx2"))) static inline const char *avx2_scan(
+    const char *s, bool with_comma) {
+    uintptr_t offset = reinterpret_cast<uintptr_t>(s) & 31;
+    const char *block = s - offset;
+
+    unsigned mask = avx2_mask(
+        _mm256_load_si256(reinterpret_cast<const __m256i *>(block)),
+        with_comma);
+    mask &= ~0u << offset;
+    while (mask == 0) {
+        block += 32;
+        mask = avx2_mask(
+            _mm256_load_si256(reinterpret_cast<const __m256i *>(block)),
+            with_comma);
+    }
+    return block + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2"))) static const char *avx2_field_end(
+    const char *s) {
+    return avx2_scan(s, false);
+}
+
+__attribute__((target("avx2"))) static const char *avx2_element_end(
+    const char *s) {
+    return avx2_scan(s, true);
+}
+
+__attribute__((target("avx2"))) static const char *avx2_array_commas(
+    const char *s, const char **commas, size_t max, size_t *count) {
+    uintptr_t offset = reinterpret_cast<uintptr_t>(s) & 31;
+    const char *block = s - offset;
+    unsigned valid = ~0u << offset;
+    size_t n = 0;
+    while (true) {
+        __m256i v =
+            _mm256_load_si256(reinterpret_cast<const __m256i *>(block));
+        unsigned term = avx2_mask(v, false) & valid;
+        unsigned comma = static_cast<unsigned>(_mm256_movemask_epi8(
+                             _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')))) &
+                         valid;
+        collect_commas(block, comma, term, commas, max, &n);
+        if (term) {
+            *count = n;
+            return block + __builtin_ctz(term);
+        }
+        block += 32;
+        valid = ~0u;
+    }
+}
+
+#endif  // TP_SCANNER_X86
+
+static bool isa_supported(ScannerIsa isa) {
+    switch (isa) {
+        case KSCALAR:
+            return true;
+#ifdef TP_SCANNER_X86
+        case KSSE2:
+            return __builtin_cpu_supports("sse2");
+        case KAVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static const char *resolve_field_end(const char *s);
+static const char *resolve_element_end(const char *s);
+static const char *resolve_array_commas(const char *s, const char **commas,
+                                        size_t max, size_t *count);
+
+static std::atomic<scan_func> g_field_end(resolve_field_end);
+static std::atomic<scan_func> g_element_end(resolve_element_end);
+static std::atomic<comma_func> g_array_commas(resolve_array_commas);
+static std::atomic<int> g_isa(-1);
+
+static void install(ScannerIsa isa) {
+    scan_func field_end = scalar_field_end;
+    scan_func element_end = scalar_element_end;
+    comma_func array_commas = scalar_array_commas;
+#ifdef TP_SCANNER_X86
+    if (isa == KSSE2) {
+        field_end = sse2_field_end;
+        element_end = sse2_element_end;
+        array_commas = sse2_array_commas;
+    } else if (isa == KAVX2) {
+        field_end = avx2_field_end;
+        element_end = avx2_element_end;
+        array_commas = avx2_array_commas;
+    }
+#endif
+    g_field_end.store(field_end, std::memory_order_relaxed);
+    g_element_end.store(element_end, std::memory_order_relaxed);
+    g_array_commas.store(array_commas, std::memory_order_relaxed);
+    g_isa.store(isa, std::memory_order_relaxed);
+}
+
+// 首次调用时选择CPU支持的最优实现, 并发调用时各线程选择结果相同
+static void select_best() {
+    if (isa_supported(KAVX2)) {
+        install(KAVX2);
+    } else if (isa_supported(KSSE2)) {
+        install(KSSE2);
+    } else {
+        install(KSCALAR);
+    }
+}
+
+static const char *resolve_field_end(const char *s) {
+    select_best();
+    return g_field_end.load(std::memory_order_relaxed)(s);
+}
+
+static const char *resolve_element_end(const char *s) {
+    select_best();
+    return g_element_end.load(std::memory_order_relaxed)(s);
+}
+
+static const char *resolve_array_commas(const char *s, const char **commas,
+                                        size_t max, size_t *count) {
+    select_best();
+    return g_array_commas.load(std::memory_order_relaxed)(s, commas, max,
+                                                          count);
+}
+
+const char *find_field_end(const char *s) {
+    return g_field_end.load(std::memory_order_relaxed)(s);
+}
+
+const char *find_element_end(const char *s) {
+    return g_element_end.load(std::memory_order_relaxed)(s);
+}
+
+const char *find_array_commas(const char *s, const char **commas,
+                              size_t max, size_t *count) {
+    return g_array_commas.load(std::memory_order_relaxed)(s, commas, max,
+                                                          count);
+}
+
+ScannerIsa scanner_isa() {
+    if (g_isa.load(std::memory_order_relaxed) < 0) {
+        select_best();
+    }
+    return static_cast<ScannerIsa>(g_isa.load(std::memory_order_relaxed));
+}
+
+bool set_scanner_isa(ScannerIsa isa) {
+    if (!isa_supported(isa)) {
+        return false;
+    }
+    install(isa);
+    return true;
+}
+}
@@ -2,16 +2,21 @@
 // Created by Liang on 2016/12/12.
 //
 #include "table_parser.h"
+#include "columnar_table.h"
+#include "field_parser.h"
+#include "structural_scanner.h"
 
-#include <cmath>
-#include <cstdlib>
 #include <cstring>
 
 #define UNUSED(p) static_cast<void>(p)
 
 namespace tp {
 
-// 支持针对10进制带符号32位整数的解析
+static_assert(KSTRING_INTERN + 1 == KDATA_TYPE_COUNT,
+              "KDATA_TYPE_COUNT out of sync with DataType");
+
+
+// 支持针对10进制带符号32位整数的解析, 溢出视为解析失败
 static bool parse_int_callback(const char *s, size_t len, void *data,
                                size_t size, void *context) {
     UNUSED(context);
@@ -20,40 +25,59 @@ static bool parse_int_callback(const char *s, size_t len, void *data,
         return false;
     }
 
-    if (len == 0) {
+    int64_t value = 0;
+    if (!parse_signed(s, len, INT32_MAX, &value)) {
         return false;
     }
 
-    // 符号位
-    bool neg = false;
-    if (s[0] == '+') {
-        ++s;
-        --len;
-    } else if (s[0] == '-') {
-        ++s;
-        --len;
-        neg = true;
+    *reinterpret_cast<int *>(data) = static_cast<int>(value);
+    return true;
+}
+
+// 支持针对10进制带符号64位整数的解析
+static bool parse_int64_callback(const char *s, size_t len, void *data,
+                                 size_t size, void *context) {
+    UNUSED(context);
+
+    if (size != sizeof(int64_t)) {
+        return false;
     }
 
-    // 数字
-    int ret = 0;
-    for (size_t i = 0; i < len; ++i) {
-        char c = s[i];
-        if (c >= '0' && c <= '9') {
-            ret = ret * 10 + (c - '0');
-        } else {
-            return false;
-        }
+    return parse_signed(s, len, INT64_MAX,
+                        reinterpret_cast<int64_t *>(data));
+}
+
+// 支持针对10进制无符号32位整数的解析
+static bool parse_uint32_callback(const char *s, size_t len, void *data,
+                                  size_t size, void *context) {
+    UNUSED(context);
+
+    if (size != sizeof(uint32_t)) {
+        return false;
     }
 
-    if (neg) {
-        ret = -ret;
+    uint64_t value = 0;
+    if (!parse_unsigned(s, len, UINT32_MAX, &value)) {
+        return false;
     }
 
-    *reinterpret_cast<int *>(data) = ret;
+    *reinterpret_cast<uint32_t *>(data) = static_cast<uint32_t>(value);
     return true;
 }
 
+// 支持针对10进制无符号64位整数的解析
+static bool parse_uint64_callback(const char *s, size_t len, void *data,
+                                  size_t size, void *context) {
+    UNUSED(context);
+
+    if (size != sizeof(uint64_t)) {
+        return false;
+    }
+
+    return parse_unsigned(s, len, UINT64_MAX,
+                          reinterpret_cast<uint64_t *>(data));
+}
+
 // 支持符合浮点数表达的解析
 // 参见json.org的语法描述
 static bool parse_float_callback(const char *s, size_t len, void *data,
@@ -64,108 +88,42 @@ static bool parse_float_callback(const char *s, size_t len, void *data,
         return false;
     }
 
-    if (len == 0) {
+    return parse_float(s, len, reinterpret_cast<float *>(data));
+}
+
+// 支持双精度浮点数, 语法与float相同
+static bool parse_double_callback(const char *s, size_t len, void *data,
+                                  size_t size, void *context) {
+    UNUSED(context);
+
+    if (size != sizeof(double)) {
         return false;
     }
 
-    // 符号位
-    bool neg = false;
-    if (s[0] == '+') {
-        ++s;
-        --len;
-    } else if (s[0] == '-') {
-        ++s;
-        --len;
-        neg = true;
-    }
-
-    double int_part = 0;
-    double frac_part = 0;
-    double frac_pos = 0.1;
-    bool neg_power = false;
-    double power = 0;
-
-    int state = 0;
-    for (size_t i = 0; i < len; ++i) {
-        char c = s[i];
-        switch (state) {
-            case 0:
-                if (c == '0') {
-                    state = 2;
-                } else {
-                    state = 1;
-                    if (c >= '1' && c <= '9') {
-                        int_part = c - '1' + 1;
-                    } else {
-                        return false;
-                    }
-                }
-                break;
-            case 1:  // 终止态
-                if (c >= '0' && c <= '9') {
-                    int_part = int_part * 10 + c - '0';
-                } else if (c == '.') {
-                    state = 3;
-                } else if (c == 'e' || c == 'E') {
-                    state = 4;
-                } else {
-                    return false;
-                }
-                break;
-            case 2:  // 终止态
-                if (c == '.') {
-                    state = 3;
-                } else if (c == 'e' || c == 'E') {
-                    state = 4;
-                } else {
-                    return false;
-                }
-                break;
-            case 3:  // 终止态，允许0.或1.这样的小数出现
-                if (c >= '0' && c <= '9') {
-                    frac_part = frac_part + (c - '0') * frac_pos;
-                    frac_pos *= 0.1;
-                } else if (c == 'e' || c == 'E') {
-                    state = 4;
-                }
-                break;
-            case 4:
-                if (c == '+') {
-                    state = 6;
-                } else if (c == '-') {
-                    neg_power = true;
-                    state = 6;
-                } else {
-                    --i;
-                    state = 6;
-                }
-                break;
-            case 6:  // 终止态
-                if (c >= '0' && c <= '9') {
-                    power = power * 10 + c - '0';
-                } else {
-                    return false;
-                }
-                break;
-            case 7:  // 无效状态
-                return false;
-            default:
-                assert(false);
-        }
-    }
+    return parse_double(s, len, reinterpret_cast<double *>(data));
+}
+
+// 支持布尔值: true/false/1/0
+static bool parse_bool_callback(const char *s, size_t len, void *data,
+                                size_t size, void *context) {
+    UNUSED(context);
 
-    if (!(state == 1 || state == 2 || state == 3 || state == 6)) {
+    if (size != sizeof(bool)) {
         return false;
     }
 
-    double ret = (int_part + frac_part) *
-                std::pow(10., static_cast<float>(neg_power ? -power : power));
-    if (neg) {
-        ret = -ret;
+    return parse_bool(s, len, reinterpret_cast<bool *>(data));
+}
+
+// 支持枚举, context为EnumTable
+static bool parse_enum_callback(const char *s, size_t len, void *data,
+                                size_t size, void *context) {
+    if (size != sizeof(int) || !context) {
+        return false;
     }
 
-    *reinterpret_cast<float *>(data) = static_cast<float>(ret);;
-    return true;
+    const EnumTable *table = reinterpret_cast<const EnumTable *>(context);
+    return table->find(s, len, reinterpret_cast<int *>(data));
 }
 
 // 支持字符串格式
@@ -173,35 +131,447 @@ static bool parse_string_callback(const char *s, size_t len, void *data,
                                   size_t size, void *context) {
     UNUSED(context);
 
-    if (size < len + 1) {
+    return parse_string(s, len, reinterpret_cast<char *>(data), size);
+}
+
+// 支持字符串引用, 直接指向输入数据
+static bool parse_string_view_callback(const char *s, size_t len, void *data,
+                                       size_t size, void *context) {
+    UNUSED(context);
+
+    if (size != sizeof(StringRef)) {
         return false;
     }
 
-    memcpy(data, s, len);
-    reinterpret_cast<char *>(data)[len] = '\0';
+    StringRef ref = {s, len};
+    *reinterpret_cast<StringRef *>(data) = ref;
     return true;
 }
 
-TableParser::TableParser(const char *src, const ColumnDescriptor desc[])
-    : _src(src), _desc(desc), _line(1) {
-    std::snprintf(_err, sizeof(_err), "%s", "ok");
+// 支持去重字符串, context为StringArena
+static bool parse_string_intern_callback(const char *s, size_t len,
+                                         void *data, size_t size,
+                                         void *context) {
+    if (size != sizeof(StringRef) || !context) {
+        return false;
+    }
+
+    StringArena *arena = reinterpret_cast<StringArena *>(context);
+    *reinterpret_cast<StringRef *>(data) = arena->intern(s, len);
+    return true;
+}
+
+// 根据列类型选择内置回调, KCLASS使用用户回调
+static parser_callback builtin_callback(const ColumnDescriptor &desc) {
+    switch (desc.type) {
+        case KINT:
+            return parse_int_callback;
+        case KFLOAT:
+            return parse_float_callback;
+        case KSTRING:
+            return parse_string_callback;
+        case KINT64:
+            return parse_int64_callback;
+        case KUINT32:
+            return parse_uint32_callback;
+        case KUINT64:
+            return parse_uint64_callback;
+        case KDOUBLE:
+            return parse_double_callback;
+        case KBOOL:
+            return parse_bool_callback;
+        case KENUM:
+            return parse_enum_callback;
+        case KSTRING_VIEW:
+            return parse_string_view_callback;
+        case KSTRING_INTERN:
+            return parse_string_intern_callback;
+        case KCLASS:
+            return desc.callback;
+        default:
+            return nullptr;
+    }
+}
+
+// 数值数组元素的直接转换, 与对应的内置回调结果一致
+// padded表示元素之后至少还有8个字节可读, 可以整块读取数字
+typedef bool (*number_converter)(const char *s, size_t len, bool padded,
+                                 void *data);
+
+static inline bool convert_int(const char *s, size_t len, bool padded,
+                               void *data) {
+    int64_t value = 0;
+    if (!(padded ? parse_signed_padded(s, len, INT32_MAX, &value)
+                 : parse_signed(s, len, INT32_MAX, &value))) {
+        return false;
+    }
+    *reinterpret_cast<int *>(data) = static_cast<int>(value);
+    return true;
+}
+
+static inline bool convert_int64(const char *s, size_t len, bool padded,
+                                 void *data) {
+    int64_t *out = reinterpret_cast<int64_t *>(data);
+    return padded ? parse_signed_padded(s, len, INT64_MAX, out)
+                  : parse_signed(s, len, INT64_MAX, out);
+}
+
+static inline bool convert_uint32(const char *s, size_t len, bool padded,
+                                  void *data) {
+    uint64_t value = 0;
+    if (!(padded ? parse_unsigned_padded(s, len, UINT32_MAX, &value)
+                 : parse_unsigned(s, len, UINT32_MAX, &value))) {
+        return false;
+    }
+    *reinterpret_cast<uint32_t *>(data) = static_cast<uint32_t>(value);
+    return true;
+}
+
+static inline bool convert_uint64(const char *s, size_t len, bool padded,
+                                  void *data) {
+    uint64_t *out = reinterpret_cast<uint64_t *>(data);
+    return padded ? parse_unsigned_padded(s, len, UINT64_MAX, out)
+                  : parse_unsigned(s, len, UINT64_MAX, out);
+}
+
+static inline bool convert_float(const char *s, size_t len, bool padded,
+                                 void *data) {
+    float *out = reinterpret_cast<float *>(data);
+    return padded ? parse_float_padded(s, len, out) : parse_float(s, len, out);
+}
+
+static inline bool convert_double(const char *s, size_t len, bool padded,
+                                  void *data) {
+    double *out = reinterpret_cast<double *>(data);
+    return padded ? parse_double_padded(s, len, out)
+                  : parse_double(s, len, out);
 }
 
-TableParser::TableParser(const TableParser &org) {
-    _src = org._src;
-    _desc = org._desc;
-    _line = org._line;
-    std::snprintf(_err, sizeof(_err), "%s", org._err);
+// 按逗号位置依次转换count个元素, end为数组列的结束位置
+// convert是模板参数, 编译期确定, 不产生间接调用
+template <number_converter convert, typename Sink>
+static bool convert_numbers(const char *s, const char *const *commas,
+                            size_t count, const char *end, unsigned idx,
+                            const ColumnDescriptor &col, Sink &sink) {
+    for (size_t i = 0; i < count; ++i) {
+        const char *e = i + 1 < count ? commas[i] : end;
+        if (!convert(s, static_cast<size_t>(e - s), e + 8 <= end,
+                     sink.element(idx, col, i))) {
+            return false;
+        }
+        s = e + 1;
+    }
+    return true;
+}
+
+// 计算[offset, offset + count * element_size)是否在size范围内
+static bool memory_in_boundary(ptrdiff_t offset, size_t count,
+                               size_t element_size, size_t size) {
+    if (offset < 0 || static_cast<size_t>(offset) > size) {
+        return false;
+    }
+    size_t remain = size - static_cast<size_t>(offset);
+    if (element_size > 0 && count > remain / element_size) {
+        return false;
+    }
+    return count * element_size <= remain;
 }
 
+// 数组列的结尾, 与parse_array的边界一致: 大小为0的数组只占"N:"部分,
+// 其后没有列分隔符时紧接着就是下一列
+static const char *find_array_end(const char *s) {
+    const char *p = s;
+    bool empty = true;
+    for (; *p >= '0' && *p <= '9'; ++p) {
+        empty = empty && *p == '0';
+    }
+    if (p != s && *p == ':' && empty) {
+        return p + 1;
+    }
+    return find_field_end(s);
+}
+
+ParsePlan::ParsePlan(const ColumnDescriptor desc[], size_t row_size)
+    : _has_layout(true),
+      _has_string_view(false),
+      _row_size(row_size),
+      _error(KPLAN_OK),
+      _error_column(0) {
+    init(desc);
+}
+
+ParsePlan::ParsePlan(const ColumnDescriptor desc[])
+    : _has_layout(false),
+      _has_string_view(false),
+      _row_size(0),
+      _error(KPLAN_OK),
+      _error_column(0) {
+    init(desc);
+}
+
+void ParsePlan::init(const ColumnDescriptor desc[]) {
+    for (unsigned idx = 0; desc[idx].type != KNONE; ++idx) {
+        ColumnDescriptor col = desc[idx];
+        _columns.push_back(col);
+        if (col.type == KSTRING_VIEW) {
+            _has_string_view = true;
+        }
+        if (_error != KPLAN_OK) {
+            continue;
+        }
+
+        // 计算空间占用是否越界
+        bool in_boundary = true;
+        if (_has_layout && col.is_array) {
+            in_boundary = memory_in_boundary(col.offset, col.array_max,
+                                             col.element_size, _row_size) &&
+                          memory_in_boundary(col.array_counter_offset, 1,
+                                             sizeof(unsigned), _row_size);
+        } else if (_has_layout) {
+            in_boundary =
+                memory_in_boundary(col.offset, 1, col.element_size, _row_size);
+        }
+
+        if (!in_boundary) {
+            _error = KPLAN_OUT_OF_BOUNDARY;
+        } else if ((col.type == KENUM || col.type == KSTRING_INTERN) &&
+                   !col.context) {
+            _error = KPLAN_CONTEXT_REQUIRED;
+        } else if (!builtin_callback(col)) {
+            _error =
+                col.type == KCLASS ? KPLAN_CALLBACK_REQUIRED : KPLAN_UNKNOWN_TYPE;
+        } else {
+            _columns.back().callback = builtin_callback(col);
+        }
+
+        if (_error != KPLAN_OK) {
+            _error_column = idx;
+        }
+    }
+}
+
+bool ParsePlan::ok() const { return _error == KPLAN_OK; }
+
+PlanError ParsePlan::error() const { return _error; }
+
+unsigned ParsePlan::error_column() const { return _error_column; }
+
+size_t ParsePlan::row_size() const { return _row_size; }
+
+bool ParsePlan::has_layout() const { return _has_layout; }
+
+size_t ParsePlan::column_count() const { return _columns.size(); }
+
+bool ParsePlan::has_string_view() const { return _has_string_view; }
+
+const ColumnDescriptor &ParsePlan::column(size_t idx) const {
+    return _columns[idx];
+}
+
+TableParser::TableParser(const char *begin, const char *end,
+                         unsigned first_line, InputStream *in,
+                         size_t buffer_size, const ColumnDescriptor *desc,
+                         const ParsePlan *plan)
+    : _src(begin),
+      _end(end),
+      _desc(desc),
+      _plan(plan),
+      _filter(nullptr),
+      _line(first_line),
+      _origin(begin),
+      _field_start(begin),
+      _stats(nullptr),
+      _row_start(nullptr),
+      _row_begin_ns(0),
+      _in(in),
+      _buf_size(0),
+      _consumed(0),
+      _data_end(0),
+      _in_eof(true),
+      _in_failed(false) {
+    if (_in) {
+        _buf_size = buffer_size > 0 ? buffer_size : 1;
+        _buf.assign(_buf_size + 1, '\0');
+        _src = &_buf[0];
+        _in_eof = false;
+    }
+    _error.code = KERR_OK;
+    _error.line = 0;
+    _error.column = 0;
+    _error.offset = 0;
+}
+
+TableParser::TableParser(const char *src, const ColumnDescriptor desc[])
+    : TableParser(src, nullptr, 1, nullptr, 0, desc, nullptr) {}
+
+TableParser::TableParser(const char *src, const ParsePlan &plan)
+    : TableParser(src, nullptr, 1, nullptr, 0, nullptr, &plan) {}
+
+TableParser::TableParser(InputStream *in, const ColumnDescriptor desc[],
+                         size_t buffer_size)
+    : TableParser(nullptr, nullptr, 1, in, buffer_size, desc, nullptr) {}
+
+TableParser::TableParser(InputStream *in, const ParsePlan &plan,
+                         size_t buffer_size)
+    : TableParser(nullptr, nullptr, 1, in, buffer_size, nullptr, &plan) {}
+
+TableParser::TableParser(const char *begin, const char *end,
+                         const ColumnDescriptor desc[], unsigned first_line)
+    : TableParser(begin, end, first_line, nullptr, 0, desc, nullptr) {}
+
+TableParser::TableParser(const char *begin, const char *end,
+                         const ParsePlan &plan, unsigned first_line)
+    : TableParser(begin, end, first_line, nullptr, 0, nullptr, &plan) {}
+
+TableParser::TableParser(const TableParser &org) { *this = org; }
+
 TableParser &TableParser::operator=(const TableParser &rhs) {
-    _src = rhs._src;
+    if (this == &rhs) {
+        return *this;
+    }
+
+    _end = rhs._end;
     _desc = rhs._desc;
+    _plan = rhs._plan;
+    _own_plan = rhs._own_plan;
+    _filter = rhs._filter;
+    _stats = rhs._stats;
+    _row_start = nullptr;
+    _row_begin_ns = 0;
     _line = rhs._line;
-    std::snprintf(_err, sizeof(_err), "%s", rhs._err);
+    _error = rhs._error;
+
+    // 流式解析时_src指向内部缓冲区, 需要重定位到本对象的缓冲区
+    _in = rhs._in;
+    _buf = rhs._buf;
+    _buf_size = rhs._buf_size;
+    _data_end = rhs._data_end;
+    _in_eof = rhs._in_eof;
+    _in_failed = rhs._in_failed;
+    _consumed = rhs._consumed;
+    _origin = rhs._origin;
+    if (_in) {
+        _src = &_buf[0] + (rhs._src - &rhs._buf[0]);
+    } else {
+        _src = rhs._src;
+    }
+    _field_start = _src;
     return *this;
 }
 
+void TableParser::fill_line() {
+    size_t pos = static_cast<size_t>(_src - &_buf[0]);
+    size_t scanned = pos;
+
+    while (!_in_eof &&
+           !std::memchr(&_buf[scanned], '\n', _data_end - scanned)) {
+        scanned = _data_end;
+
+        // 丢弃已解析的数据, 只保留未完成的行
+        if (pos > 0) {
+            std::memmove(&_buf[0], &_buf[pos], _data_end - pos);
+            _consumed += pos;
+            _data_end -= pos;
+            scanned -= pos;
+            pos = 0;
+        }
+
+        // 行长度超过缓冲区时扩容
+        if (_buf.size() < _data_end + _buf_size + 1) {
+            _buf.resize(_data_end + _buf_size + 1);
+        }
+
+        long n = _in->read(&_buf[_data_end], _buf_size);
+        if (n <= 0) {
+            _in_eof = true;
+            _in_failed = n < 0;
+            // 出错时未读完的行可能被截断, 丢弃而不作为正常行返回,
+            // 错误位置指向该行开头
+            if (_in_failed) {
+                _data_end = pos;
+            }
+        } else {
+            _data_end += static_cast<size_t>(n);
+        }
+        _buf[_data_end] = '\0';
+    }
+
+    _src = &_buf[pos];
+}
+
+// 行式输出: 按列描述中的偏移写入结构体
+class RowSink {
+   public:
+    explicit RowSink(void *p) : _base(static_cast<char *>(p)) {}
+
+    size_t value_size(const ColumnDescriptor &col, size_t len) const {
+        UNUSED(len);
+        return col.element_size;
+    }
+
+    void *value(unsigned idx, const ColumnDescriptor &col, size_t size) {
+        UNUSED(idx);
+        UNUSED(size);
+        return _base + col.offset;
+    }
+
+    void *element(unsigned idx, const ColumnDescriptor &col, size_t i) {
+        UNUSED(idx);
+        return _base + col.offset + col.element_size * i;
+    }
+
+    void set_count(const ColumnDescriptor &col, size_t count) {
+        *reinterpret_cast<unsigned *>(_base + col.array_counter_offset) =
+            static_cast<unsigned>(count);
+    }
+
+    // 未投影的列保持原值
+    void skip(unsigned idx, const ColumnDescriptor &col) {
+        UNUSED(idx);
+        UNUSED(col);
+    }
+
+   private:
+    char *_base;
+};
+
+// 列式输出: 追加到每列的连续存储中
+class ColumnarSink {
+   public:
+    explicit ColumnarSink(ColumnarTable &table) : _table(table) {}
+
+    // 非数组字符串列按实际长度存入字节区
+    size_t value_size(const ColumnDescriptor &col, size_t len) const {
+        return col.type == KSTRING ? len + 1 : col.element_size;
+    }
+
+    void *value(unsigned idx, const ColumnDescriptor &col, size_t size) {
+        UNUSED(col);
+        return _table.append_value(idx, size);
+    }
+
+    void *element(unsigned idx, const ColumnDescriptor &col, size_t i) {
+        UNUSED(i);
+        return _table.append_value(idx, col.element_size);
+    }
+
+    void set_count(const ColumnDescriptor &col, size_t count) {
+        UNUSED(col);
+        UNUSED(count);
+    }
+
+    // 未投影的列填充零值, 保持各列行数一致; 数组列为空数组
+    void skip(unsigned idx, const ColumnDescriptor &col) {
+        if (!col.is_array) {
+            size_t size = value_size(col, 0);
+            memset(_table.append_value(idx, size), 0, size);
+        }
+    }
+
+   private:
+    ColumnarTable &_table;
+};
+
 /**
  * 输入数据每行均满足
  *   line := element elements '\n' | '\n'
@@ -214,251 +584,583 @@ TableParser &TableParser::operator=(const TableParser &rhs) {
  *   针对array字段，element构成元素中不得出现','和'\t'
  */
 ParseResult TableParser::parse(void *p, size_t size) {
-    char c = *_src;
-    if (c == '\0') {
-        return KEOF;
+    ParseResult ret = begin_row();
+    if (ret != KOK) {
+        return ret;
+    }
+
+    if (check_plan(size)) {
+        RowSink sink(p);
+        ret = parse_row(*_plan, sink);
+    } else {
+        ret = KERROR;
     }
 
-    unsigned idx = 0;
-    ColumnDescriptor desc = _desc[idx];
-    ParseResult ret = KOK;
-    bool parse_end = false;
-    while (!(c == '\n' || c == '\0') && !parse_end) {
-        if (desc.type == KNONE) {
+    end_row(ret);
+    return ret;
+}
+
+BatchResult TableParser::parse_batch(void *out, size_t row_size,
+                                     size_t capacity,
+                                     std::vector<ParseError> *errors) {
+    BatchResult result = {0, 0, 0, false};
+    char *dst = static_cast<char *>(out);
+    bool plan_ok = check_plan(row_size);
+
+    while (result.rows < capacity) {
+        ParseResult ret = begin_row();
+        if (ret == KEOF) {
+            result.eof = true;
             break;
         }
 
-        // 计算空间占用是否越界
-        bool memory_out_boundary = false;
-        if (desc.is_array) {
-            if (desc.offset + desc.array_max * desc.element_size > size) {
-                memory_out_boundary = true;
-            } else if (desc.array_counter_offset + sizeof(unsigned) > size) {
-                memory_out_boundary = true;
+        if (ret == KOK) {
+            if (plan_ok) {
+                RowSink sink(dst + result.rows * row_size);
+                ret = parse_row(*_plan, sink);
+            } else {
+                // 按当前行号重新记录计划错误
+                check_plan(row_size);
+                ret = KERROR;
             }
+        }
+        end_row(ret);
+
+        if (ret == KOK) {
+            ++result.rows;
+        } else if (ret == KFILTERED) {
+            ++result.filtered;
         } else {
-            if (desc.offset + desc.element_size > size) {
-                memory_out_boundary = true;
+            ++result.failed;
+            if (errors) {
+                errors->push_back(_error);
             }
         }
+    }
 
-        if (memory_out_boundary) {
-            ret = KERROR;
-            std::snprintf(_err, sizeof(_err),
-                          "line %u: element %u memory out of boundary.", _line,
-                          idx);
-            parse_end = true;
+    return result;
+}
+
+ParseResult TableParser::parse_columns(ColumnarTable &table) {
+    ParseResult ret = begin_row();
+    if (ret != KOK) {
+        return ret;
+    }
+
+    if (check_plan_error(table.plan())) {
+        ColumnarSink sink(table);
+        table.begin_row();
+        ret = parse_row(table.plan(), sink);
+        if (ret == KOK) {
+            table.commit_row();
+        } else {
+            table.rollback_row();
         }
+    } else {
+        ret = KERROR;
+    }
 
-        // 解析一个元素
-        if (!parse_end && desc.is_array) {
-            char *end_of_count = nullptr;
-            size_t count = std::strtoul(_src, &end_of_count, 10);
+    end_row(ret);
+    return ret;
+}
 
-            if (end_of_count == _src) {
-                ret = KERROR;
-                std::snprintf(
-                    _err, sizeof(_err),
-                    "[ERROR] line %u: array size required near element %u.",
-                    _line, idx);
-                parse_end = true;
-            } else if (*end_of_count != ':') {
-                ret = KERROR;
-                std::snprintf(
-                    _err, sizeof(_err),
-                    "[ERROR] line %u: unexpected character near element %u.",
-                    _line, idx);
-                parse_end = true;
+ParseResult TableParser::begin_row() {
+#ifdef TP_ENABLE_STATS
+    if (_stats) {
+        _row_begin_ns = stats_clock_ns();
+    }
+#endif
+    if (_in) {
+        fill_line();
+    } else if (_end && _src >= _end) {
+        return KEOF;
+    }
+
+    if (*_src == '\0') {
+        if (_in_failed) {
+            // 读取错误只报告一次
+            _in_failed = false;
+#ifdef TP_ENABLE_STATS
+            if (_stats) {
+                ++_stats->errors[KERR_READ_FAILED];
             }
+#endif
+            return fail(KERR_READ_FAILED, 0, _src);
+        }
+        return KEOF;
+    }
+#ifdef TP_ENABLE_STATS
+    _row_start = _src;
+#endif
+    return KOK;
+}
 
-            if (count > desc.array_max) {
-                ret = KERROR;
-                std::snprintf(
-                    _err, sizeof(_err),
-                    "[ERROR] line %u: array size out of range near element %u.",
-                    _line, idx);
-                parse_end = true;
+void TableParser::end_row(ParseResult ret) {
+    // 成功时只记录行号, 不做格式化
+    if (ret != KERROR) {
+        _error.code = KERR_OK;
+        _error.line = _line;
+        _error.column = 0;
+        _error.offset = 0;
+    }
+
+    // 跳过本行剩余内容
+    char c = *_src;
+    while (!(c == '\n' || c == '\0')) {
+        _src = find_field_end(_src);
+        c = *_src;
+        if (c == '\t') {
+            c = *(++_src);
+        }
+    }
+#ifdef TP_ENABLE_STATS
+    const char *line_end = _src;
+    unsigned line = _line;
+#endif
+    if (c == '\n') {
+        ++_line;
+        ++_src;
+    }
+#ifdef TP_ENABLE_STATS
+    if (_stats && _row_start) {
+        record_row(ret, line_end, line);
+    }
+#endif
+}
+
+bool TableParser::check_plan(size_t size) {
+    // 按列描述构造的解析器在输出大小变化时重新构造计划
+    if (_desc && (!_plan || _plan->row_size() != size)) {
+        _own_plan = std::make_shared<ParsePlan>(_desc, size);
+        _plan = _own_plan.get();
+    }
+
+    if (!check_plan_error(*_plan)) {
+        return false;
+    }
+
+    if (!_plan->has_layout()) {
+        fail(KERR_NO_ROW_LAYOUT, 0, _src);
+        return false;
+    }
+
+    if (size < _plan->row_size()) {
+        fail(KERR_ROW_TOO_SMALL, 0, _src);
+        return false;
+    }
+    return true;
+}
+
+bool TableParser::check_plan_error(const ParsePlan &plan) {
+    ErrorCode code = KERR_OK;
+    switch (plan.error()) {
+        case KPLAN_OK:
+            // 流式解析的缓冲区会被复用, 字符串引用会失效
+            if (_in && plan.has_string_view()) {
+                fail(KERR_STRING_VIEW_IN_STREAM, 0, _src);
+                return false;
             }
+            return true;
+        case KPLAN_OUT_OF_BOUNDARY:
+            code = KERR_OUT_OF_BOUNDARY;
+            break;
+        case KPLAN_CALLBACK_REQUIRED:
+            code = KERR_CALLBACK_REQUIRED;
+            break;
+        case KPLAN_CONTEXT_REQUIRED:
+            code = plan.column(plan.error_column()).type == KSTRING_INTERN
+                       ? KERR_STRING_ARENA_REQUIRED
+                       : KERR_ENUM_TABLE_REQUIRED;
+            break;
+        default:
+            code = KERR_UNKNOWN_TYPE;
+            break;
+    }
+    fail(code, plan.error_column(), _src);
+    return false;
+}
+
+ParseResult TableParser::fail(ErrorCode code, unsigned column,
+                              const char *pos) {
+    _error.code = code;
+    _error.line = _line;
+    _error.column = column;
+    _error.offset = offset_of(pos);
+    return KERROR;
+}
+
+size_t TableParser::offset_of(const char *pos) const {
+    if (_in) {
+        return _consumed + static_cast<size_t>(pos - &_buf[0]);
+    }
+    return static_cast<size_t>(pos - _origin);
+}
 
-            if (!parse_end) {
-                // 设置数组大小描述内存
-                *reinterpret_cast<size_t *>(
-                    (void *)((char *)p + desc.array_counter_offset)) = count;
-
-                // 依次解析数组元素
-                _src = end_of_count + 1;
-                for (unsigned i = 0; !parse_end && i < count; ++i) {
-                    const char *start = _src;
-                    const char *end = start;
-
-                    while (!(*end == '\0' || *end == ',' || *end == '\t' ||
-                             *end == '\n')) {
-                        ++end;
-                    }
-
-                    if (i != count - 1) {
-                        switch (*end) {
-                            case '\t':
-                                ret = KERROR;
-                                std::snprintf(
-                                    _err, sizeof(_err),
-                                    "[ERROR] line %u: unexpected column "
-                                    "splitter near element %u.",
-                                    _line, idx);
-                                parse_end = true;
-                                break;
-                            case '\0':
-                                ret = KERROR;
-                                std::snprintf(_err, sizeof(_err),
-                                              "[ERROR] line %u: unexpected eof "
-                                              "near element %u.",
-                                              _line, idx);
-                                parse_end = true;
-                                break;
-                            case '\n':
-                                ret = KERROR;
-                                std::snprintf(_err, sizeof(_err),
-                                              "[ERROR] line %u: unexpected new "
-                                              "line near element %u.",
-                                              _line, idx);
-                                parse_end = true;
-                                break;
-                            default:
-                                assert(*end == ',');
-                                break;
-                        }
-                    }
-
-                    if (*end == ',') {
-                        _src = end + 1;
-
-                        if (i == count - 1) {
-                            ret = KERROR;
-                            std::snprintf(_err, sizeof(_err),
-                                          "[ERROR] line %u: more array element "
-                                          "found near element %u.",
-                                          _line, idx);
-                            parse_end = true;
-                        }
-                    } else if (*end == '\t') {
-                        _src = end + 1;
-                    } else {
-                        _src = end;
-                    }
-
-                    ret = parse_element(idx, start, end - start,
-                                        (void *)((char *)p + desc.offset +
-                                                 desc.element_size * i));
-                    if (ret != KOK) {
-                        parse_end = true;
-                    }
-                }
+template <typename Sink>
+ParseResult TableParser::parse_row(const ParsePlan &plan, Sink &sink) {
+    if (_filter) {
+        return parse_filtered_row(plan, sink);
+    }
+    return parse_columns(plan, sink);
+}
+
+template <typename Sink>
+ParseResult TableParser::parse_columns(const ParsePlan &plan, Sink &sink) {
+    unsigned count = static_cast<unsigned>(plan.column_count());
+    for (unsigned idx = 0; idx < count; ++idx) {
+        char c = *_src;
+        if (c == '\n' || c == '\0') {
+            // 输入行已读完，但是元素没有全部被解析
+            return fail(KERR_ELEMENT_REQUIRED, idx, _src);
+        }
+
+#ifdef TP_ENABLE_STATS
+        uint64_t begin_ns = _stats ? stats_clock_ns() : 0;
+#endif
+        _field_start = _src;
+        const ColumnDescriptor &col = plan.column(idx);
+        ParseResult ret;
+        size_t len = 0;
+        if (col.is_array) {
+            ret = parse_array(idx, col, sink);
+            len = static_cast<size_t>(_src - _field_start);
+            if (len > 0 && _src[-1] == '\t') {
+                --len;
             }
-        } else if (!parse_end) {
+        } else {
             const char *start = _src;
-            const char *end = start;
+            const char *end = find_field_end(start);
+            len = static_cast<size_t>(end - start);
+            _src = *end == '\t' ? end + 1 : end;
 
-            while (!(*end == '\0' || *end == '\t' || *end == '\n')) {
-                ++end;
-            }
+            size_t size = sink.value_size(col, len);
+            ret = parse_element(idx, col, start, len,
+                                sink.value(idx, col, size), size);
+        }
+#ifdef TP_ENABLE_STATS
+        if (_stats) {
+            record_field(idx, col, len, begin_ns);
+        }
+#endif
+        if (ret != KOK) {
+            return ret;
+        }
+    }
 
-            if (*end == '\t') {
-                _src = end + 1;
-            } else {
-                _src = end;
-            }
+    char c = *_src;
+    if (!(c == '\n' || c == '\0')) {
+        // 输入行未读完，但是元素全部被解析
+        return fail(KERR_MORE_ELEMENT, count, _src);
+    }
+    return KOK;
+}
 
-            ret = parse_element(idx, start, end - start,
-                                (void *)((char *)p + desc.offset));
-            if (ret != KOK) {
-                parse_end = true;
+template <typename Sink>
+ParseResult TableParser::parse_filtered_row(const ParsePlan &plan,
+                                            Sink &sink) {
+    unsigned count = static_cast<unsigned>(plan.column_count());
+    if (_filter->column_bound() > count) {
+        return fail(KERR_FILTER_COLUMN, _filter->column_bound() - 1, _src);
+    }
+
+    // 只扫描分隔符, 记录每列的原始文本. 列的边界必须与parse_columns一致,
+    // 否则同一行在有无过滤条件时的结果会不同
+    const char *row_start = _src;
+    bool complete = true;
+    _fields.resize(count);
+    for (unsigned idx = 0; idx < count; ++idx) {
+        char c = *_src;
+        if (c == '\n' || c == '\0') {
+            complete = false;
+            break;
+        }
+        const char *end = plan.column(idx).is_array ? find_array_end(_src)
+                                                    : find_field_end(_src);
+        _fields[idx].data = _src;
+        _fields[idx].size = static_cast<size_t>(end - _src);
+        _src = *end == '\t' ? end + 1 : end;
+    }
+
+    char c = *_src;
+    if (!complete || !(c == '\n' || c == '\0')) {
+        // 列数不符的行总是失败, 按无过滤条件时的顺序转换以报告相同的错误
+        _src = row_start;
+        return parse_columns(plan, sink);
+    }
+    if (!_filter->match(&_fields[0])) {
+        return KFILTERED;
+    }
+
+    const char *line_end = _src;
+    for (unsigned idx = 0; idx < count; ++idx) {
+        const ColumnDescriptor &col = plan.column(idx);
+        if (!_filter->projected(idx)) {
+            sink.skip(idx, col);
+            continue;
+        }
+
+#ifdef TP_ENABLE_STATS
+        uint64_t begin_ns = _stats ? stats_clock_ns() : 0;
+#endif
+        const char *start = _fields[idx].data;
+        size_t len = _fields[idx].size;
+        _field_start = start;
+        ParseResult ret;
+        if (col.is_array) {
+            _src = start;
+            ret = parse_array(idx, col, sink);
+            // 数组必须恰好占满扫描得到的列
+            const char *end = start + len;
+            if (ret == KOK && _src != end &&
+                !(*end == '\t' && _src == end + 1)) {
+                ret = fail(KERR_PARSE_FAILED, idx, start);
             }
+        } else {
+            size_t size = sink.value_size(col, len);
+            ret = parse_element(idx, col, start, len,
+                                sink.value(idx, col, size), size);
+        }
+#ifdef TP_ENABLE_STATS
+        if (_stats) {
+            record_field(idx, col, len, begin_ns);
         }
-        if (!parse_end) {
-            desc = _desc[++idx];
-            c = *_src;
+#endif
+        if (ret != KOK) {
+            return ret;
         }
     }
 
-    // PARSE_END:
-    c = *_src;
-    if (ret == KOK) {
-        if ((c == '\n' || c == '\0') && desc.type != KNONE) {
-            // 输入行已读完，但是元素没有全部被解析
-            std::snprintf(_err, sizeof(_err),
-                          "[ERROR] line %u: element %u required in input.",
-                          _line, idx);
-            ret = KERROR;
-        } else if (!(c == '\n' || c == '\0') && desc.type == KNONE) {
-            // 输入行未读完，但是元素全部被解析
-            std::snprintf(_err, sizeof(_err),
-                          "[ERROR] line %u: more element found in input after "
-                          "element %u.",
-                          _line, idx);
-            ret = KERROR;
-        } else {
-            assert((c == '\n' || c == '\0') && desc.type == KNONE);
+    _src = line_end;
+    return KOK;
+}
+
+template <typename Sink>
+ParseResult TableParser::parse_array(unsigned idx, const ColumnDescriptor &col,
+                                     Sink &sink) {
+    // 数组大小, 超过上限后不再累加以免溢出
+    const char *s = _src;
+    if (*s < '0' || *s > '9') {
+        return fail(KERR_SIZE_REQUIRED, idx, _field_start);
+    }
+    size_t count = 0;
+    for (; *s >= '0' && *s <= '9'; ++s) {
+        if (count <= col.array_max) {
+            count = count * 10 + static_cast<size_t>(*s - '0');
         }
-    } else {
-        assert(ret == KERROR);
+    }
+    if (*s != ':') {
+        return fail(KERR_UNEXPECTED_CHAR, idx, _field_start);
+    }
+    if (count > col.array_max) {
+        return fail(KERR_SIZE_OUT_OF_RANGE, idx, _field_start);
     }
 
-    if (ret == KOK) {
-        std::snprintf(_err, sizeof(_err), "[OK] line %u: parse success", _line);
+    // 设置数组大小描述内存
+    sink.set_count(col, count);
+
+    _src = s + 1;
+    if (count == 0 && *_src == '\t') {
+        ++_src;
     }
 
-    while (!(c == '\n' || c == '\0')) {
-        c = *(++_src);
+    ParseResult bulk = KOK;
+    if (count > 0 && parse_number_array(idx, col, count, sink, &bulk)) {
+        return bulk;
     }
-    if (c == '\n') {
-        ++_line;
-        ++_src;
+
+    // 依次解析数组元素
+    for (size_t i = 0; i < count; ++i) {
+        const char *start = _src;
+        const char *end = find_element_end(start);
+
+        if (i != count - 1) {
+            switch (*end) {
+                case '\t':
+                    return fail(KERR_UNEXPECTED_TAB, idx, _field_start);
+                case '\0':
+                    return fail(KERR_UNEXPECTED_EOF, idx, _field_start);
+                case '\n':
+                    return fail(KERR_UNEXPECTED_NEWLINE, idx, _field_start);
+                default:
+                    assert(*end == ',');
+                    break;
+            }
+        } else if (*end == ',') {
+            return fail(KERR_MORE_ARRAY_ELEMENT, idx, _field_start);
+        }
+
+        _src = (*end == ',' || *end == '\t') ? end + 1 : end;
+
+        ParseResult ret = parse_element(idx, col, start,
+                                        static_cast<size_t>(end - start),
+                                        sink.element(idx, col, i),
+                                        col.element_size);
+        if (ret != KOK) {
+            return ret;
+        }
     }
 
-    return ret;
+    return KOK;
 }
 
-const char *TableParser::last_error() const { return _err; }
+template <typename Sink>
+bool TableParser::parse_number_array(unsigned idx, const ColumnDescriptor &col,
+                                     size_t count, Sink &sink,
+                                     ParseResult *ret) {
+    // 元素大小与类型不符时由回调报告错误
+    size_t expected = 0;
+    switch (col.type) {
+        case KINT:
+            expected = sizeof(int);
+            break;
+        case KINT64:
+            expected = sizeof(int64_t);
+            break;
+        case KUINT32:
+            expected = sizeof(uint32_t);
+            break;
+        case KUINT64:
+            expected = sizeof(uint64_t);
+            break;
+        case KFLOAT:
+            expected = sizeof(float);
+            break;
+        case KDOUBLE:
+            expected = sizeof(double);
+            break;
+        default:
+            return false;
+    }
+    if (col.element_size != expected) {
+        return false;
+    }
 
-ParseResult TableParser::parse_element(unsigned idx, const char *s,
-                                       size_t len, void *data) {
-    const ColumnDescriptor &desc = _desc[idx];
-    parser_callback cb;
+    // 一次定位所有逗号, 元素个数不符时交给逐元素解析报告具体错误
+    // 按数组上限预留, 避免随数组长度多次扩容
+    if (_commas.capacity() < count - 1) {
+        _commas.reserve(col.array_max);
+    }
+    _commas.resize(count - 1);
+    size_t found = 0;
+    const char *end = find_array_commas(_src, _commas.data(), count - 1, &found);
+    if (found != count - 1) {
+        return false;
+    }
 
-    switch (desc.type) {
+    const char *const *commas = _commas.data();
+    bool ok = false;
+    switch (col.type) {
         case KINT:
-            cb = parse_int_callback;
+            ok = convert_numbers<convert_int>(_src, commas, count, end, idx,
+                                              col, sink);
             break;
-        case KFLOAT:
-            cb = parse_float_callback;
+        case KINT64:
+            ok = convert_numbers<convert_int64>(_src, commas, count, end, idx,
+                                                col, sink);
             break;
-        case KSTRING:
-            cb = parse_string_callback;
+        case KUINT32:
+            ok = convert_numbers<convert_uint32>(_src, commas, count, end,
+                                                 idx, col, sink);
             break;
-        case KCLASS:
-            if (!desc.callback) {
-                std::snprintf(_err, sizeof(_err),
-                              "[ERROR] line %u: user-defined callback required "
-                              "at element %u.",
-                              _line, idx);
-                return KERROR;
-            }
-            cb = desc.callback;
+        case KUINT64:
+            ok = convert_numbers<convert_uint64>(_src, commas, count, end,
+                                                 idx, col, sink);
+            break;
+        case KFLOAT:
+            ok = convert_numbers<convert_float>(_src, commas, count, end, idx,
+                                                col, sink);
             break;
         default:
-            std::snprintf(
-                _err, sizeof(_err),
-                "[ERROR] line %u: unknown element type at element %u.", _line,
-                idx);
-            return KERROR;
+            ok = convert_numbers<convert_double>(_src, commas, count, end,
+                                                 idx, col, sink);
+            break;
+    }
+
+    _src = *end == '\t' ? end + 1 : end;
+    *ret = ok ? KOK : fail(KERR_PARSE_FAILED, idx, _field_start);
+    return true;
+}
+
+void TableParser::set_filter(const RowFilter *filter) { _filter = filter; }
+
+void TableParser::set_stats(ParseStats *stats) {
+    _stats = stats;
+    _row_start = nullptr;
+}
+
+#ifdef TP_ENABLE_STATS
+static void add_field(FieldStats *f, size_t len, uint64_t nanos,
+                      unsigned line) {
+    ++f->calls;
+    f->nanos += nanos;
+    f->bytes += len;
+    if (len > f->longest) {
+        f->longest = len;
+        f->longest_line = line;
+    }
+}
+
+void TableParser::record_field(unsigned idx, const ColumnDescriptor &col,
+                               size_t len, uint64_t begin_ns) {
+    uint64_t nanos = stats_clock_ns() - begin_ns;
+    if (_stats->columns.size() <= idx) {
+        FieldStats empty = {0, 0, 0, 0, 0};
+        _stats->columns.resize(idx + 1, empty);
+    }
+    add_field(&_stats->columns[idx], len, nanos, _line);
+    if (static_cast<size_t>(col.type) < KDATA_TYPE_COUNT) {
+        add_field(&_stats->types[col.type], len, nanos, _line);
+    }
+}
+
+void TableParser::record_row(ParseResult ret, const char *line_end,
+                             unsigned line) {
+    ParseStats &stats = *_stats;
+    ++stats.rows;
+    if (ret == KOK) {
+        ++stats.ok_rows;
+    } else if (ret == KFILTERED) {
+        ++stats.filtered_rows;
+    } else {
+        ++stats.failed_rows;
+        ++stats.errors[_error.code];
+    }
+
+    size_t len = static_cast<size_t>(line_end - _row_start);
+    stats.bytes += static_cast<uint64_t>(_src - _row_start);
+    if (len > stats.longest_line) {
+        stats.longest_line = len;
+        stats.longest_line_no = line;
     }
+    uint64_t nanos = stats_clock_ns() - _row_begin_ns;
+    stats.nanos += nanos;
+    stats.cpu_nanos += nanos;
+    _row_start = nullptr;
+}
+#endif
+
+const ParseError &TableParser::error() const { return _error; }
+
+unsigned TableParser::line() const { return _line; }
 
-    if (cb(s, len, data, desc.element_size, desc.context)) {
+size_t TableParser::offset() const { return offset_of(_src); }
+
+const char *TableParser::last_error() const {
+    if (_error.line == 0) {
+        return "ok";
+    }
+    _error.format(_err, sizeof(_err));
+    return _err;
+}
+
+ParseResult TableParser::parse_element(unsigned idx,
+                                       const ColumnDescriptor &col,
+                                       const char *s, size_t len, void *data,
+                                       size_t size) {
+    if (col.callback(s, len, data, size, col.context)) {
         return KOK;
     }
 
-    std::snprintf(_err, sizeof(_err),
-                  "[ERROR] line %u: element %u parse failed.", _line, idx);
-    return KERROR;
+    return fail(KERR_PARSE_FAILED, idx, _field_start);
 }
 }
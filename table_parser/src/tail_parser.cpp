@@ -0,0 +1,171 @@
+#include "tail_parser.h"
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_util.h"
+
+namespace tp {
+
+namespace {
+
+// 状态文件格式版本, 格式变化时递增
+const unsigned KTAIL_STATE_VERSION = 1;
+// offset之前参与校验的字节数
+const size_t KGUARD_SIZE = 64;
+
+uint64_t hash_bytes(const char *p, size_t len) {
+    uint64_t hash = KFNV_OFFSET;
+    fnv_update(&hash, p, len);
+    return hash;
+}
+
+bool read_full(int fd, char *buf, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pread(fd, buf, len, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            // 读取期间文件被截断
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+}
+
+TailStatus read_appended(const char *path, const TailState &state,
+                         TailChunk *chunk) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return KTAIL_OPEN_FAILED;
+    }
+
+    // 以打开的fd为准, 避免stat和open之间文件被替换
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return KTAIL_READ_FAILED;
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    uint64_t dev = static_cast<uint64_t>(st.st_dev);
+    uint64_t inode = static_cast<uint64_t>(st.st_ino);
+
+    // 未解析过的状态从头开始; 轮转、截断时从头重新解析
+    TailStatus status = KTAIL_APPENDED;
+    TailState start = state;
+    if (state.line != 0 && (dev != state.dev || inode != state.inode ||
+                            size < state.offset)) {
+        status = KTAIL_RESTARTED;
+    }
+    if (state.line == 0 || status == KTAIL_RESTARTED) {
+        memset(&start, 0, sizeof(start));
+        start.line = 1;
+    }
+
+    size_t guard = start.offset < KGUARD_SIZE
+                       ? static_cast<size_t>(start.offset)
+                       : KGUARD_SIZE;
+    uint64_t read_from = start.offset - guard;
+    std::vector<char> &data = chunk->data;
+    data.resize(static_cast<size_t>(size - read_from) + 1);
+    if (!read_full(fd, &data[0], data.size() - 1, read_from)) {
+        ::close(fd);
+        return KTAIL_READ_FAILED;
+    }
+
+    // offset之前的内容被改写, 例如复制后截断再写入超过原长度的数据
+    if (status == KTAIL_APPENDED && state.line != 0 &&
+        hash_bytes(&data[0], guard) != state.tail_hash) {
+        status = KTAIL_RESTARTED;
+        memset(&start, 0, sizeof(start));
+        start.line = 1;
+        guard = 0;
+        data.resize(static_cast<size_t>(size) + 1);
+        if (!read_full(fd, &data[0], data.size() - 1, 0)) {
+            ::close(fd);
+            return KTAIL_READ_FAILED;
+        }
+    }
+    ::close(fd);
+
+    // 末尾未结束的行留到下次读取
+    size_t end = data.size() - 1;
+    while (end > guard && data[end - 1] != '\n') {
+        --end;
+    }
+    data[end] = '\0';
+
+    start.dev = dev;
+    start.inode = inode;
+    start.size = size;
+    chunk->begin = guard;
+    chunk->end = end;
+    chunk->start = start;
+    return status;
+}
+
+void advance_tail_state(const TailChunk &chunk, size_t consumed,
+                        unsigned line, TailState *state) {
+    *state = chunk.start;
+    state->offset += consumed;
+    state->line = line;
+
+    size_t pos = chunk.begin + consumed;
+    size_t guard = pos < KGUARD_SIZE ? pos : KGUARD_SIZE;
+    state->tail_hash = hash_bytes(&chunk.data[pos - guard], guard);
+}
+
+bool save_tail_state(const char *path, const TailState &state) {
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf),
+                       "TPTAIL %u %" PRIu64 " %u %" PRIu64 " %" PRIu64
+                       " %" PRIu64 " %" PRIu64 "\n",
+                       KTAIL_STATE_VERSION, state.offset, state.line,
+                       state.dev, state.inode, state.size, state.tail_hash);
+    if (len < 0 || static_cast<size_t>(len) >= sizeof(buf)) {
+        return false;
+    }
+
+    // 原子替换, 崩溃时不会留下写了一半的状态
+    FileChunk chunk = {buf, static_cast<size_t>(len)};
+    return replace_file(path, &chunk, 1);
+}
+
+bool load_tail_state(const char *path, TailState *state) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return false;
+    }
+
+    unsigned version = 0;
+    TailState loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    int n = fscanf(fp,
+                   "TPTAIL %u %" SCNu64 " %u %" SCNu64 " %" SCNu64 " %" SCNu64
+                   " %" SCNu64,
+                   &version, &loaded.offset, &loaded.line, &loaded.dev,
+                   &loaded.inode, &loaded.size, &loaded.tail_hash);
+    fclose(fp);
+    if (n != 7 || version != KTAIL_STATE_VERSION) {
+        return false;
+    }
+
+    *state = loaded;
+    return true;
+}
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include "field_parser.h"
+#include "table_parser.h"
+
+using namespace std;
+
+struct array_data {
+    unsigned int_count;
+    int ints[64];
+    unsigned float_count;
+    float floats[64];
+    unsigned double_count;
+    double doubles[16];
+    unsigned uint64_count;
+    uint64_t uint64s[8];
+};
+
+static tp::ColumnDescriptor array_desc[] = {
+    {tp::KINT, true, 64, sizeof(int), offsetof(array_data, ints),
+     offsetof(array_data, int_count), nullptr, nullptr},
+    {tp::KFLOAT, true, 64, sizeof(float), offsetof(array_data, floats),
+     offsetof(array_data, float_count), nullptr, nullptr},
+    {tp::KDOUBLE, true, 16, sizeof(double), offsetof(array_data, doubles),
+     offsetof(array_data, double_count), nullptr, nullptr},
+    {tp::KUINT64, true, 8, sizeof(uint64_t), offsetof(array_data, uint64s),
+     offsetof(array_data, uint64_count), nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static string RandomInt() {
+    static const char* const special[] = {"0",           "-0",  "+7",
+                                          "007",         "-1",  "2147483647",
+                                          "-2147483648", "99999999"};
+    char buf[32];
+    if (rand() % 4 == 0) {
+        return special[rand() % 8];
+    }
+    snprintf(buf, sizeof(buf), "%d", rand() - RAND_MAX / 2);
+    return buf;
+}
+
+static string RandomFloat() {
+    static const char* const special[] = {"0",    "-0.0",   "1.",     "0.05",
+                                          "1e10", "-2.5E-3", "123456789.5",
+                                          "0.123456789", "+3.25", "16777217"};
+    char buf[64];
+    switch (rand() % 4) {
+        case 0:
+            return special[rand() % 10];
+        case 1:
+            snprintf(buf, sizeof(buf), "%.3f", (rand() - RAND_MAX / 2) / 1e3);
+            return buf;
+        case 2:
+            snprintf(buf, sizeof(buf), "%.8f", rand() / 1e9);
+            return buf;
+        default:
+            snprintf(buf, sizeof(buf), "%.6e", rand() / 7.0);
+            return buf;
+    }
+}
+
+static string Join(const vector<string>& values) {
+    string s = to_string(values.size()) + ":";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) s += ',';
+        s += values[i];
+    }
+    return s;
+}
+
+TEST(TestArray, MatchElementParsers) {
+    srand(42);
+    for (int round = 0; round < 200; ++round) {
+        vector<string> ints, floats, doubles, uint64s;
+        for (int i = rand() % 65; i > 0; --i) ints.push_back(RandomInt());
+        for (int i = rand() % 65; i > 0; --i) floats.push_back(RandomFloat());
+        for (int i = rand() % 17; i > 0; --i) doubles.push_back(RandomFloat());
+        for (int i = rand() % 9; i > 0; --i) {
+            uint64s.push_back(rand() % 2 ? "18446744073709551615"
+                                         : to_string(rand()));
+        }
+
+        string input = Join(ints) + "\t" + Join(floats) + "\t" +
+                       Join(doubles) + "\t" + Join(uint64s);
+        vector<array_data> out;
+        vector<tp::ParseError> err;
+        ASSERT_EQ(1u, tp::parse_all(input.c_str(), array_desc, out, err))
+            << input;
+        const array_data& row = out[0];
+
+        ASSERT_EQ(ints.size(), row.int_count);
+        for (size_t i = 0; i < ints.size(); ++i) {
+            int64_t expected = 0;
+            ASSERT_TRUE(tp::parse_signed(ints[i].data(), ints[i].size(),
+                                         INT32_MAX, &expected));
+            EXPECT_EQ(expected, row.ints[i]) << ints[i];
+        }
+        ASSERT_EQ(floats.size(), row.float_count);
+        for (size_t i = 0; i < floats.size(); ++i) {
+            float expected = 0;
+            ASSERT_TRUE(tp::parse_float(floats[i].data(), floats[i].size(),
+                                        &expected));
+            EXPECT_EQ(expected, row.floats[i]) << floats[i];
+        }
+        ASSERT_EQ(doubles.size(), row.double_count);
+        for (size_t i = 0; i < doubles.size(); ++i) {
+            EXPECT_EQ(strtod(doubles[i].c_str(), nullptr), row.doubles[i])
+                << doubles[i];
+        }
+        ASSERT_EQ(uint64s.size(), row.uint64_count);
+        for (size_t i = 0; i < uint64s.size(); ++i) {
+            EXPECT_EQ(strtoull(uint64s[i].c_str(), nullptr, 10),
+                      row.uint64s[i]);
+        }
+    }
+}
+
+static tp::ErrorCode FirstError(const char* input) {
+    vector<array_data> out;
+    vector<tp::ParseError> err;
+    tp::parse_all(input, array_desc, out, err);
+    return err.empty() ? tp::KERR_OK : err[0].code;
+}
+
+TEST(TestArray, Errors) {
+    EXPECT_EQ(tp::KERR_OK, FirstError("2:1,-2\t1:0.5\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_UNEXPECTED_TAB, FirstError("3:1,2\t1:0.5\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_UNEXPECTED_NEWLINE, FirstError("1:1\t1:0.5\t0:\t2:1\n"));
+    EXPECT_EQ(tp::KERR_UNEXPECTED_EOF, FirstError("1:1\t1:0.5\t0:\t2:1"));
+    EXPECT_EQ(tp::KERR_MORE_ARRAY_ELEMENT,
+              FirstError("2:1,2,3\t1:0.5\t0:\t1:1"));
+    // 结构错误之前的元素转换失败优先报告
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, FirstError("3:x,2\t1:0.5\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, FirstError("2:1,x\t1:0.5\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED,
+              FirstError("1:2147483648\t1:0.5\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, FirstError("2:1,\t1:0.5\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED,
+              FirstError("1:1\t2:01.5,0\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, FirstError("1:1\t2:.5,0\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, FirstError("1:1\t2:1.5x,0\t0:\t1:1"));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, FirstError("1:1\t1:0.5\t0:\t1:-1"));
+}
+
+TEST(TestArray, PaddedParsers) {
+    // 数字之后留出可读的字节
+    const char* s = "-12345678,+12.50000000,1.e5,";
+    int64_t i = 0;
+    EXPECT_TRUE(tp::parse_signed_padded(s, 9, INT32_MAX, &i));
+    EXPECT_EQ(-12345678, i);
+    EXPECT_FALSE(tp::parse_signed_padded(s, 10, INT32_MAX, &i));
+
+    float f = 0;
+    EXPECT_TRUE(tp::parse_float_padded(s + 10, 12, &f));
+    EXPECT_EQ(12.5f, f);
+    double d = 0;
+    EXPECT_TRUE(tp::parse_double_padded(s + 10, 12, &d));
+    EXPECT_EQ(12.5, d);
+    EXPECT_FALSE(tp::parse_float_padded("0012.5,\t\t\t\t\t\t\t\t", 6, &f));
+    EXPECT_TRUE(tp::parse_double_padded(s + 23, 4, &d));
+    EXPECT_EQ(1e5, d);
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+
+#include <sstream>
+
+#include "table_parser.h"
+
+using namespace std;
+
+struct batch_data {
+    int id;
+    float score;
+};
+
+static tp::ColumnDescriptor batch_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(batch_data, id), 0, nullptr,
+     nullptr},
+    {tp::KFLOAT, false, 0, sizeof(float), offsetof(batch_data, score), 0,
+     nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static const char* batch_input =
+    "1\t0.5\n"
+    "2\tx\n"
+    "3\t1.5\n"
+    "4\t2.5\n"
+    "bad\t1\n"
+    "6\t3.5\n"
+    "7\t4.5\n";
+
+TEST(TestBatch, FixedBuffer) {
+    tp::TableParser parser(batch_input, batch_desc);
+    batch_data buf[2];
+    vector<int> ids;
+    vector<tp::ParseError> errors;
+
+    tp::BatchResult result = parser.parse_batch(buf, 2, &errors);
+    EXPECT_EQ(2u, result.rows);
+    EXPECT_EQ(1u, result.failed);
+    EXPECT_FALSE(result.eof);
+    EXPECT_EQ(1, buf[0].id);
+    EXPECT_EQ(3, buf[1].id);
+
+    while (!result.eof) {
+        result = parser.parse_batch(buf, 2, &errors);
+        for (size_t i = 0; i < result.rows; ++i) {
+            ids.push_back(buf[i].id);
+        }
+    }
+
+    ASSERT_EQ(3u, ids.size());
+    EXPECT_EQ(4, ids[0]);
+    EXPECT_EQ(6, ids[1]);
+    EXPECT_EQ(7, ids[2]);
+    ASSERT_EQ(2u, errors.size());
+    EXPECT_EQ(2u, errors[0].line);
+    EXPECT_EQ(5u, errors[1].line);
+
+    result = parser.parse_batch(buf, 2, &errors);
+    EXPECT_EQ(0u, result.rows);
+    EXPECT_TRUE(result.eof);
+}
+
+TEST(TestBatch, SameAsParse) {
+    string input;
+    for (int i = 0; i < 5000; ++i) {
+        input += to_string(i) + (i % 97 == 0 ? "\tnan?\n" : "\t1.25\n");
+    }
+
+    vector<batch_data> expect;
+    tp::TableParser row_parser(input.c_str(), batch_desc);
+    unsigned expect_errors = 0;
+    while (true) {
+        batch_data data;
+        tp::ParseResult ret = row_parser.parse(&data, sizeof(data));
+        if (ret == tp::KEOF) {
+            break;
+        }
+        if (ret == tp::KOK) {
+            expect.push_back(data);
+        } else {
+            ++expect_errors;
+        }
+    }
+
+    vector<batch_data> results;
+    vector<tp::ParseError> errors;
+    unsigned count = tp::parse_all(input.c_str(), batch_desc, results, errors);
+
+    EXPECT_EQ(expect.size(), count);
+    ASSERT_EQ(expect.size(), results.size());
+    EXPECT_EQ(expect_errors, errors.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(expect[i].id, results[i].id);
+    }
+}
+
+TEST(TestBatch, Stream) {
+    istringstream in(batch_input);
+    tp::IstreamInputStream stream(in);
+    tp::TableParser parser(&stream, batch_desc, 4);
+
+    batch_data buf[16];
+    tp::BatchResult result = parser.parse_batch(buf, 16);
+    EXPECT_EQ(5u, result.rows);
+    EXPECT_EQ(2u, result.failed);
+    EXPECT_TRUE(result.eof);
+    EXPECT_EQ(7, buf[4].id);
+}
+
+TEST(TestBatch, PlanError) {
+    tp::TableParser parser(batch_input, batch_desc);
+    int small[8];
+    vector<tp::ParseError> errors;
+    tp::BatchResult result =
+        parser.parse_batch(small, sizeof(int), 8, &errors);
+
+    EXPECT_EQ(0u, result.rows);
+    EXPECT_EQ(7u, result.failed);
+    ASSERT_EQ(7u, errors.size());
+    EXPECT_EQ(tp::KERR_OUT_OF_BOUNDARY, errors[6].code);
+    EXPECT_EQ(7u, errors[6].line);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <cstring>
+
+#include "columnar_table.h"
+
+using namespace std;
+
+static tp::ColumnDescriptor columnar_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), 0, 0, nullptr, nullptr},
+    {tp::KSTRING, false, 0, 0, 0, 0, nullptr, nullptr},
+    {tp::KFLOAT, true, 4, sizeof(float), 0, 0, nullptr, nullptr},
+    {tp::KDOUBLE, false, 0, sizeof(double), 0, 0, nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+TEST(TestColumnar, FillColumns) {
+    const char* input =
+        "1\tshort\t2:1.5,2.5\t0.25\n"
+        "2\ta string longer than any fixed buffer would be\t0:\t1e10\n"
+        "3\tbad\t2:1\t0\n"
+        "4\t\t4:1,2,3,4\t-1\n";
+
+    tp::ColumnarTable table(columnar_desc);
+    ASSERT_TRUE(table.plan().ok());
+
+    tp::TableParser parser(input, columnar_desc);
+    vector<string> errors;
+    unsigned count = tp::parse_all(parser, table, errors);
+
+    EXPECT_EQ(3u, count);
+    ASSERT_EQ(3u, table.row_count());
+    EXPECT_EQ(4u, table.column_count());
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ(0u, errors[0].find("[ERROR] line 3"));
+
+    const int* ints = table.values<int>(0);
+    EXPECT_EQ(1, ints[0]);
+    EXPECT_EQ(2, ints[1]);
+    EXPECT_EQ(4, ints[2]);
+
+    size_t len = 0;
+    EXPECT_STREQ("short", table.string(1, 0, &len));
+    EXPECT_EQ(5u, len);
+    EXPECT_STREQ("a string longer than any fixed buffer would be",
+                 table.string(1, 1));
+    EXPECT_STREQ("", table.string(1, 2, &len));
+    EXPECT_EQ(0u, len);
+
+    size_t n = 0;
+    const float* a = table.array<float>(2, 0, &n);
+    ASSERT_EQ(2u, n);
+    EXPECT_EQ(1.5f, a[0]);
+    EXPECT_EQ(2.5f, a[1]);
+    table.array<float>(2, 1, &n);
+    EXPECT_EQ(0u, n);
+    a = table.array<float>(2, 2, &n);
+    ASSERT_EQ(4u, n);
+    EXPECT_EQ(4.0f, a[3]);
+
+    // 失败的行不会残留数据
+    EXPECT_EQ(6u, table.offsets(2)[3]);
+    const float* flat = table.array_values<float>(2);
+    EXPECT_EQ(1.0f, flat[2]);
+
+    const double* d = table.values<double>(3);
+    EXPECT_EQ(0.25, d[0]);
+    EXPECT_EQ(1e10, d[1]);
+    EXPECT_EQ(-1.0, d[2]);
+}
+
+TEST(TestColumnar, Clear) {
+    tp::ColumnarTable table(columnar_desc);
+    tp::TableParser parser("1\tx\t0:\t0\n", columnar_desc);
+    vector<string> errors;
+    EXPECT_EQ(1u, tp::parse_all(parser, table, errors));
+
+    table.clear();
+    EXPECT_EQ(0u, table.row_count());
+    EXPECT_EQ(0u, table.offsets(1)[0]);
+}
+
+TEST(TestColumnar, RowParseRejectsLayoutFreePlan) {
+    tp::ParsePlan plan(columnar_desc);
+    EXPECT_TRUE(plan.ok());
+    EXPECT_FALSE(plan.has_layout());
+
+    tp::TableParser parser("1\tx\t0:\t0\n", plan);
+    char buf[64];
+    EXPECT_EQ(tp::KERROR, parser.parse(buf, sizeof(buf)));
+    EXPECT_STREQ("[ERROR] line 1: plan has no row layout.",
+                 parser.last_error());
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
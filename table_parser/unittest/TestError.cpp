@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstring>
+
+#include <sstream>
+
+#include "columnar_table.h"
+#include "parallel_parser.h"
+
+using namespace std;
+
+struct error_data {
+    int a;
+    int count_b;
+    int b[2];
+};
+
+static tp::ColumnDescriptor error_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(error_data, a), 0, nullptr,
+     nullptr},
+    {tp::KINT, true, 2, sizeof(int), offsetof(error_data, b),
+     offsetof(error_data, count_b), nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static const char* error_input =
+    "1\t2:1,2\n"
+    "x\t1:1\n"
+    "3\t3:1,2,3\n"
+    "4\t1:1\n"
+    "5\n"
+    "6\t2:1,y\n";
+
+TEST(TestError, OnlyFailedRows) {
+    vector<error_data> results;
+    vector<tp::ParseError> errors;
+    unsigned count = tp::parse_all(error_input, error_desc, results, errors);
+
+    EXPECT_EQ(2u, count);
+    ASSERT_EQ(4u, errors.size());
+
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, errors[0].code);
+    EXPECT_EQ(2u, errors[0].line);
+    EXPECT_EQ(0u, errors[0].column);
+    EXPECT_EQ(8u, errors[0].offset);
+
+    EXPECT_EQ(tp::KERR_SIZE_OUT_OF_RANGE, errors[1].code);
+    EXPECT_EQ(3u, errors[1].line);
+    EXPECT_EQ(1u, errors[1].column);
+    EXPECT_EQ(16u, errors[1].offset);
+
+    EXPECT_EQ(tp::KERR_ELEMENT_REQUIRED, errors[2].code);
+    EXPECT_EQ(5u, errors[2].line);
+    EXPECT_EQ(1u, errors[2].column);
+    EXPECT_EQ(31u, errors[2].offset);
+
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, errors[3].code);
+    EXPECT_EQ(6u, errors[3].line);
+    EXPECT_EQ(1u, errors[3].column);
+    EXPECT_EQ(34u, errors[3].offset);
+    EXPECT_EQ("[ERROR] line 6: element 1 parse failed.", errors[3].message());
+}
+
+TEST(TestError, LazyLastError) {
+    tp::TableParser parser(error_input, error_desc);
+    EXPECT_STREQ("ok", parser.last_error());
+
+    error_data data;
+    EXPECT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KERR_OK, parser.error().code);
+    EXPECT_STREQ("[OK] line 1: parse success", parser.last_error());
+
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_STREQ("[ERROR] line 2: element 0 parse failed.",
+                 parser.last_error());
+}
+
+TEST(TestError, StreamOffsets) {
+    vector<error_data> expect;
+    vector<tp::ParseError> expect_err;
+    tp::parse_all(error_input, error_desc, expect, expect_err);
+
+    // 缓冲区很小, 偏移须计入已丢弃的数据
+    istringstream in(error_input);
+    tp::IstreamInputStream stream(in);
+    tp::TableParser parser(&stream, error_desc, 3);
+    vector<error_data> results;
+    vector<tp::ParseError> errors;
+    tp::parse_all(parser, results, errors);
+
+    ASSERT_EQ(expect_err.size(), errors.size());
+    for (size_t i = 0; i < errors.size(); ++i) {
+        EXPECT_EQ(expect_err[i].offset, errors[i].offset);
+        EXPECT_EQ(expect_err[i].line, errors[i].line);
+    }
+}
+
+TEST(TestError, ParallelOffsets) {
+    string input;
+    for (int i = 0; i < 100000; ++i) {
+        input += (i % 1000 == 7) ? "bad\t0:\n" : "1\t1:2\n";
+    }
+
+    vector<error_data> expect;
+    vector<tp::ParseError> expect_err;
+    tp::parse_all(input.c_str(), error_desc, expect, expect_err);
+
+    vector<error_data> results;
+    vector<tp::ParseError> errors;
+    tp::parse_all_parallel(input.c_str(), error_desc, results, errors, 4);
+
+    ASSERT_EQ(100u, errors.size());
+    ASSERT_EQ(expect_err.size(), errors.size());
+    for (size_t i = 0; i < errors.size(); ++i) {
+        EXPECT_EQ(expect_err[i].line, errors[i].line);
+        EXPECT_EQ(expect_err[i].offset, errors[i].offset);
+        EXPECT_EQ(0, strncmp(input.c_str() + errors[i].offset, "bad", 3));
+    }
+}
+
+TEST(TestError, Columnar) {
+    tp::ColumnarTable table(error_desc);
+    tp::TableParser parser(error_input, error_desc);
+    vector<tp::ParseError> errors;
+    EXPECT_EQ(2u, tp::parse_all(parser, table, errors));
+    ASSERT_EQ(4u, errors.size());
+    EXPECT_EQ(6u, errors[3].line);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
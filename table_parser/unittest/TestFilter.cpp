@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstring>
+
+#include "columnar_table.h"
+
+using namespace std;
+
+static int custom_calls = 0;
+
+static bool parse_counted(const char* s, size_t len, void* data, size_t size,
+                          void* context) {
+    static_cast<void>(s);
+    static_cast<void>(len);
+    static_cast<void>(context);
+    ++custom_calls;
+    memset(data, 0xff, size);
+    return true;
+}
+
+struct filter_data {
+    char name[16];
+    int age;
+    double score;
+    unsigned count_tags;
+    int tags[4];
+    int blob;
+};
+
+static tp::ColumnDescriptor filter_desc[] = {
+    {tp::KSTRING, false, 0, sizeof(((filter_data*)0)->name),
+     offsetof(filter_data, name), 0, nullptr, nullptr},
+    {tp::KINT, false, 0, sizeof(int), offsetof(filter_data, age), 0, nullptr,
+     nullptr},
+    {tp::KDOUBLE, false, 0, sizeof(double), offsetof(filter_data, score), 0,
+     nullptr, nullptr},
+    {tp::KINT, true, 4, sizeof(int), offsetof(filter_data, tags),
+     offsetof(filter_data, count_tags), nullptr, nullptr},
+    {tp::KCLASS, false, 0, sizeof(int), offsetof(filter_data, blob), 0,
+     parse_counted, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static const char* filter_input =
+    "alice\t30\t1.5\t2:1,2\tx\n"
+    "bob\t17\t2.5\t1:3\tx\n"
+    "albert\t45\tbad\t0:\tx\n"
+    "carol\t52\t9.5\t1:oops\tx\n"
+    "alfred\t99\t0.5\t1:4\tx\n";
+
+TEST(TestFilter, Projection) {
+    tp::RowFilter filter;
+    filter.select(0).select(3);
+
+    tp::TableParser parser(filter_input, filter_desc);
+    parser.set_filter(&filter);
+    vector<filter_data> results;
+    vector<tp::ParseError> errors;
+    custom_calls = 0;
+    unsigned count = tp::parse_all(parser, results, errors);
+
+    // 未投影的列不转换, 其中的非法内容也不会报错
+    EXPECT_EQ(0, custom_calls);
+    EXPECT_EQ(4u, count);
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ(4u, errors[0].line);
+    EXPECT_EQ(3u, errors[0].column);
+
+    EXPECT_STREQ("albert", results[2].name);
+    EXPECT_EQ(0, results[2].age);
+    EXPECT_EQ(0u, results[2].count_tags);
+    EXPECT_EQ(2u, results[0].count_tags);
+    EXPECT_EQ(2, results[0].tags[1]);
+}
+
+TEST(TestFilter, Predicates) {
+    tp::RowFilter filter;
+    filter.prefix(0, "al").int_range(1, 18, 60);
+
+    tp::TableParser parser(filter_input, filter_desc);
+    parser.set_filter(&filter);
+
+    filter_data data;
+    custom_calls = 0;
+    EXPECT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_STREQ("alice", data.name);
+    EXPECT_EQ(tp::KFILTERED, parser.parse(&data, sizeof(data)));
+    // 满足条件的行仍然完整转换, score非法
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, parser.error().code);
+    EXPECT_EQ(tp::KFILTERED, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KFILTERED, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KEOF, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(1, custom_calls);
+}
+
+TEST(TestFilter, EqualAndFloatRange) {
+    tp::RowFilter filter;
+    filter.float_range(2, 1.0, 3.0).equal(4, "x");
+
+    tp::TableParser parser(filter_input, filter_desc);
+    parser.set_filter(&filter);
+    filter_data buf[8];
+    tp::BatchResult result = parser.parse_batch(buf, 8);
+    EXPECT_EQ(2u, result.rows);
+    EXPECT_EQ(3u, result.filtered);
+    EXPECT_EQ(0u, result.failed);
+    EXPECT_STREQ("bob", buf[1].name);
+}
+
+TEST(TestFilter, MissingColumn) {
+    tp::RowFilter filter;
+    filter.equal(7, "x");
+
+    tp::TableParser parser(filter_input, filter_desc);
+    parser.set_filter(&filter);
+    filter_data data;
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_STREQ("[ERROR] line 1: filter refers to element 7.",
+                 parser.last_error());
+}
+
+TEST(TestFilter, Columnar) {
+    tp::RowFilter filter;
+    filter.select(1).int_range(1, 0, 50);
+
+    tp::ColumnarTable table(filter_desc);
+    tp::TableParser parser(filter_input, filter_desc);
+    parser.set_filter(&filter);
+    vector<string> errors;
+    EXPECT_EQ(3u, tp::parse_all(parser, table, errors));
+    EXPECT_TRUE(errors.empty());
+    ASSERT_EQ(3u, table.row_count());
+
+    EXPECT_EQ(45, table.values<int>(1)[2]);
+    EXPECT_EQ(0.0, table.values<double>(2)[1]);
+    EXPECT_STREQ("", table.string(0, 1));
+    size_t n = 1;
+    table.array<int>(3, 2, &n);
+    EXPECT_EQ(0u, n);
+}
+
+struct array_first {
+    unsigned count_a;
+    int a[4];
+    int b;
+};
+
+static tp::ColumnDescriptor array_first_desc[] = {
+    {tp::KINT, true, 4, sizeof(int), offsetof(array_first, a),
+     offsetof(array_first, count_a), nullptr, nullptr},
+    {tp::KINT, false, 0, sizeof(int), offsetof(array_first, b), 0, nullptr,
+     nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+TEST(TestFilter, SameResultAsUnfiltered) {
+    // 数组边界与列分隔符不一致的行, 有无过滤条件时结果必须相同
+    const char* input =
+        "0:junk\t5\n"
+        "0:5\n"
+        "2:1,2\t7\n"
+        "1:1,2\t7\n"
+        "0:\t8\n"
+        "3:1,2\t9\n"
+        "0:\t1\t2\n"
+        "00:6\n";
+
+    vector<array_first> plain_rows;
+    vector<tp::ParseError> plain_errors;
+    tp::TableParser plain(input, array_first_desc);
+    unsigned plain_count = tp::parse_all(plain, plain_rows, plain_errors);
+
+    tp::RowFilter filter;
+    filter.int_range(1, 0, 100);
+    vector<array_first> rows;
+    vector<tp::ParseError> errors;
+    tp::TableParser parser(input, array_first_desc);
+    parser.set_filter(&filter);
+    EXPECT_EQ(plain_count, tp::parse_all(parser, rows, errors));
+
+    EXPECT_EQ(4u, plain_count);
+    ASSERT_EQ(plain_rows.size(), rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        EXPECT_EQ(plain_rows[i].count_a, rows[i].count_a);
+        EXPECT_EQ(plain_rows[i].b, rows[i].b);
+    }
+    EXPECT_EQ(5, rows[0].b);
+    EXPECT_EQ(6, rows[3].b);
+
+    ASSERT_EQ(plain_errors.size(), errors.size());
+    for (size_t i = 0; i < errors.size(); ++i) {
+        EXPECT_EQ(plain_errors[i].code, errors[i].code);
+        EXPECT_EQ(plain_errors[i].line, errors[i].line);
+        EXPECT_EQ(plain_errors[i].column, errors[i].column);
+        EXPECT_EQ(plain_errors[i].offset, errors[i].offset);
+    }
+    EXPECT_EQ(tp::KERR_PARSE_FAILED, errors[0].code);
+    EXPECT_EQ(1u, errors[0].column);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
+#include <clocale>
 #include <cmath>
 #include <cstring>
+#include <string>
 
 #include "../src/table_parser.cpp"
 
@@ -33,14 +35,14 @@ GENERATE_LEGAL_TEST(TestLong2, 0.0000000000000000000000000000000000001)
 TEST(TestFloat, TestInf) {
     float f;
     ASSERT_TRUE(tp::parse_float_callback("1e99", 4, &f, sizeof(float), NULL));
-    EXPECT_NE(0, isinf(f));
+    EXPECT_NE(0, std::isinf(f));
     EXPECT_GT(f, 0);
 }
 
 TEST(TestFloat, TestNegInf) {
     float f;
     ASSERT_TRUE(tp::parse_float_callback("-1e99", 5, &f, sizeof(float), NULL));
-    EXPECT_NE(0, isinf(f));
+    EXPECT_NE(0, std::isinf(f));
     EXPECT_LT(f, 0);
 }
 
@@ -59,6 +61,93 @@ GENERATE_ILLEGAL_TEST(TestIllegalExpSym, "5e*11")
 GENERATE_ILLEGAL_TEST(TestDuplicateSym, "--5e11")
 GENERATE_ILLEGAL_TEST(TestDuplicateExp, "5ee11")
 
+GENERATE_ILLEGAL_TEST(TestJunkFraction, "1.5x")
+GENERATE_ILLEGAL_TEST(TestMissingExp, "1e")
+GENERATE_ILLEGAL_TEST(TestLeadingZero, "05")
+
+#define GENERATE_ROUNDING_TEST(NAME, TEXT, VALUE)                      \
+    TEST(TestFloat, NAME) {                                            \
+        float f;                                                       \
+        ASSERT_TRUE(tp::parse_float_callback(TEXT, strlen(TEXT), &f,   \
+                                             sizeof(float), NULL));    \
+        EXPECT_EQ(VALUE, f);                                           \
+    }
+
+// 恰好位于两个float中点时按偶数舍入
+GENERATE_ROUNDING_TEST(TestMidpointInt, "16777217", 16777216.0f)
+GENERATE_ROUNDING_TEST(TestMidpointFrac, "1.000000059604644775390625", 1.0f)
+GENERATE_ROUNDING_TEST(TestBelowMidpoint,
+                       "1.00000005960464477539062499999", 1.0f)
+GENERATE_ROUNDING_TEST(TestAboveMidpoint,
+                       "1.00000005960464477539062500001",
+                       std::nextafter(1.0f, 2.0f))
+GENERATE_ROUNDING_TEST(TestDenormal, "1e-45", 1.40129846e-45f)
+GENERATE_ROUNDING_TEST(TestTenth, "0.1", 0.1f)
+GENERATE_ROUNDING_TEST(TestNegZero, "-0", -0.0f)
+
+#define GENERATE_DOUBLE_TEST(NAME, TEXT, VALUE)                        \
+    TEST(TestFloat, NAME) {                                            \
+        double d;                                                      \
+        ASSERT_TRUE(tp::parse_double_callback(TEXT, strlen(TEXT), &d,  \
+                                              sizeof(double), NULL));  \
+        EXPECT_EQ(VALUE, d);                                           \
+    }
+
+// 尾数超过2^53或指数超过22时走慢速路径
+GENERATE_DOUBLE_TEST(TestDoubleMidpoint, "9007199254740993", 9007199254740992.0)
+GENERATE_DOUBLE_TEST(TestDoubleDigits, "0.30000000000000004",
+                     0.30000000000000004)
+GENERATE_DOUBLE_TEST(TestDoubleMax, "1.7976931348623157e308",
+                     1.7976931348623157e308)
+GENERATE_DOUBLE_TEST(TestDoubleDenormal, "4.9e-324", 4.9e-324)
+GENERATE_DOUBLE_TEST(TestDoubleOverflow, "1e400", HUGE_VAL)
+
+TEST(TestFloat, TestDoubleManyDigits) {
+    // 超过保留位数的非0数字仍然影响舍入
+    std::string text = "9007199254740993." + std::string(900, '0');
+    double d;
+    ASSERT_TRUE(tp::parse_double_callback(text.c_str(), text.size(), &d,
+                                          sizeof(double), NULL));
+    EXPECT_EQ(9007199254740992.0, d);
+
+    text += "1";
+    ASSERT_TRUE(tp::parse_double_callback(text.c_str(), text.size(), &d,
+                                          sizeof(double), NULL));
+    EXPECT_EQ(9007199254740994.0, d);
+
+    text = "0." + std::string(900, '0') + "1e901";
+    ASSERT_TRUE(tp::parse_double_callback(text.c_str(), text.size(), &d,
+                                          sizeof(double), NULL));
+    EXPECT_EQ(1.0, d);
+}
+
+TEST(TestFloat, TestLocaleIndependent) {
+    // 小数点为','的locale下结果不变
+    const char* names[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8"};
+    const char* old = setlocale(LC_NUMERIC, nullptr);
+    std::string saved = old ? old : "C";
+    bool found = false;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]) && !found; ++i) {
+        found = setlocale(LC_NUMERIC, names[i]) != nullptr;
+    }
+    if (!found) {
+        GTEST_SKIP() << "no locale with ',' as decimal point";
+    }
+
+    double d = 0;
+    float f = 0;
+    bool double_ok = tp::parse_double_callback(
+        "1.2345678901234567e30", 21, &d, sizeof(double), NULL);
+    bool float_ok = tp::parse_float_callback("1.5e-40", 7, &f, sizeof(float),
+                                             NULL);
+    setlocale(LC_NUMERIC, saved.c_str());
+
+    ASSERT_TRUE(double_ok);
+    ASSERT_TRUE(float_ok);
+    EXPECT_EQ(1.2345678901234567e30, d);
+    EXPECT_EQ(1.5e-40f, f);
+}
+
 TEST(TestFloat, TestSizeTooLarge) {
     double f;
     ASSERT_FALSE(tp::parse_float_callback("0", 1, &f, sizeof(f), NULL));
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstring>
+
+#include "hash_index.h"
+
+using namespace std;
+
+struct IndexRow {
+    int id;
+    int64_t big;
+    char name[16];
+    int pair[2];
+};
+
+static tp::ColumnDescriptor index_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(IndexRow, id), 0, nullptr,
+     nullptr},
+    {tp::KINT64, false, 0, sizeof(int64_t), offsetof(IndexRow, big), 0,
+     nullptr, nullptr},
+    {tp::KSTRING, false, 0, sizeof(((IndexRow*)0)->name),
+     offsetof(IndexRow, name), 0, nullptr, nullptr},
+    {tp::KCLASS, false, 0, sizeof(((IndexRow*)0)->pair),
+     offsetof(IndexRow, pair), 0, nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static uint64_t pair_hash(const void* field) {
+    const int* p = static_cast<const int*>(field);
+    return static_cast<uint64_t>(p[0]) * 31 + static_cast<uint64_t>(p[1]);
+}
+
+static bool pair_equal(const void* field, const void* key) {
+    return memcmp(field, key, 2 * sizeof(int)) == 0;
+}
+
+static vector<IndexRow> make_rows(size_t count) {
+    vector<IndexRow> rows(count);
+    for (size_t i = 0; i < count; ++i) {
+        memset(&rows[i], 0, sizeof(IndexRow));
+        rows[i].id = static_cast<int>(i) * 3 - 100;
+        rows[i].big = static_cast<int64_t>(i) << 33;
+        snprintf(rows[i].name, sizeof(rows[i].name), "key%zu", i);
+        rows[i].pair[0] = static_cast<int>(i % 7);
+        rows[i].pair[1] = static_cast<int>(i);
+    }
+    return rows;
+}
+
+TEST(TestIndex, IntKey) {
+    vector<IndexRow> rows = make_rows(1000);
+    tp::HashIndex index;
+    ASSERT_TRUE(index.build(&rows[0], rows.size(), index_desc, 0));
+    EXPECT_EQ(1000u, index.size());
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        EXPECT_EQ(i, index.find(rows[i].id));
+    }
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find(-99));
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find("key1", 4));
+
+    const IndexRow* row = index.get<IndexRow>(2);
+    ASSERT_TRUE(row != nullptr);
+    EXPECT_EQ(34, row - &rows[0]);
+
+    tp::HashIndex big;
+    ASSERT_TRUE(big.build(&rows[0], rows.size(), index_desc, 1));
+    EXPECT_EQ(999u, big.find(static_cast<int64_t>(999) << 33));
+}
+
+TEST(TestIndex, StringKey) {
+    vector<IndexRow> rows = make_rows(1000);
+    tp::HashIndex index;
+    ASSERT_TRUE(index.build(&rows[0], rows.size(), index_desc, 2));
+
+    EXPECT_EQ(0u, index.find("key0", 4));
+    EXPECT_EQ(999u, index.find(string("key999")));
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find("key9999", 7));
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find("key1000", 7));
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find(1));
+    EXPECT_STREQ("key5", index.get<IndexRow>("key5")->name);
+}
+
+TEST(TestIndex, CustomKey) {
+    vector<IndexRow> rows = make_rows(100);
+    tp::HashIndex index;
+    EXPECT_FALSE(index.build(&rows[0], rows.size(), index_desc, 3));
+    EXPECT_FALSE(index.ok());
+
+    tp::IndexKeyOps ops = {pair_hash, pair_equal};
+    ASSERT_TRUE(index.build(&rows[0], rows.size(), index_desc, 3, &ops));
+    int key[2] = {42 % 7, 42};
+    EXPECT_EQ(42u, index.find_key(key));
+    key[0] = 1;
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find_key(key));
+}
+
+TEST(TestIndex, DuplicateKeepsFirst) {
+    vector<IndexRow> rows = make_rows(300000);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i].id = static_cast<int>(i % 1000);
+    }
+
+    for (unsigned threads = 1; threads <= 4; ++threads) {
+        tp::HashIndex index;
+        ASSERT_TRUE(
+            index.build(&rows[0], rows.size(), index_desc, 0, nullptr, threads));
+        for (int id = 0; id < 1000; ++id) {
+            EXPECT_EQ(static_cast<size_t>(id), index.find(id));
+        }
+    }
+}
+
+TEST(TestIndex, ParsedTable) {
+    struct Entry {
+        char word[8];
+        int freq;
+    };
+    tp::ColumnDescriptor desc[] = {
+        {tp::KSTRING, false, 0, sizeof(((Entry*)0)->word),
+         offsetof(Entry, word), 0, nullptr, nullptr},
+        {tp::KINT, false, 0, sizeof(int), offsetof(Entry, freq), 0, nullptr,
+         nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+    vector<Entry> entries;
+    vector<string> errors;
+    tp::parse_all("apple\t3\npear\t5\nplum\t7\n", desc, entries, errors);
+    ASSERT_EQ(3u, entries.size());
+
+    tp::HashIndex index;
+    ASSERT_TRUE(index.build(&entries[0], entries.size(), desc, 0));
+    EXPECT_EQ(5, index.get<Entry>("pear")->freq);
+    EXPECT_TRUE(index.get<Entry>("fig") == nullptr);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
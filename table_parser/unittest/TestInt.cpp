@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <climits>
+#include <cstring>
+
+#include "../src/table_parser.cpp"
+
+#define GENERATE_LEGAL_TEST(NAME, TEXT, VALUE)                          \
+    TEST(TestInt, NAME) {                                               \
+        int i;                                                          \
+        ASSERT_TRUE(tp::parse_int_callback(TEXT, strlen(TEXT), &i,      \
+                                           sizeof(int), NULL));         \
+        EXPECT_EQ(VALUE, i);                                            \
+    }
+
+GENERATE_LEGAL_TEST(TestZero, "0", 0)
+GENERATE_LEGAL_TEST(TestPositive, "+47", 47)
+GENERATE_LEGAL_TEST(TestNegative, "-12345", -12345)
+GENERATE_LEGAL_TEST(TestEightDigits, "12345678", 12345678)
+GENERATE_LEGAL_TEST(TestNineDigits, "123456789", 123456789)
+GENERATE_LEGAL_TEST(TestLeadingZero, "000000000000000000000042", 42)
+GENERATE_LEGAL_TEST(TestMax, "2147483647", INT_MAX)
+GENERATE_LEGAL_TEST(TestMin, "-2147483648", INT_MIN)
+
+#define GENERATE_ILLEGAL_TEST(NAME, TEXT)                               \
+    TEST(TestInt, NAME) {                                               \
+        int i;                                                          \
+        ASSERT_FALSE(tp::parse_int_callback(TEXT, strlen(TEXT), &i,     \
+                                            sizeof(int), NULL));        \
+    }
+
+GENERATE_ILLEGAL_TEST(TestEmpty, "")
+GENERATE_ILLEGAL_TEST(TestSignOnly, "-")
+GENERATE_ILLEGAL_TEST(TestJunk, "12a4")
+GENERATE_ILLEGAL_TEST(TestJunkInBlock, "1234567x9")
+GENERATE_ILLEGAL_TEST(TestOverflow, "2147483648")
+GENERATE_ILLEGAL_TEST(TestUnderflow, "-2147483649")
+GENERATE_ILLEGAL_TEST(TestDemoOverflow, "+100011111111111")
+GENERATE_ILLEGAL_TEST(TestHugeOverflow, "99999999999999999999999")
+GENERATE_ILLEGAL_TEST(TestUint64Overflow, "18446744073709551616")
+
+TEST(TestInt, TestSizeMismatch) {
+    long long l;
+    ASSERT_FALSE(tp::parse_int_callback("1", 1, &l, sizeof(l), NULL));
+}
+
+TEST(TestInt, TestDigitsLimit) {
+    uint64_t v;
+    ASSERT_TRUE(tp::parse_digits("18446744073709551615", 20, UINT64_MAX, &v));
+    EXPECT_EQ(UINT64_MAX, v);
+    ASSERT_FALSE(tp::parse_digits("18446744073709551616", 20, UINT64_MAX, &v));
+    ASSERT_FALSE(tp::parse_digits("100", 3, 99, &v));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
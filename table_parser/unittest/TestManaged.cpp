@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include "managed_table.h"
+
+using namespace std;
+
+struct ManagedRow {
+    int id;
+    int value;
+};
+
+static tp::ColumnDescriptor managed_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(ManagedRow, id), 0, nullptr,
+     nullptr},
+    {tp::KINT, false, 0, sizeof(int), offsetof(ManagedRow, value), 0, nullptr,
+     nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+class TestManaged : public ::testing::Test {
+   protected:
+    virtual void SetUp() {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "managed_test_%ld.txt", (long)getpid());
+        _path = buf;
+    }
+
+    virtual void TearDown() { unlink(_path.c_str()); }
+
+    // 先写临时文件再rename, 与线上发布词表的方式一致
+    void publish(int rows, int value, int bad_rows = 0) {
+        string tmp = _path + ".tmp";
+        {
+            ofstream out(tmp.c_str(), ios::trunc);
+            for (int i = 0; i < rows; ++i) {
+                out << i << '\t' << value << '\n';
+            }
+            for (int i = 0; i < bad_rows; ++i) {
+                out << "bad\tline\n";
+            }
+        }
+        rename(tmp.c_str(), _path.c_str());
+    }
+
+    string _path;
+};
+
+TEST_F(TestManaged, ReloadOnChange) {
+    publish(3, 10);
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc);
+    EXPECT_EQ(0u, table.generation());
+    {
+        tp::ManagedTable<ManagedRow>::ReadGuard guard(table);
+        EXPECT_TRUE(guard.rows().empty());
+    }
+
+    EXPECT_TRUE(table.reload());
+    EXPECT_EQ(1u, table.generation());
+    EXPECT_FALSE(table.reload());
+
+    tp::ManagedTable<ManagedRow>::ReadGuard old_guard(table);
+    publish(4, 20);
+    EXPECT_TRUE(table.reload());
+    EXPECT_EQ(2u, table.generation());
+
+    // 旧读者看到的版本不受影响
+    ASSERT_EQ(3u, old_guard.rows().size());
+    EXPECT_EQ(10, old_guard.rows()[2].value);
+    EXPECT_EQ(1u, old_guard.generation());
+
+    tp::ManagedTable<ManagedRow>::ReadGuard guard(table);
+    ASSERT_EQ(4u, guard.rows().size());
+    EXPECT_EQ(20, guard.rows()[3].value);
+}
+
+TEST_F(TestManaged, RejectHighErrorRate) {
+    publish(10, 1);
+    tp::ReloadOptions options;
+    options.max_error_rate = 0.2;
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc, options);
+    ASSERT_TRUE(table.reload());
+
+    publish(10, 2, 2);
+    EXPECT_TRUE(table.reload());
+    EXPECT_EQ(2u, table.last_errors().size());
+
+    publish(10, 3, 5);
+    EXPECT_FALSE(table.reload());
+    ASSERT_FALSE(table.last_errors().empty());
+    EXPECT_EQ(0u, table.last_errors()[0].find("error rate too high"));
+
+    tp::ManagedTable<ManagedRow>::ReadGuard guard(table);
+    EXPECT_EQ(2u, guard.generation());
+    EXPECT_EQ(2, guard.rows()[0].value);
+}
+
+static atomic<int> counted_parses(0);
+
+static bool parse_counted(const char* s, size_t len, void* data, size_t size,
+                          void* context) {
+    static_cast<void>(context);
+    ++counted_parses;
+    if (size != sizeof(int)) {
+        return false;
+    }
+    *static_cast<int*>(data) = atoi(string(s, len).c_str());
+    return true;
+}
+
+TEST_F(TestManaged, RejectedFileNotReparsed) {
+    tp::ColumnDescriptor desc[] = {
+        {tp::KINT, false, 0, sizeof(int), offsetof(ManagedRow, id), 0, nullptr,
+         nullptr},
+        {tp::KCLASS, false, 0, sizeof(int), offsetof(ManagedRow, value), 0,
+         parse_counted, nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+    publish(10, 1, 5);
+    tp::ReloadOptions options;
+    options.poll_interval_ms = 2;
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), desc, options);
+    counted_parses = 0;
+    table.start();
+    for (int i = 0; i < 400 && table.last_errors().empty(); ++i) {
+        usleep(5000);
+    }
+    // 多个检查周期内文件不变, 只解析一次
+    usleep(50000);
+    table.stop();
+    EXPECT_EQ(10, counted_parses.load());
+    EXPECT_EQ(0u, table.generation());
+    ASSERT_FALSE(table.last_errors().empty());
+    EXPECT_EQ(0u, table.last_errors()[0].find("error rate too high"));
+
+    EXPECT_FALSE(table.reload());
+    EXPECT_EQ(10, counted_parses.load());
+    EXPECT_FALSE(table.reload(true));
+    EXPECT_EQ(20, counted_parses.load());
+
+    // 文件变化后重新解析
+    publish(12, 2);
+    EXPECT_TRUE(table.reload());
+    EXPECT_EQ(32, counted_parses.load());
+    EXPECT_EQ(1u, table.generation());
+}
+
+TEST_F(TestManaged, ReadFailureAborts) {
+    publish(10, 1);
+    tp::ReloadOptions options;
+    options.max_error_rate = 1.0;
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc, options);
+    ASSERT_TRUE(table.reload());
+
+    // 目录可以打开但读取失败, 截断的数据不能替换旧版本
+    string dir = _path + ".dir";
+    ASSERT_EQ(0, mkdir(dir.c_str(), 0755));
+    tp::ManagedTable<ManagedRow> broken(dir.c_str(), managed_desc, options);
+    EXPECT_FALSE(broken.reload());
+    ASSERT_EQ(1u, broken.last_errors().size());
+    EXPECT_NE(string::npos, broken.last_errors()[0].find("read"));
+    EXPECT_EQ(0u, broken.generation());
+    rmdir(dir.c_str());
+
+    tp::ManagedTable<ManagedRow>::ReadGuard guard(table);
+    EXPECT_EQ(1u, guard.generation());
+}
+
+TEST(TestEpoch, OverflowDoesNotBlock) {
+    tp::EpochManager epoch(2);
+    size_t a = epoch.enter();
+    size_t b = epoch.enter();
+    EXPECT_NE(a, b);
+    EXPECT_NE(tp::EpochManager::KOVERFLOW_SLOT, b);
+
+    // 槽位已满时立即返回, 期间不允许释放任何旧数据
+    size_t c = epoch.enter();
+    EXPECT_EQ(tp::EpochManager::KOVERFLOW_SLOT, c);
+    uint64_t retired = epoch.advance();
+    EXPECT_EQ(0u, epoch.safe_epoch());
+
+    epoch.leave(c);
+    EXPECT_EQ(retired, epoch.safe_epoch());
+    epoch.leave(a);
+    epoch.leave(b);
+    EXPECT_GT(epoch.safe_epoch(), retired);
+}
+
+TEST_F(TestManaged, MoreReadersThanSlots) {
+    publish(4, 1);
+    tp::ReloadOptions options;
+    options.reader_slots = 1;
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc, options);
+    ASSERT_TRUE(table.reload());
+
+    tp::ManagedTable<ManagedRow>::ReadGuard first(table);
+    tp::ManagedTable<ManagedRow>::ReadGuard second(table);
+    publish(5, 2);
+    ASSERT_TRUE(table.reload(true));
+    tp::ManagedTable<ManagedRow>::ReadGuard third(table);
+
+    EXPECT_EQ(4u, first.rows().size());
+    EXPECT_EQ(4u, second.rows().size());
+    EXPECT_EQ(5u, third.rows().size());
+}
+
+TEST_F(TestManaged, KeyIndex) {
+    publish(100, 5);
+    tp::ReloadOptions options;
+    options.key_column = 0;
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc, options);
+    ASSERT_TRUE(table.reload());
+
+    tp::ManagedTable<ManagedRow>::ReadGuard guard(table);
+    const ManagedRow* row = guard.index().get<ManagedRow>(42);
+    ASSERT_TRUE(row != nullptr);
+    EXPECT_EQ(42, row->id);
+}
+
+TEST_F(TestManaged, BackgroundWatch) {
+    publish(2, 1);
+    tp::ReloadOptions options;
+    options.poll_interval_ms = 5;
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc, options);
+    table.start();
+
+    for (int i = 0; i < 400 && table.generation() < 1; ++i) {
+        usleep(5000);
+    }
+    ASSERT_EQ(1u, table.generation());
+
+    publish(3, 2);
+    for (int i = 0; i < 400 && table.generation() < 2; ++i) {
+        usleep(5000);
+    }
+    table.stop();
+    EXPECT_EQ(2u, table.generation());
+}
+
+TEST_F(TestManaged, ConcurrentReaders) {
+    publish(64, 0);
+    tp::ManagedTable<ManagedRow> table(_path.c_str(), managed_desc);
+    ASSERT_TRUE(table.reload());
+
+    atomic<bool> done(false);
+    atomic<int> mismatches(0);
+    vector<thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.push_back(thread([&] {
+            while (!done.load()) {
+                tp::ManagedTable<ManagedRow>::ReadGuard guard(table);
+                const vector<ManagedRow>& rows = guard.rows();
+                // 同一版本中所有行的value相同
+                for (size_t i = 1; i < rows.size(); ++i) {
+                    if (rows[i].value != rows[0].value) {
+                        ++mismatches;
+                    }
+                }
+            }
+        }));
+    }
+
+    for (int v = 1; v <= 20; ++v) {
+        publish(64, v);
+        EXPECT_TRUE(table.reload(true));
+    }
+    done = true;
+    for (size_t i = 0; i < readers.size(); ++i) {
+        readers[i].join();
+    }
+    EXPECT_EQ(0, mismatches.load());
+    EXPECT_EQ(21u, table.generation());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+
+#include "parallel_parser.h"
+
+using namespace std;
+
+struct parallel_data {
+    int a;
+    char b[16];
+};
+
+tp::ColumnDescriptor parallel_data_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(parallel_data, a), 0, nullptr,
+     nullptr},
+    {tp::KSTRING, false, 0, sizeof(parallel_data::b),
+     offsetof(parallel_data, b), 0, nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+// 生成含有错误行的输入, 每7行有一行错误
+static string MakeInput(unsigned rows) {
+    string ret;
+    char line[64];
+    for (unsigned i = 0; i < rows; ++i) {
+        if (i % 7 == 3) {
+            snprintf(line, sizeof(line), "bad%u\trow\n", i);
+        } else {
+            snprintf(line, sizeof(line), "%u\trow%u\n", i, i);
+        }
+        ret += line;
+    }
+    return ret;
+}
+
+TEST(TestParallel, SplitChunksAtNewline) {
+    string input = MakeInput(1000);
+    vector<tp::TextChunk> chunks;
+    tp::split_chunks(input.c_str(), input.size(), 8, 100, 3, chunks);
+
+    ASSERT_EQ(8u, chunks.size());
+    EXPECT_EQ(input.c_str(), chunks[0].begin);
+    EXPECT_EQ(1u, chunks[0].first_line);
+    size_t rows = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        EXPECT_EQ('\n', chunks[i].end[-1]);
+        if (i > 0) {
+            EXPECT_EQ(chunks[i - 1].end, chunks[i].begin);
+            EXPECT_EQ(chunks[i - 1].first_line + chunks[i - 1].max_rows,
+                      chunks[i].first_line);
+        }
+        rows += chunks[i].max_rows;
+    }
+    EXPECT_EQ(1000u, rows);
+    EXPECT_EQ(input.c_str() + input.size(), chunks.back().end);
+}
+
+TEST(TestParallel, SplitEmptyInput) {
+    vector<tp::TextChunk> chunks;
+    tp::split_chunks("", 0, 8, 100, 2, chunks);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_EQ(chunks[0].begin, chunks[0].end);
+    EXPECT_EQ(0u, chunks[0].max_rows);
+}
+
+TEST(TestParallel, LastLineWithoutNewline) {
+    vector<tp::TextChunk> chunks;
+    tp::split_chunks("1\ta\n2\tb", 7, 8, 100, 2, chunks);
+    ASSERT_EQ(1u, chunks.size());
+    EXPECT_EQ(2u, chunks[0].max_rows);
+}
+
+TEST(TestParallel, SameAsSequential) {
+    string input = MakeInput(100000);
+    // 去掉最后的换行符, 覆盖无换行结尾的情况
+    input.erase(input.size() - 1);
+
+    vector<parallel_data> expect;
+    vector<string> expect_err;
+    unsigned expect_count =
+        tp::parse_all(input.c_str(), parallel_data_desc, expect, expect_err);
+
+    for (unsigned threads = 1; threads <= 8; threads *= 2) {
+        // 已有的输出保留在前面
+        vector<parallel_data> results(1);
+        results[0].a = -1;
+        vector<string> errors;
+        unsigned count =
+            tp::parse_all_parallel(input.c_str(), input.size(),
+                                   parallel_data_desc, results, errors, threads);
+        ASSERT_FALSE(results.empty());
+        EXPECT_EQ(-1, results[0].a);
+        results.erase(results.begin());
+
+        EXPECT_EQ(expect_count, count);
+        ASSERT_EQ(expect.size(), results.size());
+        for (size_t i = 0; i < expect.size(); ++i) {
+            EXPECT_EQ(expect[i].a, results[i].a);
+            EXPECT_STREQ(expect[i].b, results[i].b);
+        }
+        EXPECT_EQ(expect_err, errors);
+    }
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
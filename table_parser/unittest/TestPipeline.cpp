@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "pipelined_input.h"
+#include "table_parser.h"
+
+using namespace std;
+
+struct pipe_data {
+    int id;
+    unsigned count_v;
+    float v[8];
+    char name[128];
+};
+
+static tp::ColumnDescriptor pipe_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(pipe_data, id), 0, nullptr,
+     nullptr},
+    {tp::KFLOAT, true, 8, sizeof(float), offsetof(pipe_data, v),
+     offsetof(pipe_data, count_v), nullptr, nullptr},
+    {tp::KSTRING, false, 0, sizeof(pipe_data::name), offsetof(pipe_data, name),
+     0, nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static string MakeText(int rows) {
+    string text;
+    for (int i = 0; i < rows; ++i) {
+        if (i % 17 == 5) {
+            text += "bad\t1:1\tx\n";
+            continue;
+        }
+        text += to_string(i) + "\t3:" + to_string(i) + ".5,1,-2\t";
+        // 偶尔出现比块长的行
+        text += string(i % 23 == 0 ? 100 : 5, static_cast<char>('a' + i % 26));
+        text += '\n';
+    }
+    text += "9999\t0:\tlast";
+    return text;
+}
+
+static string Gzip(const string& text) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    EXPECT_EQ(Z_OK, deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                                 15 + 16, 8, Z_DEFAULT_STRATEGY));
+    string out(deflateBound(&zs, static_cast<uLong>(text.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    zs.avail_in = static_cast<uInt>(text.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    EXPECT_EQ(Z_STREAM_END, deflate(&zs, Z_FINISH));
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+static string ReadAll(tp::InputStream& in, size_t chunk, long* last) {
+    string out;
+    vector<char> buf(chunk);
+    while ((*last = in.read(&buf[0], buf.size())) > 0) {
+        out.append(&buf[0], static_cast<size_t>(*last));
+    }
+    return out;
+}
+
+static void ExpectSame(const vector<pipe_data>& expect,
+                       const vector<pipe_data>& actual) {
+    ASSERT_EQ(expect.size(), actual.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        ASSERT_EQ(expect[i].id, actual[i].id);
+        ASSERT_EQ(expect[i].count_v, actual[i].count_v);
+        for (unsigned j = 0; j < expect[i].count_v; ++j) {
+            EXPECT_EQ(expect[i].v[j], actual[i].v[j]);
+        }
+        EXPECT_STREQ(expect[i].name, actual[i].name);
+    }
+}
+
+static void ExpectSame(const vector<tp::ParseError>& expect,
+                       const vector<tp::ParseError>& actual) {
+    ASSERT_EQ(expect.size(), actual.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        EXPECT_EQ(expect[i].code, actual[i].code);
+        EXPECT_EQ(expect[i].line, actual[i].line);
+        EXPECT_EQ(expect[i].column, actual[i].column);
+        EXPECT_EQ(expect[i].offset, actual[i].offset);
+    }
+}
+
+// 读取指定字节数后报错的输入流
+class FailingStream : public tp::InputStream {
+   public:
+    FailingStream(const string& data, size_t fail_at)
+        : _data(data), _pos(0), _fail_at(fail_at) {}
+
+    virtual long read(char* buf, size_t len) {
+        if (_pos >= _fail_at) return -1;
+        size_t n = min(len, _fail_at - _pos);
+        memcpy(buf, _data.data() + _pos, n);
+        _pos += n;
+        return static_cast<long>(n);
+    }
+
+   private:
+    string _data;
+    size_t _pos;
+    size_t _fail_at;
+};
+
+TEST(TestPipeline, GzipRoundTrip) {
+    string text = MakeText(500);
+    // 多个gzip成员首尾相接
+    string gz = Gzip(text) + Gzip(text);
+
+    for (size_t buffer_size = 1; buffer_size <= 4096; buffer_size *= 8) {
+        istringstream in(gz);
+        tp::IstreamInputStream stream(in);
+        tp::GzipInputStream gzip(&stream, buffer_size);
+        ASSERT_TRUE(gzip.ok());
+        long last = 0;
+        EXPECT_EQ(text + text, ReadAll(gzip, 100, &last));
+        EXPECT_EQ(0, last);
+    }
+}
+
+TEST(TestPipeline, GzipCorrupted) {
+    string gz = Gzip(MakeText(500));
+    long last = 0;
+
+    istringstream truncated(gz.substr(0, gz.size() / 2));
+    tp::IstreamInputStream truncated_stream(truncated);
+    tp::GzipInputStream gzip1(&truncated_stream);
+    ReadAll(gzip1, 100, &last);
+    EXPECT_LT(last, 0);
+
+    string bad = gz;
+    bad[bad.size() / 2] = static_cast<char>(bad[bad.size() / 2] ^ 0x55);
+    bad[bad.size() / 2 + 1] = static_cast<char>(bad[bad.size() / 2 + 1] ^ 0x55);
+    istringstream corrupted(bad);
+    tp::IstreamInputStream corrupted_stream(corrupted);
+    tp::GzipInputStream gzip2(&corrupted_stream);
+    ReadAll(gzip2, 100, &last);
+    EXPECT_LT(last, 0);
+}
+
+TEST(TestPipeline, BlocksAreLineAligned) {
+    string text = MakeText(300);
+    istringstream in(text);
+    tp::IstreamInputStream stream(in);
+    tp::BlockPipeline pipeline(&stream, 64, 3);
+
+    string joined;
+    unsigned line = 1;
+    size_t seq = 0;
+    const tp::TextBlock* block = nullptr;
+    while ((block = pipeline.acquire()) != nullptr) {
+        EXPECT_EQ(seq++, block->seq);
+        EXPECT_EQ(joined.size(), block->offset);
+        EXPECT_EQ(line, block->first_line);
+        EXPECT_EQ('\0', block->data[block->size]);
+        string data(&block->data[0], block->size);
+        // 除最后一块外都在换行符之后结束
+        if (joined.size() + data.size() < text.size()) {
+            EXPECT_EQ('\n', data[data.size() - 1]);
+        }
+        for (size_t i = 0; i < data.size(); ++i) line += data[i] == '\n';
+        joined += data;
+        pipeline.release(block);
+    }
+    EXPECT_EQ(text, joined);
+    EXPECT_FALSE(pipeline.failed());
+    EXPECT_EQ(text.size(), pipeline.total_bytes());
+    EXPECT_EQ(line, pipeline.next_line());
+}
+
+TEST(TestPipeline, SameAsParseAll) {
+    string text = MakeText(2000);
+    vector<pipe_data> expect;
+    vector<tp::ParseError> expect_err;
+    unsigned expect_count =
+        tp::parse_all(text.c_str(), pipe_desc, expect, expect_err);
+
+    string gz = Gzip(text);
+    for (unsigned threads = 1; threads <= 4; ++threads) {
+        for (size_t block_size = 16; block_size <= 16384; block_size *= 4) {
+            istringstream in(gz);
+            tp::IstreamInputStream stream(in);
+            tp::GzipInputStream gzip(&stream, 256);
+            vector<pipe_data> out;
+            vector<tp::ParseError> err;
+            EXPECT_EQ(expect_count,
+                      tp::parse_all_pipelined(gzip, pipe_desc, out, err,
+                                              threads, block_size));
+            ExpectSame(expect, out);
+            ExpectSame(expect_err, err);
+        }
+    }
+}
+
+TEST(TestPipeline, StreamingOverPipelinedInput) {
+    string text = MakeText(1000);
+    vector<pipe_data> expect;
+    vector<tp::ParseError> expect_err;
+    tp::parse_all(text.c_str(), pipe_desc, expect, expect_err);
+
+    istringstream in(Gzip(text));
+    tp::IstreamInputStream stream(in);
+    tp::GzipInputStream gzip(&stream);
+    tp::PipelinedInputStream pipelined(&gzip, 1000, 2);
+    vector<pipe_data> out;
+    vector<tp::ParseError> err;
+    tp::parse_all(pipelined, pipe_desc, out, err);
+    ExpectSame(expect, out);
+    ExpectSame(expect_err, err);
+}
+
+TEST(TestPipeline, ReadFailure) {
+    string text = MakeText(100);
+    size_t fail_at = text.rfind('\n', text.size() / 2) + 1;
+    FailingStream stream(text, fail_at);
+
+    vector<pipe_data> out;
+    vector<tp::ParseError> err;
+    tp::parse_all_pipelined(stream, pipe_desc, out, err, 2, 128);
+    ASSERT_FALSE(err.empty());
+    EXPECT_EQ(tp::KERR_READ_FAILED, err.back().code);
+    EXPECT_EQ(fail_at, err.back().offset);
+
+    unsigned lines = 1;
+    for (size_t i = 0; i < fail_at; ++i) lines += text[i] == '\n';
+    EXPECT_EQ(lines, err.back().line);
+}
+
+struct pipe_view {
+    int id;
+    tp::StringRef name;
+};
+
+TEST(TestPipeline, StringViewRejected) {
+    // 块在解析后即被复用, 字符串引用会指向被覆盖的数据
+    tp::ColumnDescriptor desc[] = {
+        {tp::KINT, false, 0, sizeof(int), offsetof(pipe_view, id), 0, nullptr,
+         nullptr},
+        {tp::KSTRING_VIEW, false, 0, sizeof(tp::StringRef),
+         offsetof(pipe_view, name), 0, nullptr, nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+    string text;
+    for (int i = 0; i < 20000; ++i) {
+        text += to_string(i) + "\tname" + to_string(i) + "\n";
+    }
+    istringstream in(text);
+    tp::IstreamInputStream stream(in);
+    vector<pipe_view> out;
+    vector<tp::ParseError> err;
+    EXPECT_EQ(0u, tp::parse_all_pipelined(stream, desc, out, err, 4, 1024));
+    EXPECT_TRUE(out.empty());
+    ASSERT_EQ(1u, err.size());
+    EXPECT_EQ(tp::KERR_STRING_VIEW_IN_STREAM, err[0].code);
+    EXPECT_EQ(1u, err[0].line);
+    // 不读取输入
+    EXPECT_EQ(0, static_cast<int>(in.tellg()));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
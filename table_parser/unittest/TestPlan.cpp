@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+
+#include "table_parser.h"
+
+using namespace std;
+
+struct plan_data {
+    int a;
+    unsigned count_b;
+    int b[3];
+    char c[8];
+};
+
+tp::ColumnDescriptor plan_data_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(plan_data, a), 0, nullptr,
+     nullptr},
+    {tp::KINT, true, 3, sizeof(int), offsetof(plan_data, b),
+     offsetof(plan_data, count_b), nullptr, nullptr},
+    {tp::KSTRING, false, 0, sizeof(plan_data::c), offsetof(plan_data, c), 0,
+     nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+TEST(TestPlan, ValidPlan) {
+    tp::ParsePlan plan(plan_data_desc, sizeof(plan_data));
+    EXPECT_TRUE(plan.ok());
+    EXPECT_EQ(3u, plan.column_count());
+    EXPECT_EQ(sizeof(plan_data), plan.row_size());
+    for (size_t i = 0; i < plan.column_count(); ++i) {
+        EXPECT_NE(nullptr, plan.column(i).callback);
+    }
+}
+
+TEST(TestPlan, RejectOutOfBoundary) {
+    tp::ParsePlan plan(plan_data_desc, offsetof(plan_data, c) + 4);
+    EXPECT_FALSE(plan.ok());
+    EXPECT_EQ(tp::KPLAN_OUT_OF_BOUNDARY, plan.error());
+    EXPECT_EQ(2u, plan.error_column());
+}
+
+TEST(TestPlan, RejectMissingCallback) {
+    tp::ColumnDescriptor desc[] = {
+        {tp::KCLASS, false, 0, sizeof(int), 0, 0, nullptr, nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+    tp::ParsePlan plan(desc, sizeof(int));
+    EXPECT_EQ(tp::KPLAN_CALLBACK_REQUIRED, plan.error());
+
+    tp::ColumnDescriptor enum_desc[] = {
+        {tp::KENUM, false, 0, sizeof(int), 0, 0, nullptr, nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+    tp::ParsePlan enum_plan(enum_desc, sizeof(int));
+    EXPECT_EQ(tp::KPLAN_CONTEXT_REQUIRED, enum_plan.error());
+
+    tp::ColumnDescriptor bad_desc[] = {
+        {static_cast<tp::DataType>(15), false, 0, sizeof(int), 0, 0, nullptr,
+         nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+    tp::ParsePlan bad_plan(bad_desc, sizeof(int));
+    EXPECT_EQ(tp::KPLAN_UNKNOWN_TYPE, bad_plan.error());
+}
+
+TEST(TestPlan, InvalidPlanFailsEveryRow) {
+    tp::ParsePlan plan(plan_data_desc, sizeof(int));
+    tp::TableParser parser("1\t0:\tx\n2\t0:\ty\n", plan);
+
+    plan_data data;
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_STREQ("[ERROR] line 1: element 1 memory out of boundary.",
+                 parser.last_error());
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KEOF, parser.parse(&data, sizeof(data)));
+}
+
+TEST(TestPlan, CounterDoesNotClobberNeighbour) {
+    tp::ParsePlan plan(plan_data_desc, sizeof(plan_data));
+    tp::TableParser parser("7\t0:\tx\n", plan);
+
+    plan_data data;
+    memset(&data, 0x5a, sizeof(data));
+    ASSERT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(7, data.a);
+    EXPECT_EQ(0u, data.count_b);
+    EXPECT_EQ(0x5a5a5a5a, data.b[0]);
+    EXPECT_STREQ("x", data.c);
+}
+
+TEST(TestPlan, SharedAcrossThreads) {
+    tp::ParsePlan plan(plan_data_desc, sizeof(plan_data));
+    ASSERT_TRUE(plan.ok());
+
+    string input;
+    for (int i = 0; i < 1000; ++i) {
+        input += to_string(i) + "\t2:1,2\trow\n";
+    }
+
+    vector<unsigned> counts(4, 0);
+    vector<thread> workers;
+    for (size_t t = 0; t < counts.size(); ++t) {
+        workers.push_back(thread([&, t]() {
+            tp::TableParser parser(input.c_str(), plan);
+            vector<plan_data> results;
+            vector<string> errors;
+            counts[t] = tp::parse_all(parser, results, errors);
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+
+    for (size_t t = 0; t < counts.size(); ++t) {
+        EXPECT_EQ(1000u, counts[t]);
+    }
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "structural_scanner.h"
+
+using namespace std;
+
+static const char* ScalarFieldEnd(const char* s) {
+    while (!(*s == '\0' || *s == '\t' || *s == '\n')) ++s;
+    return s;
+}
+
+static const char* ScalarElementEnd(const char* s) {
+    while (!(*s == '\0' || *s == ',' || *s == '\t' || *s == '\n')) ++s;
+    return s;
+}
+
+static const char* ScalarArrayCommas(const char* s, vector<const char*>& commas) {
+    commas.clear();
+    for (; !(*s == '\0' || *s == '\t' || *s == '\n'); ++s) {
+        if (*s == ',') commas.push_back(s);
+    }
+    return s;
+}
+
+class TestScanner : public testing::TestWithParam<tp::ScannerIsa> {
+   protected:
+    virtual void SetUp() {
+        _saved = tp::scanner_isa();
+        if (!tp::set_scanner_isa(GetParam())) {
+            _supported = false;
+        } else {
+            _supported = true;
+        }
+    }
+
+    virtual void TearDown() { tp::set_scanner_isa(_saved); }
+
+    bool _supported;
+    tp::ScannerIsa _saved;
+};
+
+TEST_P(TestScanner, Simple) {
+    if (!_supported) return;
+
+    const char* s = "abc,def\tghi\njkl";
+    EXPECT_EQ(s + 7, tp::find_field_end(s));
+    EXPECT_EQ(s + 3, tp::find_element_end(s));
+    EXPECT_EQ(s + 11, tp::find_field_end(s + 8));
+    EXPECT_EQ(s + 15, tp::find_field_end(s + 12));
+    EXPECT_EQ(s + 15, tp::find_element_end(s + 15));
+}
+
+TEST_P(TestScanner, ArrayCommas) {
+    if (!_supported) return;
+
+    const char* s = "1,22,333\t4,5";
+    const char* commas[4];
+    size_t count = 0;
+    EXPECT_EQ(s + 8, tp::find_array_commas(s, commas, 4, &count));
+    ASSERT_EQ(2u, count);
+    EXPECT_EQ(s + 1, commas[0]);
+    EXPECT_EQ(s + 4, commas[1]);
+
+    // 超过max的逗号只计数
+    EXPECT_EQ(s + 8, tp::find_array_commas(s, commas, 1, &count));
+    EXPECT_EQ(2u, count);
+    EXPECT_EQ(s + 1, commas[0]);
+}
+
+TEST_P(TestScanner, MatchScalarAtEveryOffset) {
+    if (!_supported) return;
+
+    static const char alphabet[] = "abc01,\t\n";
+    srand(42);
+    for (int round = 0; round < 200; ++round) {
+        string input;
+        size_t len = static_cast<size_t>(rand() % 200);
+        for (size_t i = 0; i < len; ++i) {
+            // 分隔符较为稀疏, 以覆盖跨块的情况
+            if (rand() % 16 == 0) {
+                input += alphabet[5 + rand() % 3];
+            } else {
+                input += alphabet[rand() % 5];
+            }
+        }
+
+        const char* s = input.c_str();
+        for (size_t i = 0; i <= input.size(); ++i) {
+            ASSERT_EQ(ScalarFieldEnd(s + i), tp::find_field_end(s + i));
+            ASSERT_EQ(ScalarElementEnd(s + i), tp::find_element_end(s + i));
+
+            vector<const char*> expected;
+            const char* end = ScalarArrayCommas(s + i, expected);
+            vector<const char*> commas(expected.size() + 1);
+            size_t count = 0;
+            ASSERT_EQ(end, tp::find_array_commas(s + i, &commas[0],
+                                                 commas.size(), &count));
+            ASSERT_EQ(expected.size(), count);
+            commas.resize(count);
+            ASSERT_EQ(expected, commas);
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(AllIsa, TestScanner,
+                        testing::Values(tp::KSCALAR, tp::KSSE2, tp::KAVX2));
+
+TEST(TestScannerDispatch, ScalarAlwaysSupported) {
+    tp::ScannerIsa saved = tp::scanner_isa();
+    EXPECT_TRUE(tp::set_scanner_isa(tp::KSCALAR));
+    EXPECT_EQ(tp::KSCALAR, tp::scanner_isa());
+    EXPECT_TRUE(tp::set_scanner_isa(saved));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <cstring>
+
+#include "schema.h"
+
+using namespace std;
+
+struct sub_data {
+    bool a;
+};
+
+struct my_data {
+    unsigned count_a;
+    float a[5];
+    char b[32];
+    int c;
+    sub_data d;
+    int64_t e;
+};
+
+static bool ParseSubData(const char* s, size_t len, sub_data* out) {
+    return tp::parse_bool(s, len, &out->a);
+}
+
+typedef tp::Schema<my_data, TP_ARRAY_FIELD(my_data, count_a, a),
+                   TP_FIELD(my_data, b), TP_FIELD(my_data, c),
+                   TP_CUSTOM_FIELD(my_data, d, ParseSubData),
+                   TP_FIELD(my_data, e)>
+    my_schema;
+
+static bool ParseSubDataCallback(const char* s, size_t len, void* data,
+                                 size_t size, void* context) {
+    static_cast<void>(context);
+    if (size != sizeof(sub_data)) return false;
+    return ParseSubData(s, len, reinterpret_cast<sub_data*>(data));
+}
+
+tp::ColumnDescriptor my_data_desc[] = {
+    {tp::KFLOAT, true, 5, sizeof(float), offsetof(my_data, a),
+     offsetof(my_data, count_a), nullptr, nullptr},
+    {tp::KSTRING, false, 0, sizeof(my_data::b), offsetof(my_data, b), 0,
+     nullptr, nullptr},
+    {tp::KINT, false, 0, sizeof(int), offsetof(my_data, c), 0, nullptr,
+     nullptr},
+    {tp::KCLASS, false, 0, sizeof(sub_data), offsetof(my_data, d), 0,
+     ParseSubDataCallback, nullptr},
+    {tp::KINT64, false, 0, sizeof(int64_t), offsetof(my_data, e), 0, nullptr,
+     nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+TEST(TestSchema, HandleLegalInput) {
+    const char* input =
+        "3:-1.5,2.23,1\thello world!\t47\ttrue\t-5\n"
+        "2:3.1415927,2.7182818\tooooorz\t42\tfalse\t100011111111111\n";
+
+    vector<my_data> results;
+    vector<string> errors;
+    unsigned count = tp::parse_all<my_schema>(input, results, errors);
+
+    EXPECT_EQ(2u, count);
+    ASSERT_EQ(2u, results.size());
+    ASSERT_EQ(3u, results[0].count_a);
+    EXPECT_FLOAT_EQ(2.23f, results[0].a[1]);
+    EXPECT_STREQ("hello world!", results[0].b);
+    EXPECT_EQ(47, results[0].c);
+    EXPECT_TRUE(results[0].d.a);
+    EXPECT_EQ(-5, results[0].e);
+    ASSERT_EQ(2u, results[1].count_a);
+    EXPECT_FALSE(results[1].d.a);
+    EXPECT_EQ(100011111111111LL, results[1].e);
+    EXPECT_TRUE(errors.empty());
+}
+
+TEST(TestSchema, SameErrorsAsDescriptor) {
+    const char* input =
+        "3:1,2,3\tok\t1\ttrue\t1\n"
+        "x:1\tbad\t1\ttrue\t1\n"
+        "3;1,2,3\tbad\t1\ttrue\t1\n"
+        "9:1\tbad\t1\ttrue\t1\n"
+        "2:1\tbad\t1\ttrue\t1\n"
+        "2:1\n"
+        "1:1\tbad\tx\ttrue\t1\n"
+        "1:1\tbad\t1\tmaybe\t1\n"
+        "1:1\tbad\t1\ttrue\n"
+        "1:1\tbad\t1\ttrue\t1\textra\n"
+        "1:1\tlast\t1\ttrue\t1";
+
+    vector<my_data> schema_results;
+    vector<string> schema_errors;
+    unsigned schema_count =
+        tp::parse_all<my_schema>(input, schema_results, schema_errors);
+
+    vector<my_data> desc_results;
+    vector<string> desc_errors;
+    unsigned desc_count =
+        tp::parse_all(input, my_data_desc, desc_results, desc_errors);
+
+    EXPECT_EQ(2u, schema_count);
+    EXPECT_EQ(desc_count, schema_count);
+    EXPECT_EQ(desc_errors, schema_errors);
+
+    vector<tp::ParseError> schema_records;
+    vector<tp::ParseError> desc_records;
+    tp::parse_all<my_schema>(input, schema_results, schema_records);
+    tp::parse_all(input, my_data_desc, desc_results, desc_records);
+    ASSERT_EQ(desc_records.size(), schema_records.size());
+    for (size_t i = 0; i < desc_records.size(); ++i) {
+        EXPECT_EQ(desc_records[i].code, schema_records[i].code);
+        EXPECT_EQ(desc_records[i].line, schema_records[i].line);
+        EXPECT_EQ(desc_records[i].column, schema_records[i].column);
+        EXPECT_EQ(desc_records[i].offset, schema_records[i].offset);
+    }
+}
+
+TEST(TestSchema, LastError) {
+    tp::SchemaParser<my_schema> parser("1:1\tx\t1\ttrue\t1\t2\n");
+    EXPECT_STREQ("ok", parser.last_error());
+
+    my_data data;
+    EXPECT_EQ(tp::KERROR, parser.parse(data));
+    EXPECT_STREQ(
+        "[ERROR] line 1: more element found in input after element 5.",
+        parser.last_error());
+    EXPECT_EQ(tp::KEOF, parser.parse(data));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
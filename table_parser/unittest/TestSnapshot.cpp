@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include <fstream>
+#include <thread>
+
+#include "snapshot.h"
+
+using namespace std;
+
+struct SnapRow {
+    int id;
+    double score;
+    char name[16];
+};
+
+static tp::ColumnDescriptor snap_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(SnapRow, id), 0, nullptr,
+     nullptr},
+    {tp::KDOUBLE, false, 0, sizeof(double), offsetof(SnapRow, score), 0,
+     nullptr, nullptr},
+    {tp::KSTRING, false, 0, sizeof(((SnapRow*)0)->name),
+     offsetof(SnapRow, name), 0, nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+class TestSnapshot : public ::testing::Test {
+   protected:
+    virtual void SetUp() {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "snapshot_test_%ld", (long)getpid());
+        _source = string(buf) + ".txt";
+        _snapshot = string(buf) + ".snap";
+        write_source("1\t0.5\talpha\n2\t1.5\tbeta\n");
+    }
+
+    virtual void TearDown() {
+        unlink(_source.c_str());
+        unlink(_snapshot.c_str());
+    }
+
+    void write_source(const char* content) {
+        ofstream out(_source.c_str(), ios::trunc);
+        out << content;
+    }
+
+    string _source;
+    string _snapshot;
+};
+
+TEST_F(TestSnapshot, ParseThenMap) {
+    tp::Table<SnapRow> table;
+    vector<string> errors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               table, errors));
+    EXPECT_FALSE(table.mapped());
+    ASSERT_EQ(2u, table.size());
+    EXPECT_EQ(0, access(_snapshot.c_str(), F_OK));
+
+    tp::Table<SnapRow> mapped;
+    errors.clear();
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               mapped, errors));
+    EXPECT_TRUE(mapped.mapped());
+    EXPECT_TRUE(errors.empty());
+    ASSERT_EQ(2u, mapped.size());
+    EXPECT_EQ(2, mapped[1].id);
+    EXPECT_EQ(1.5, mapped[1].score);
+    EXPECT_STREQ("alpha", mapped[0].name);
+}
+
+TEST_F(TestSnapshot, StaleSource) {
+    tp::Table<SnapRow> table;
+    vector<string> errors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               table, errors));
+
+    write_source("1\t0.5\talpha\n2\t1.5\tbeta\n3\t2.5\tgamma\n");
+    tp::Table<SnapRow> reloaded;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               reloaded, errors));
+    EXPECT_FALSE(reloaded.mapped());
+    ASSERT_EQ(3u, reloaded.size());
+    EXPECT_STREQ("gamma", reloaded[2].name);
+
+    // 旧表仍然可用
+    EXPECT_EQ(2u, table.size());
+    EXPECT_STREQ("beta", table[1].name);
+}
+
+TEST_F(TestSnapshot, SchemaChange) {
+    tp::Table<SnapRow> table;
+    vector<string> errors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               table, errors));
+
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               table, errors, 2));
+    EXPECT_FALSE(table.mapped());
+
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               table, errors, 2));
+    EXPECT_TRUE(table.mapped());
+}
+
+TEST_F(TestSnapshot, CorruptSnapshot) {
+    uint64_t hash = tp::schema_hash(snap_desc, sizeof(SnapRow), 0);
+    tp::SourceStamp stamp;
+    ASSERT_TRUE(tp::stat_source(_source.c_str(), &stamp));
+
+    SnapRow rows[2];
+    memset(rows, 0, sizeof(rows));
+    ASSERT_TRUE(tp::write_snapshot(_snapshot.c_str(), hash, stamp, rows,
+                                   sizeof(SnapRow), 2));
+    ASSERT_EQ(0, truncate(_snapshot.c_str(), 64 + sizeof(SnapRow)));
+
+    tp::MappedSnapshot snapshot;
+    EXPECT_FALSE(snapshot.open(_snapshot.c_str(), hash, sizeof(SnapRow),
+                               &stamp));
+
+    tp::Table<SnapRow> table;
+    vector<string> errors;
+    EXPECT_FALSE(tp::load_table("no_such_file", _snapshot.c_str(), snap_desc,
+                                table, errors));
+}
+
+TEST_F(TestSnapshot, ErrorsNotSnapshotted) {
+    write_source("1\t0.5\talpha\nbad\t1.5\tbeta\n");
+    tp::Table<SnapRow> table;
+    vector<tp::ParseError> errors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               table, errors));
+    EXPECT_EQ(1u, table.size());
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ(2u, errors[0].line);
+    EXPECT_NE(0, access(_snapshot.c_str(), F_OK));
+
+    // 再次加载仍然报告错误行
+    tp::Table<SnapRow> again;
+    errors.clear();
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), snap_desc,
+                               again, errors));
+    EXPECT_FALSE(again.mapped());
+    EXPECT_EQ(1u, errors.size());
+}
+
+struct EnumRow {
+    int id;
+    int color;
+};
+
+TEST_F(TestSnapshot, EnumMappingChange) {
+    write_source("1\tred\n2\tblue\n");
+    static const tp::EnumItem old_items[] = {
+        {"red", 1}, {"blue", 2}, {nullptr, 0}};
+    static const tp::EnumItem new_items[] = {
+        {"red", 10}, {"blue", 20}, {nullptr, 0}};
+    tp::EnumTable old_colors(old_items);
+    tp::EnumTable new_colors(new_items);
+    tp::ColumnDescriptor desc[] = {
+        {tp::KINT, false, 0, sizeof(int), offsetof(EnumRow, id), 0, nullptr,
+         nullptr},
+        {tp::KENUM, false, 0, sizeof(int), offsetof(EnumRow, color), 0,
+         nullptr, &old_colors},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+    uint64_t old_hash = tp::schema_hash(desc, sizeof(EnumRow), 0);
+    desc[1].context = &new_colors;
+    EXPECT_NE(old_hash, tp::schema_hash(desc, sizeof(EnumRow), 0));
+
+    desc[1].context = &old_colors;
+    tp::Table<EnumRow> table;
+    vector<string> errors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), desc,
+                               table, errors));
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), desc,
+                               table, errors));
+    EXPECT_TRUE(table.mapped());
+    EXPECT_EQ(2, table[1].color);
+
+    desc[1].context = &new_colors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), desc,
+                               table, errors));
+    EXPECT_FALSE(table.mapped());
+    EXPECT_EQ(20, table[1].color);
+    EXPECT_TRUE(errors.empty());
+}
+
+static bool parse_copy_int(const char* s, size_t len, void* data, size_t size,
+                           void* context) {
+    static_cast<void>(context);
+    if (size != sizeof(int)) {
+        return false;
+    }
+    *static_cast<int*>(data) = atoi(string(s, len).c_str());
+    return true;
+}
+
+TEST_F(TestSnapshot, ClassColumnNeedsUserVersion) {
+    tp::ColumnDescriptor desc[] = {
+        {tp::KCLASS, false, 0, sizeof(int), 0, 0, parse_copy_int, nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+    EXPECT_FALSE(tp::snapshot_supported(desc));
+    EXPECT_TRUE(tp::snapshot_supported(desc, 1));
+
+    write_source("7\n8\n");
+    tp::Table<int> table;
+    vector<string> errors;
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), desc,
+                               table, errors));
+    EXPECT_NE(0, access(_snapshot.c_str(), F_OK));
+
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), desc,
+                               table, errors, 1));
+    ASSERT_TRUE(tp::load_table(_source.c_str(), _snapshot.c_str(), desc,
+                               table, errors, 1));
+    EXPECT_TRUE(table.mapped());
+    EXPECT_EQ(8, table[1]);
+}
+
+TEST_F(TestSnapshot, ConcurrentWriters) {
+    // 同一进程内多个线程写同一快照, 结果总是其中一份完整的快照
+    static const size_t KWRITERS = 8;
+    static const size_t KROUNDS = 50;
+    tp::SourceStamp stamp;
+    ASSERT_TRUE(tp::stat_source(_source.c_str(), &stamp));
+    uint64_t hash = tp::schema_hash(snap_desc, sizeof(SnapRow), 0);
+
+    vector<vector<SnapRow> > rows(KWRITERS);
+    for (size_t i = 0; i < KWRITERS; ++i) {
+        rows[i].resize(1000 * (i + 1));
+        for (size_t j = 0; j < rows[i].size(); ++j) {
+            rows[i][j].id = static_cast<int>(i);
+            rows[i][j].score = static_cast<double>(j);
+            snprintf(rows[i][j].name, sizeof(rows[i][j].name), "w%zu", i);
+        }
+    }
+
+    vector<int> failures(KWRITERS, 0);
+    vector<thread> writers;
+    for (size_t i = 0; i < KWRITERS; ++i) {
+        writers.push_back(thread([&, i]() {
+            for (size_t k = 0; k < KROUNDS; ++k) {
+                if (!tp::write_snapshot(_snapshot.c_str(), hash, stamp,
+                                        &rows[i][0], sizeof(SnapRow),
+                                        rows[i].size())) {
+                    ++failures[i];
+                }
+            }
+        }));
+    }
+    for (size_t i = 0; i < writers.size(); ++i) {
+        writers[i].join();
+    }
+    for (size_t i = 0; i < KWRITERS; ++i) {
+        EXPECT_EQ(0, failures[i]);
+    }
+
+    tp::MappedSnapshot snap;
+    ASSERT_TRUE(snap.open(_snapshot.c_str(), hash, sizeof(SnapRow), &stamp));
+    const SnapRow* mapped = static_cast<const SnapRow*>(snap.rows());
+    ASSERT_GT(snap.row_count(), 0u);
+    size_t writer = static_cast<size_t>(mapped[0].id);
+    ASSERT_LT(writer, KWRITERS);
+    ASSERT_EQ(rows[writer].size(), snap.row_count());
+    EXPECT_EQ(0, memcmp(&rows[writer][0], mapped,
+                        sizeof(SnapRow) * snap.row_count()));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstring>
+
+#include <sstream>
+
+#include "pipelined_input.h"
+
+using namespace std;
+
+static int custom_calls = 0;
+
+static bool parse_blob(const char* s, size_t len, void* data, size_t size,
+                       void* context) {
+    static_cast<void>(s);
+    static_cast<void>(context);
+    ++custom_calls;
+    if (size != sizeof(int)) {
+        return false;
+    }
+    *static_cast<int*>(data) = static_cast<int>(len);
+    return true;
+}
+
+struct stats_data {
+    int id;
+    char name[16];
+    int blob;
+};
+
+static tp::ColumnDescriptor stats_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(stats_data, id), 0, nullptr,
+     nullptr},
+    {tp::KSTRING, false, 0, sizeof(((stats_data*)0)->name),
+     offsetof(stats_data, name), 0, nullptr, nullptr},
+    {tp::KCLASS, false, 0, sizeof(int), offsetof(stats_data, blob), 0,
+     parse_blob, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static const char* stats_input =
+    "1\talice\tx\n"
+    "2\tbob\tyy\n"
+    "bad\tcarol\tz\n"
+    "4\tlongername\tzzz\n";
+
+TEST(TestStats, Rows) {
+    tp::ParseStats stats;
+    tp::TableParser parser(stats_input, stats_desc);
+    parser.set_stats(&stats);
+    vector<stats_data> results;
+    vector<tp::ParseError> errors;
+    custom_calls = 0;
+    EXPECT_EQ(3u, tp::parse_all(parser, results, errors));
+    EXPECT_EQ(3, custom_calls);
+
+    if (!tp::stats_enabled()) {
+        // 未编译统计时不记录任何内容
+        EXPECT_EQ(0u, stats.rows);
+        EXPECT_EQ(0u, stats.bytes);
+        EXPECT_TRUE(stats.columns.empty());
+        EXPECT_EQ(0u, stats.types[tp::KCLASS].calls);
+        return;
+    }
+
+    EXPECT_EQ(4u, stats.rows);
+    EXPECT_EQ(3u, stats.ok_rows);
+    EXPECT_EQ(1u, stats.failed_rows);
+    EXPECT_EQ(0u, stats.filtered_rows);
+    EXPECT_EQ(strlen(stats_input), stats.bytes);
+    EXPECT_EQ(1u, stats.errors[tp::KERR_PARSE_FAILED]);
+    EXPECT_EQ(16u, stats.longest_line);
+    EXPECT_EQ(4u, stats.longest_line_no);
+    EXPECT_GT(stats.rows_per_second(), 0);
+
+    // 出错的列也计入, 其后的列不再解析
+    ASSERT_EQ(3u, stats.columns.size());
+    EXPECT_EQ(4u, stats.columns[0].calls);
+    EXPECT_EQ(3u, stats.columns[1].calls);
+    EXPECT_EQ(10u, stats.columns[1].longest);
+    EXPECT_EQ(4u, stats.columns[1].longest_line);
+    EXPECT_EQ(3u, stats.columns[2].calls);
+    EXPECT_EQ(6u, stats.columns[2].bytes);
+
+    EXPECT_EQ(4u, stats.types[tp::KINT].calls);
+    EXPECT_EQ(3u, stats.types[tp::KSTRING].calls);
+    EXPECT_EQ(3u, stats.types[tp::KCLASS].calls);
+
+    string dump = stats.dump();
+    EXPECT_NE(string::npos, dump.find("rows 4 (ok 3, failed 1, filtered 0)"));
+    EXPECT_NE(string::npos, dump.find("class"));
+    EXPECT_NE(string::npos, dump.find("PARSE_FAILED"));
+}
+
+TEST(TestStats, Filtered) {
+    tp::RowFilter filter;
+    filter.int_range(0, 2, 10);
+
+    tp::ParseStats stats;
+    tp::TableParser parser(stats_input, stats_desc);
+    parser.set_filter(&filter);
+    parser.set_stats(&stats);
+    vector<stats_data> results;
+    vector<tp::ParseError> errors;
+    EXPECT_EQ(2u, tp::parse_all(parser, results, errors));
+    if (!tp::stats_enabled()) {
+        EXPECT_EQ(0u, stats.rows);
+        return;
+    }
+
+    EXPECT_EQ(4u, stats.rows);
+    EXPECT_EQ(2u, stats.ok_rows);
+    EXPECT_EQ(2u, stats.filtered_rows);
+    EXPECT_EQ(0u, stats.failed_rows);
+    // 被过滤的行不转换任何列
+    EXPECT_EQ(2u, stats.types[tp::KCLASS].calls);
+}
+
+TEST(TestStats, MergeAndReset) {
+    tp::ParseStats a;
+    tp::ParseStats b;
+    a.rows = 2;
+    a.longest_line = 5;
+    a.longest_line_no = 1;
+    a.errors[tp::KERR_MORE_ELEMENT] = 1;
+    b.rows = 3;
+    b.longest_line = 9;
+    b.longest_line_no = 7;
+    b.columns.resize(2);
+    b.columns[1].calls = 4;
+    b.types[tp::KCLASS].calls = 4;
+
+    a.merge(b);
+    EXPECT_EQ(5u, a.rows);
+    EXPECT_EQ(9u, a.longest_line);
+    EXPECT_EQ(7u, a.longest_line_no);
+    ASSERT_EQ(2u, a.columns.size());
+    EXPECT_EQ(0u, a.columns[0].calls);
+    EXPECT_EQ(4u, a.columns[1].calls);
+    EXPECT_EQ(4u, a.types[tp::KCLASS].calls);
+    EXPECT_EQ(1u, a.errors[tp::KERR_MORE_ELEMENT]);
+    EXPECT_NE(string::npos, a.dump().find("MORE_ELEMENT"));
+
+    a.reset();
+    EXPECT_EQ(0u, a.rows);
+    EXPECT_TRUE(a.columns.empty());
+    EXPECT_EQ(0u, a.errors[tp::KERR_MORE_ELEMENT]);
+}
+
+TEST(TestStats, Parallel) {
+    string input;
+    for (int i = 0; i < 20000; ++i) {
+        input += stats_input;
+    }
+
+    tp::ParseStats stats;
+    vector<stats_data> results;
+    vector<tp::ParseError> errors;
+    EXPECT_EQ(60000u, tp::parse_all_parallel(input.c_str(), stats_desc,
+                                             results, errors, 4, &stats));
+    if (!tp::stats_enabled()) {
+        EXPECT_EQ(0u, stats.rows);
+        return;
+    }
+
+    EXPECT_EQ(80000u, stats.rows);
+    EXPECT_EQ(20000u, stats.failed_rows);
+    EXPECT_EQ(input.size(), stats.bytes);
+    EXPECT_EQ(60000u, stats.types[tp::KCLASS].calls);
+    EXPECT_GT(stats.nanos, 0u);
+    EXPECT_GT(stats.cpu_nanos, 0u);
+}
+
+TEST(TestStats, Pipelined) {
+    string input;
+    for (int i = 0; i < 20000; ++i) {
+        input += stats_input;
+    }
+    istringstream raw(input);
+    tp::IstreamInputStream in(raw);
+
+    tp::ParseStats stats;
+    vector<stats_data> results;
+    vector<tp::ParseError> errors;
+    EXPECT_EQ(60000u, tp::parse_all_pipelined(in, stats_desc, results, errors,
+                                              4, 64 * 1024, &stats));
+    if (!tp::stats_enabled()) {
+        EXPECT_EQ(0u, stats.rows);
+        return;
+    }
+
+    EXPECT_EQ(80000u, stats.rows);
+    EXPECT_EQ(input.size(), stats.bytes);
+    EXPECT_GT(stats.nanos, 0u);
+}
+
+TEST(TestStats, ConcurrentTime) {
+    // 同时进行的解析按经过的时间计算吞吐, 线程耗时另计
+    vector<tp::ParseStats> parts(4);
+    for (size_t i = 0; i < parts.size(); ++i) {
+        parts[i].rows = 100;
+        parts[i].nanos = 1000000;
+        parts[i].cpu_nanos = 1000000;
+    }
+    tp::ParseStats stats;
+    stats.merge_concurrent(parts, 1000000);
+    EXPECT_EQ(400u, stats.rows);
+    EXPECT_EQ(1000000u, stats.nanos);
+    EXPECT_EQ(4000000u, stats.cpu_nanos);
+    EXPECT_DOUBLE_EQ(400000.0, stats.rows_per_second());
+
+    // 先后进行的解析直接累加
+    stats.merge_concurrent(parts, 1000000);
+    EXPECT_EQ(2000000u, stats.nanos);
+    EXPECT_EQ(8000000u, stats.cpu_nanos);
+}
+
+TEST(TestStats, ErrorCodeName) {
+    EXPECT_STREQ("OK", tp::error_code_name(tp::KERR_OK));
+    EXPECT_STREQ("PARSE_FAILED", tp::error_code_name(tp::KERR_PARSE_FAILED));
+    EXPECT_STREQ("FILTER_COLUMN", tp::error_code_name(tp::KERR_FILTER_COLUMN));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include "table_parser.h"
+
+using namespace std;
+
+struct stream_data {
+    unsigned count_a;
+    int a[4];
+    char b[64];
+    float c;
+};
+
+tp::ColumnDescriptor stream_data_desc[] = {
+    {tp::KINT, true, 4, sizeof(int), offsetof(stream_data, a),
+     offsetof(stream_data, count_a), nullptr, nullptr},
+    {tp::KSTRING, false, 0, sizeof(stream_data::b), offsetof(stream_data, b),
+     0, nullptr, nullptr},
+    {tp::KFLOAT, false, 0, sizeof(float), offsetof(stream_data, c), 0, nullptr,
+     nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static const char* stream_text =
+    "2:1,2\tfirst row\t1.5\n"
+    "1:7\tsecond row is a bit longer than the buffer\t2.5\n"
+    "\n"
+    "x:1\tbad\t0\n"
+    "4:1,2,3,4\tlast\t-3";
+
+static void ExpectSameResult(const vector<stream_data>& expect,
+                             const vector<stream_data>& actual) {
+    ASSERT_EQ(expect.size(), actual.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+        ASSERT_EQ(expect[i].count_a, actual[i].count_a);
+        for (unsigned j = 0; j < expect[i].count_a; ++j) {
+            EXPECT_EQ(expect[i].a[j], actual[i].a[j]);
+        }
+        EXPECT_STREQ(expect[i].b, actual[i].b);
+        EXPECT_FLOAT_EQ(expect[i].c, actual[i].c);
+    }
+}
+
+TEST(TestStream, SameAsStringInput) {
+    vector<stream_data> expect;
+    vector<string> expect_err;
+    unsigned expect_count =
+        tp::parse_all(stream_text, stream_data_desc, expect, expect_err);
+    EXPECT_EQ(3u, expect_count);
+
+    // 各种块大小, 包括比行短的块
+    for (size_t buffer_size = 1; buffer_size <= 64; ++buffer_size) {
+        istringstream in(stream_text);
+        tp::IstreamInputStream stream(in);
+        tp::TableParser parser(&stream, stream_data_desc, buffer_size);
+
+        vector<stream_data> results;
+        vector<string> errors;
+        unsigned count = tp::parse_all(parser, results, errors);
+
+        EXPECT_EQ(expect_count, count);
+        ExpectSameResult(expect, results);
+        EXPECT_EQ(expect_err, errors);
+    }
+}
+
+TEST(TestStream, LineNumberAcrossChunks) {
+    istringstream in(stream_text);
+    tp::IstreamInputStream stream(in);
+    tp::TableParser parser(&stream, stream_data_desc, 3);
+
+    stream_data data;
+    EXPECT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_NE(nullptr, strstr(parser.last_error(), "line 4"));
+    EXPECT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(4u, data.count_a);
+    EXPECT_EQ(tp::KEOF, parser.parse(&data, sizeof(data)));
+}
+
+TEST(TestStream, ReadFromPipe) {
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+
+    // 写线程中不做断言, 失败时也要关闭管道, 否则读端永远等不到结束
+    const unsigned rows = 10000;
+    unsigned written = 0;
+    thread writer([&]() {
+        for (unsigned i = 0; i < rows; ++i) {
+            char line[64];
+            int n = snprintf(line, sizeof(line), "1:%u\trow %u\t0.5\n", i, i);
+            if (write(fds[1], line, static_cast<size_t>(n)) != n) {
+                break;
+            }
+            ++written;
+        }
+        close(fds[1]);
+    });
+
+    tp::FdInputStream stream(fds[0]);
+    tp::TableParser parser(&stream, stream_data_desc, 100);
+    vector<stream_data> results;
+    vector<string> errors;
+    unsigned count = tp::parse_all(parser, results, errors);
+    writer.join();
+    close(fds[0]);
+
+    ASSERT_EQ(rows, written);
+    EXPECT_EQ(rows, count);
+    ASSERT_EQ(rows, results.size());
+    EXPECT_EQ(static_cast<int>(rows - 1), results[rows - 1].a[0]);
+    EXPECT_STREQ("row 9999", results[rows - 1].b);
+}
+
+// 读完若干块后返回错误的输入流
+class FailingInputStream : public tp::InputStream {
+   public:
+    explicit FailingInputStream(const char* data)
+        : _data(data), _len(strlen(data)) {}
+
+    virtual long read(char* buf, size_t len) {
+        if (_len == 0) {
+            return -1;
+        }
+        size_t n = len < _len ? len : _len;
+        memcpy(buf, _data, n);
+        _data += n;
+        _len -= n;
+        return static_cast<long>(n);
+    }
+
+   private:
+    const char* _data;
+    size_t _len;
+};
+
+TEST(TestStream, ReadFailureDropsPartialLine) {
+    // 最后一行没有换行符, 读取出错时不能当作完整行返回
+    FailingInputStream stream("1:1\tfirst\t1.5\n2:1,2\tcut");
+    tp::TableParser parser(&stream, stream_data_desc, 4);
+
+    stream_data data;
+    EXPECT_EQ(tp::KOK, parser.parse(&data, sizeof(data)));
+    EXPECT_STREQ("first", data.b);
+    EXPECT_EQ(tp::KERROR, parser.parse(&data, sizeof(data)));
+    EXPECT_EQ(tp::KERR_READ_FAILED, parser.error().code);
+    EXPECT_EQ(14u, parser.error().offset);
+    EXPECT_EQ(tp::KEOF, parser.parse(&data, sizeof(data)));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "columnar_table.h"
+#include "hash_index.h"
+#include "schema.h"
+#include "snapshot.h"
+
+using namespace std;
+
+struct word_data {
+    tp::StringRef word;
+    tp::StringRef tag;
+    int freq;
+};
+
+static tp::StringArena tag_arena;
+
+static tp::ColumnDescriptor word_desc[] = {
+    {tp::KSTRING_VIEW, false, 0, sizeof(tp::StringRef),
+     offsetof(word_data, word), 0, nullptr, nullptr},
+    {tp::KSTRING_INTERN, false, 0, sizeof(tp::StringRef),
+     offsetof(word_data, tag), 0, nullptr, &tag_arena},
+    {tp::KINT, false, 0, sizeof(int), offsetof(word_data, freq), 0, nullptr,
+     nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+static const char* word_input =
+    "apple\tnoun\t3\n"
+    "a rather long value that would never fit into a small fixed buffer\t"
+    "noun\t5\n"
+    "run\tverb\t7\n"
+    "\tverb\t0\n";
+
+TEST(TestStrings, ViewAndIntern) {
+    vector<word_data> results;
+    vector<string> errors;
+    unsigned count = tp::parse_all(word_input, word_desc, results, errors);
+
+    ASSERT_EQ(4u, count);
+    EXPECT_EQ("apple", results[0].word.str());
+    EXPECT_EQ(word_input, results[0].word.data);
+    EXPECT_EQ(66u, results[1].word.size);
+    EXPECT_EQ(0u, results[3].word.size);
+
+    // 相同的值共享同一份存储
+    EXPECT_EQ("noun", results[0].tag.str());
+    EXPECT_EQ(results[0].tag.data, results[1].tag.data);
+    EXPECT_EQ(results[2].tag.data, results[3].tag.data);
+    EXPECT_NE(results[0].tag, results[2].tag);
+    EXPECT_EQ(2u, tag_arena.size());
+    EXPECT_EQ('\0', results[2].tag.data[4]);
+}
+
+TEST(TestStrings, ViewRejectedInStream) {
+    istringstream in(word_input);
+    tp::IstreamInputStream stream(in);
+    tp::TableParser parser(&stream, word_desc);
+
+    word_data row;
+    EXPECT_EQ(tp::KERROR, parser.parse(&row, sizeof(row)));
+    EXPECT_STREQ(
+        "[ERROR] line 1: string view column requires in-memory input.",
+        parser.last_error());
+}
+
+TEST(TestStrings, ViewFromMappedFile) {
+    char path[64];
+    snprintf(path, sizeof(path), "strings_test_%ld.txt", (long)getpid());
+    {
+        ofstream out(path, ios::trunc);
+        out << word_input;
+    }
+
+    // 流式解析文件时拒绝字符串引用
+    vector<word_data> streamed;
+    vector<tp::ParseError> stream_errors;
+    ASSERT_TRUE(tp::parse_file(path, word_desc, streamed, stream_errors));
+    EXPECT_TRUE(streamed.empty());
+    ASSERT_FALSE(stream_errors.empty());
+    EXPECT_EQ(tp::KERR_STRING_VIEW_IN_STREAM, stream_errors[0].code);
+
+    vector<word_data> results;
+    vector<string> errors;
+    {
+        tp::MappedFile file;
+        ASSERT_TRUE(tp::parse_file(path, word_desc, results, errors, file));
+        unlink(path);
+
+        // 文件删除后映射仍然有效
+        ASSERT_EQ(4u, results.size());
+        EXPECT_TRUE(errors.empty());
+        EXPECT_EQ("apple", results[0].word.str());
+        EXPECT_EQ(file.data(), results[0].word.data);
+        EXPECT_EQ(66u, results[1].word.size);
+        EXPECT_EQ("run", results[2].word.str());
+        EXPECT_EQ(7, results[2].freq);
+    }
+
+    tp::MappedFile missing;
+    EXPECT_FALSE(tp::parse_file(path, word_desc, results, errors, missing));
+    EXPECT_STREQ("", missing.data());
+}
+
+TEST(TestStrings, MappedFileEndsWithZero) {
+    // 文件大小恰为整页且末行没有换行符时, 映射之后仍以'\0'结尾
+    char path[64];
+    snprintf(path, sizeof(path), "strings_page_%ld.txt", (long)getpid());
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    string line = "word\tnoun\t1\n";
+    string content;
+    while (content.size() + line.size() + 32 < page) {
+        content += line;
+    }
+    string tail = "\tnoun\t9";
+    content += "last";
+    content.append(page - content.size() - tail.size(), 'x');
+    content += tail;
+    {
+        ofstream out(path, ios::trunc);
+        out << content;
+    }
+
+    tp::MappedFile file;
+    ASSERT_TRUE(file.open(path));
+    unlink(path);
+    ASSERT_EQ(page, file.size());
+    EXPECT_EQ('\0', file.data()[page]);
+
+    vector<word_data> results;
+    vector<tp::ParseError> errors;
+    tp::TableParser parser(file.data(), file.data() + file.size(), word_desc,
+                           1);
+    tp::parse_all(parser, results, errors);
+    EXPECT_TRUE(errors.empty());
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(0u, results.back().word.str().find("last"));
+    EXPECT_EQ(page - static_cast<size_t>(results.back().word.data -
+                                         file.data()) - tail.size(),
+              results.back().word.size);
+    EXPECT_EQ(9, results.back().freq);
+}
+
+TEST(TestStrings, ArenaRequired) {
+    tp::ColumnDescriptor desc[] = {
+        {tp::KSTRING_INTERN, false, 0, sizeof(tp::StringRef), 0, 0, nullptr,
+         nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+    tp::ParsePlan plan(desc, sizeof(tp::StringRef));
+    EXPECT_EQ(tp::KPLAN_CONTEXT_REQUIRED, plan.error());
+
+    tp::StringRef ref;
+    tp::TableParser parser("x\n", plan);
+    EXPECT_EQ(tp::KERROR, parser.parse(&ref, sizeof(ref)));
+    EXPECT_STREQ("[ERROR] line 1: string arena required at element 0.",
+                 parser.last_error());
+}
+
+TEST(TestStrings, ArenaGrowth) {
+    tp::StringArena arena(64);
+    vector<tp::StringRef> refs;
+    for (int i = 0; i < 1000; ++i) {
+        string s = to_string(i % 300);
+        refs.push_back(arena.intern(s.data(), s.size()));
+    }
+    string big(1000, 'x');
+    tp::StringRef big_ref = arena.intern(big.data(), big.size());
+
+    EXPECT_EQ(301u, arena.size());
+    EXPECT_EQ(refs[5].data, refs[305].data);
+    EXPECT_EQ("299", refs[299].str());
+    EXPECT_EQ(big, big_ref.str());
+}
+
+TEST(TestStrings, ArenaConcurrentIntern) {
+    tp::StringArena arena(256);
+    vector<string> words;
+    for (int i = 0; i < 1000; ++i) {
+        words.push_back("word_" + to_string(i));
+    }
+
+    // 每个线程以不同顺序插入同一组字符串, 得到的副本必须相同
+    const size_t KTHREADS = 8;
+    vector<vector<tp::StringRef> > refs(KTHREADS,
+                                        vector<tp::StringRef>(words.size()));
+    vector<thread> workers;
+    for (size_t t = 0; t < KTHREADS; ++t) {
+        workers.push_back(thread([&, t]() {
+            for (size_t k = 0; k < words.size(); ++k) {
+                size_t i = (k * 7 + t * 131) % words.size();
+                refs[t][i] = arena.intern(words[i].data(), words[i].size());
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+
+    EXPECT_EQ(words.size(), arena.size());
+    for (size_t i = 0; i < words.size(); ++i) {
+        EXPECT_EQ(words[i], refs[0][i].str());
+        for (size_t t = 1; t < KTHREADS; ++t) {
+            EXPECT_EQ(refs[0][i].data, refs[t][i].data);
+        }
+    }
+}
+
+TEST(TestStrings, IndexAndColumns) {
+    vector<word_data> results;
+    vector<string> errors;
+    tp::parse_all(word_input, word_desc, results, errors);
+
+    tp::HashIndex index;
+    ASSERT_TRUE(index.build(&results[0], results.size(), word_desc, 0));
+    EXPECT_EQ(2u, index.find("run", 3));
+    EXPECT_EQ(3u, index.find("", 0));
+    EXPECT_EQ(tp::HashIndex::KNPOS, index.find("ru", 2));
+
+    tp::ColumnarTable table(word_desc);
+    tp::TableParser parser(word_input, word_desc);
+    tp::parse_all(parser, table, errors);
+    ASSERT_EQ(4u, table.row_count());
+    EXPECT_EQ("run", table.values<tp::StringRef>(0)[2].str());
+
+    EXPECT_FALSE(tp::snapshot_supported(word_desc));
+}
+
+struct view_row {
+    tp::StringRef name;
+    int value;
+};
+
+typedef tp::Schema<view_row, TP_FIELD(view_row, name), TP_FIELD(view_row, value)>
+    view_schema;
+
+TEST(TestStrings, SchemaView) {
+    vector<view_row> results;
+    vector<string> errors;
+    const char* input = "first\t1\nsecond\t2\n";
+    EXPECT_EQ(2u, tp::parse_all<view_schema>(input, results, errors));
+    EXPECT_EQ("second", results[1].name.str());
+    EXPECT_EQ(input + 8, results[1].name.data);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include <fstream>
+
+#include "tail_parser.h"
+
+using namespace std;
+
+struct TailRow {
+    int id;
+    char name[16];
+};
+
+static tp::ColumnDescriptor tail_desc[] = {
+    {tp::KINT, false, 0, sizeof(int), offsetof(TailRow, id), 0, nullptr,
+     nullptr},
+    {tp::KSTRING, false, 0, sizeof(((TailRow*)0)->name),
+     offsetof(TailRow, name), 0, nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+class TestTail : public ::testing::Test {
+   protected:
+    virtual void SetUp() {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "tail_test_%ld", (long)getpid());
+        _path = string(buf) + ".txt";
+        _state_path = string(buf) + ".state";
+        memset(&_state, 0, sizeof(_state));
+        write("", ios::trunc);
+    }
+
+    virtual void TearDown() {
+        unlink(_path.c_str());
+        unlink(_state_path.c_str());
+    }
+
+    void write(const char* content, ios::openmode mode = ios::app) {
+        ofstream out(_path.c_str(), mode);
+        out << content;
+    }
+
+    tp::TailStatus parse() {
+        _rows.clear();
+        _errors.clear();
+        return tp::parse_appended(_path.c_str(), tail_desc, _state, _rows,
+                                  _errors);
+    }
+
+    string _path;
+    string _state_path;
+    tp::TailState _state;
+    vector<TailRow> _rows;
+    vector<tp::ParseError> _errors;
+};
+
+TEST_F(TestTail, OnlyAppendedRows) {
+    write("1\ta\n2\tb\n3\tpart");
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+    ASSERT_EQ(2u, _rows.size());
+    EXPECT_EQ(2, _rows[1].id);
+    // 未写完的行留到下次
+    EXPECT_EQ(8u, _state.offset);
+    EXPECT_EQ(3u, _state.line);
+
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+    EXPECT_TRUE(_rows.empty());
+
+    write("ial\nx\tbad\n5\te\n");
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+    ASSERT_EQ(2u, _rows.size());
+    EXPECT_EQ(3, _rows[0].id);
+    EXPECT_STREQ("partial", _rows[0].name);
+    EXPECT_EQ(5, _rows[1].id);
+    ASSERT_EQ(1u, _errors.size());
+    EXPECT_EQ(4u, _errors[0].line);
+    EXPECT_EQ(18u, _errors[0].offset);
+    EXPECT_EQ(28u, _state.offset);
+    EXPECT_EQ(6u, _state.line);
+}
+
+TEST_F(TestTail, ResumeFromSavedState) {
+    write("1\ta\n2\tb\n");
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+    ASSERT_TRUE(tp::save_tail_state(_state_path.c_str(), _state));
+
+    tp::TailState loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    ASSERT_TRUE(tp::load_tail_state(_state_path.c_str(), &loaded));
+    EXPECT_EQ(0, memcmp(&_state, &loaded, sizeof(loaded)));
+
+    write("3\tc\n");
+    _state = loaded;
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+    ASSERT_EQ(1u, _rows.size());
+    EXPECT_EQ(3, _rows[0].id);
+
+    EXPECT_FALSE(tp::load_tail_state("no_such_tail_state", &loaded));
+}
+
+TEST_F(TestTail, Truncated) {
+    write("1\ta\n2\tb\n");
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+
+    write("9\tz\n", ios::trunc);
+    EXPECT_EQ(tp::KTAIL_RESTARTED, parse());
+    ASSERT_EQ(1u, _rows.size());
+    EXPECT_EQ(9, _rows[0].id);
+    EXPECT_EQ(2u, _state.line);
+}
+
+TEST_F(TestTail, Rotated) {
+    write("1\ta\n");
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+
+    // 新文件替换旧文件, inode不同
+    string rotated = _path + ".new";
+    {
+        ofstream out(rotated.c_str());
+        out << "7\tnew\n8\tnewer\n";
+    }
+    ASSERT_EQ(0, rename(rotated.c_str(), _path.c_str()));
+    EXPECT_EQ(tp::KTAIL_RESTARTED, parse());
+    ASSERT_EQ(2u, _rows.size());
+    EXPECT_EQ(7, _rows[0].id);
+}
+
+TEST_F(TestTail, RewrittenInPlace) {
+    write("1\ta\n2\tb\n");
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+
+    // 截断后写入更长的内容, 大小和inode都无法发现
+    write("5\tx\n6\ty\n7\tz\n", ios::trunc);
+    EXPECT_EQ(tp::KTAIL_RESTARTED, parse());
+    ASSERT_EQ(3u, _rows.size());
+    EXPECT_EQ(5, _rows[0].id);
+}
+
+TEST_F(TestTail, Missing) {
+    unlink(_path.c_str());
+    EXPECT_EQ(tp::KTAIL_OPEN_FAILED, parse());
+    EXPECT_EQ(0u, _state.line);
+}
+
+struct TailView {
+    int id;
+    tp::StringRef name;
+};
+
+TEST_F(TestTail, StringViewRejected) {
+    // 新增数据在返回后即被释放, 字符串引用会悬空
+    tp::ColumnDescriptor desc[] = {
+        {tp::KINT, false, 0, sizeof(int), offsetof(TailView, id), 0, nullptr,
+         nullptr},
+        {tp::KSTRING_VIEW, false, 0, sizeof(tp::StringRef),
+         offsetof(TailView, name), 0, nullptr, nullptr},
+        {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+    write("1\tone\n2\ttwo\n");
+    vector<TailView> rows;
+    vector<tp::ParseError> errors;
+    EXPECT_EQ(tp::KTAIL_PLAN_REJECTED,
+              tp::parse_appended(_path.c_str(), desc, _state, rows, errors));
+    EXPECT_TRUE(rows.empty());
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ(tp::KERR_STRING_VIEW_IN_STREAM, errors[0].code);
+    EXPECT_EQ(1u, errors[0].line);
+    EXPECT_EQ(0u, _state.offset);
+    EXPECT_EQ(0u, _state.line);
+
+    // 状态不变, 换用复制字符串的列后从头解析
+    EXPECT_EQ(tp::KTAIL_APPENDED, parse());
+    EXPECT_EQ(2u, _rows.size());
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+
+#include "table_parser.h"
+
+using namespace std;
+
+struct typed_data {
+    int64_t id;
+    uint32_t u32;
+    uint64_t u64;
+    double score;
+    bool flag;
+    int color;
+    unsigned count_w;
+    double w[3];
+};
+
+static const char* color_names[] = {"red", "green", "blue"};
+static tp::EnumTable color_table(color_names, 3);
+
+tp::ColumnDescriptor typed_data_desc[] = {
+    {tp::KINT64, false, 0, sizeof(int64_t), offsetof(typed_data, id), 0,
+     nullptr, nullptr},
+    {tp::KUINT32, false, 0, sizeof(uint32_t), offsetof(typed_data, u32), 0,
+     nullptr, nullptr},
+    {tp::KUINT64, false, 0, sizeof(uint64_t), offsetof(typed_data, u64), 0,
+     nullptr, nullptr},
+    {tp::KDOUBLE, false, 0, sizeof(double), offsetof(typed_data, score), 0,
+     nullptr, nullptr},
+    {tp::KBOOL, false, 0, sizeof(bool), offsetof(typed_data, flag), 0, nullptr,
+     nullptr},
+    {tp::KENUM, false, 0, sizeof(int), offsetof(typed_data, color), 0, nullptr,
+     &color_table},
+    {tp::KDOUBLE, true, 3, sizeof(double), offsetof(typed_data, w),
+     offsetof(typed_data, count_w), nullptr, nullptr},
+    {tp::KNONE, false, 0, 0, 0, 0, nullptr, nullptr}};
+
+TEST(TestTypes, HandleLegalInput) {
+    const char* input =
+        "-9223372036854775808\t4294967295\t18446744073709551615\t0.1\ttrue\t"
+        "blue\t2:1.5,-2.25\n"
+        "+100011111111111\t0\t0\t1e300\t0\tred\t0:\n";
+
+    vector<typed_data> results;
+    vector<string> errors;
+    unsigned count = tp::parse_all(input, typed_data_desc, results, errors);
+
+    EXPECT_EQ(2u, count);
+    ASSERT_EQ(2u, results.size());
+
+    EXPECT_EQ(INT64_MIN, results[0].id);
+    EXPECT_EQ(UINT32_MAX, results[0].u32);
+    EXPECT_EQ(UINT64_MAX, results[0].u64);
+    EXPECT_EQ(0.1, results[0].score);
+    EXPECT_TRUE(results[0].flag);
+    EXPECT_EQ(2, results[0].color);
+    ASSERT_EQ(2u, results[0].count_w);
+    EXPECT_EQ(1.5, results[0].w[0]);
+    EXPECT_EQ(-2.25, results[0].w[1]);
+
+    EXPECT_EQ(100011111111111LL, results[1].id);
+    EXPECT_EQ(1e300, results[1].score);
+    EXPECT_FALSE(results[1].flag);
+    EXPECT_EQ(0, results[1].color);
+    EXPECT_EQ(0u, results[1].count_w);
+}
+
+TEST(TestTypes, HandleIllegalInput) {
+    const char* input =
+        "9223372036854775808\t0\t0\t0\ttrue\tred\t0:\n"
+        "0\t4294967296\t0\t0\ttrue\tred\t0:\n"
+        "0\t0\t-1\t0\ttrue\tred\t0:\n"
+        "0\t0\t0\t1.5x\ttrue\tred\t0:\n"
+        "0\t0\t0\t0\tyes\tred\t0:\n"
+        "0\t0\t0\t0\ttrue\tpurple\t0:\n"
+        "0\t0\t0\t0\ttrue\tredd\t0:\n";
+
+    vector<typed_data> results;
+    vector<string> errors;
+    unsigned count = tp::parse_all(input, typed_data_desc, results, errors);
+
+    EXPECT_EQ(0u, count);
+    ASSERT_EQ(7u, errors.size());
+    for (unsigned i = 0; i < errors.size(); ++i) {
+        EXPECT_EQ(0u, errors[i].find("[ERROR]"));
+    }
+}
+
+TEST(TestEnumTable, FindAll) {
+    static const tp::EnumItem items[] = {{"low", 10},
+                                         {"medium", 20},
+                                         {"high", 30},
+                                         {"", -1},
+                                         {nullptr, 0}};
+    tp::EnumTable table(items);
+    ASSERT_TRUE(table.ok());
+    EXPECT_EQ(4u, table.size());
+
+    int value = 0;
+    EXPECT_TRUE(table.find("medium", 6, &value));
+    EXPECT_EQ(20, value);
+    EXPECT_TRUE(table.find("", 0, &value));
+    EXPECT_EQ(-1, value);
+    EXPECT_FALSE(table.find("med", 3, &value));
+    EXPECT_FALSE(table.find("mediums", 7, &value));
+}
+
+TEST(TestEnumTable, ManyNames) {
+    vector<string> storage;
+    for (int i = 0; i < 500; ++i) {
+        storage.push_back("name_" + to_string(i));
+    }
+    vector<const char*> names;
+    for (size_t i = 0; i < storage.size(); ++i) {
+        names.push_back(storage[i].c_str());
+    }
+
+    tp::EnumTable table(&names[0], names.size());
+    ASSERT_TRUE(table.ok());
+    for (size_t i = 0; i < storage.size(); ++i) {
+        int value = -1;
+        ASSERT_TRUE(table.find(storage[i].data(), storage[i].size(), &value));
+        EXPECT_EQ(static_cast<int>(i), value);
+    }
+}
+
+TEST(TestEnumTable, LargeTable) {
+    vector<string> storage;
+    for (int i = 0; i < 20000; ++i) {
+        storage.push_back("enum_value_" + to_string(i * 7919));
+    }
+    vector<tp::EnumItem> items;
+    for (size_t i = 0; i < storage.size(); ++i) {
+        tp::EnumItem item = {storage[i].c_str(), static_cast<int>(i) - 100};
+        items.push_back(item);
+    }
+    tp::EnumItem end = {nullptr, 0};
+    items.push_back(end);
+
+    tp::EnumTable table(&items[0]);
+    ASSERT_TRUE(table.ok());
+    for (size_t i = 0; i < storage.size(); ++i) {
+        int value = 0;
+        ASSERT_TRUE(table.find(storage[i].data(), storage[i].size(), &value));
+        EXPECT_EQ(static_cast<int>(i) - 100, value);
+    }
+    int value = 0;
+    EXPECT_FALSE(table.find("enum_value_1", 12, &value));
+    EXPECT_FALSE(table.find("", 0, &value));
+
+    // 大表中的重复项同样能被发现
+    storage.push_back(storage[12345]);
+    vector<const char*> names;
+    for (size_t i = 0; i < storage.size(); ++i) {
+        names.push_back(storage[i].c_str());
+    }
+    tp::EnumTable duplicated(&names[0], names.size());
+    EXPECT_FALSE(duplicated.ok());
+}
+
+TEST(TestEnumTable, Empty) {
+    tp::EnumTable table(static_cast<const char* const*>(nullptr), 0);
+    EXPECT_TRUE(table.ok());
+    int value = 0;
+    EXPECT_FALSE(table.find("a", 1, &value));
+}
+
+TEST(TestEnumTable, DuplicateName) {
+    static const char* names[] = {"a", "b", "a"};
+    tp::EnumTable table(names, 3);
+    EXPECT_FALSE(table.ok());
+
+    int value;
+    EXPECT_FALSE(table.find("b", 1, &value));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}